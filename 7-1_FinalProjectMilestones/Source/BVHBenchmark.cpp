@@ -0,0 +1,225 @@
+///////////////////////////////////////////////////////////////////////////////
+// bvhbenchmark.cpp
+// ============
+// measure how the scene bounding volume hierarchy scales with object count
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BVHBenchmark.h"
+#include "SceneBVH.h"
+#include "ViewFrustum.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// object counts that are measured
+	const int OBJECT_COUNTS[] = { 1000, 10000, 100000, 1000000 };
+	// number of queries timed with the hierarchy
+	const int BVH_QUERIES = 200;
+	// number of queries timed with the plain loop - these are
+	// the first queries of the hierarchy runs, so the results
+	// can be compared
+	const int LINEAR_QUERIES = 10;
+	// objects per unit of volume, kept the same for every count
+	const float OBJECT_DENSITY = 0.01f;
+	// far plane of the query frustums, the same as the scene view
+	const float VIEW_DISTANCE = 100.0f;
+
+	typedef std::chrono::steady_clock BenchmarkClock;
+
+	// microseconds between two clock readings
+	double ElapsedMicroseconds(BenchmarkClock::time_point start, BenchmarkClock::time_point end)
+	{
+		return(std::chrono::duration<double, std::micro>(end - start).count());
+	}
+
+	// squared distance from a point to a box
+	float DistanceSquared(const SceneBVH::AABB& box, const glm::vec3& point)
+	{
+		glm::vec3 offset = glm::max(glm::max(box.boundsMin - point, point - box.boundsMax), glm::vec3(0.0f));
+		return(glm::dot(offset, offset));
+	}
+
+	// ray entry distance into a box, or -1 on a miss
+	float RayDistance(const SceneBVH::AABB& box, const glm::vec3& origin, const glm::vec3& direction, float maxDistance)
+	{
+		float tEnter = 0.0f;
+		float tExit = maxDistance;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float t0 = (box.boundsMin[axis] - origin[axis]) / direction[axis];
+			float t1 = (box.boundsMax[axis] - origin[axis]) / direction[axis];
+			tEnter = std::max(tEnter, std::min(t0, t1));
+			tExit = std::min(tExit, std::max(t0, t1));
+		}
+		return((tEnter <= tExit) ? tEnter : -1.0f);
+	}
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for running the measurements for
+ *  every object count and printing one row per count.  It
+ *  returns false if any hierarchy query disagreed with the
+ *  plain loop.
+ ***********************************************************/
+bool BVHBenchmark::Run()
+{
+	bool bAllMatched = true;
+	std::mt19937 random(330);
+
+	std::cout << "INFO: BVH benchmark - times are per query in microseconds, bvh / linear\n";
+	std::cout << std::setw(10) << "objects"
+		<< std::setw(12) << "build ms"
+		<< std::setw(12) << "refit ms"
+		<< std::setw(22) << "frustum us"
+		<< std::setw(22) << "ray us"
+		<< std::setw(22) << "nearest us" << std::endl;
+
+	for (int objectCount : OBJECT_COUNTS)
+	{
+		// spread the objects through a cube sized for a fixed density
+		float worldSize = std::cbrt((float)objectCount / OBJECT_DENSITY);
+		std::uniform_real_distribution<float> position(0.0f, worldSize);
+		std::uniform_real_distribution<float> size(0.5f, 2.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		std::vector<SceneBVH::AABB> boxes(objectCount);
+		for (int i = 0; i < objectCount; i++)
+		{
+			glm::vec3 center(position(random), position(random), position(random));
+			glm::vec3 halfSize(size(random), size(random), size(random));
+			boxes[i].boundsMin = center - halfSize;
+			boxes[i].boundsMax = center + halfSize;
+		}
+
+		SceneBVH bvh;
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		bvh.Build(boxes);
+		double buildTime = ElapsedMicroseconds(start, BenchmarkClock::now()) / 1000.0;
+
+		// move a tenth of the objects and refit the tree
+		for (int i = 0; i < objectCount; i += 10)
+		{
+			glm::vec3 offset(unit(random), unit(random), unit(random));
+			boxes[i].boundsMin += offset;
+			boxes[i].boundsMax += offset;
+			bvh.SetObjectBounds(i, boxes[i]);
+		}
+		start = BenchmarkClock::now();
+		bvh.Refit();
+		double refitTime = ElapsedMicroseconds(start, BenchmarkClock::now()) / 1000.0;
+
+		// the query inputs are made up front so that only the
+		// queries themselves are timed
+		std::vector<ViewFrustum> frustums(BVH_QUERIES);
+		std::vector<glm::vec3> origins(BVH_QUERIES);
+		std::vector<glm::vec3> directions(BVH_QUERIES);
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.25f, 0.1f, VIEW_DISTANCE);
+		for (int q = 0; q < BVH_QUERIES; q++)
+		{
+			origins[q] = glm::vec3(position(random), position(random), position(random));
+			directions[q] = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.001f));
+			frustums[q].SetFromMatrix(projection * glm::lookAt(origins[q], origins[q] + directions[q], glm::vec3(0.0f, 1.0f, 0.0f)));
+		}
+
+		std::vector<int> visible;
+		std::vector<size_t> bvhVisibleCounts(BVH_QUERIES);
+		std::vector<int> bvhRayHits(BVH_QUERIES);
+		std::vector<float> bvhNearest(BVH_QUERIES);
+		float distance = 0.0f;
+
+		// hierarchy queries
+		start = BenchmarkClock::now();
+		for (int q = 0; q < BVH_QUERIES; q++)
+		{
+			visible.clear();
+			bvh.QueryFrustum(frustums[q], visible);
+			bvhVisibleCounts[q] = visible.size();
+		}
+		double bvhFrustumTime = ElapsedMicroseconds(start, BenchmarkClock::now()) / BVH_QUERIES;
+
+		start = BenchmarkClock::now();
+		for (int q = 0; q < BVH_QUERIES; q++)
+		{
+			bvhRayHits[q] = bvh.RayCast(origins[q], directions[q], FLT_MAX, distance);
+		}
+		double bvhRayTime = ElapsedMicroseconds(start, BenchmarkClock::now()) / BVH_QUERIES;
+
+		start = BenchmarkClock::now();
+		for (int q = 0; q < BVH_QUERIES; q++)
+		{
+			bvh.FindNearest(origins[q], distance);
+			bvhNearest[q] = distance;
+		}
+		double bvhNearestTime = ElapsedMicroseconds(start, BenchmarkClock::now()) / BVH_QUERIES;
+
+		// the same queries with a plain loop over every object
+		bool bMatched = true;
+		start = BenchmarkClock::now();
+		for (int q = 0; q < LINEAR_QUERIES; q++)
+		{
+			size_t visibleCount = 0;
+			for (int i = 0; i < objectCount; i++)
+			{
+				visibleCount += frustums[q].IsBoxVisible(boxes[i].boundsMin, boxes[i].boundsMax) ? 1 : 0;
+			}
+			bMatched = bMatched && (visibleCount == bvhVisibleCounts[q]);
+		}
+		double linearFrustumTime = ElapsedMicroseconds(start, BenchmarkClock::now()) / LINEAR_QUERIES;
+
+		start = BenchmarkClock::now();
+		for (int q = 0; q < LINEAR_QUERIES; q++)
+		{
+			float nearestHit = FLT_MAX;
+			int hitObject = -1;
+			for (int i = 0; i < objectCount; i++)
+			{
+				float hit = RayDistance(boxes[i], origins[q], directions[q], nearestHit);
+				if ((hit >= 0.0f) && (hit <= nearestHit))
+				{
+					nearestHit = hit;
+					hitObject = i;
+				}
+			}
+			bMatched = bMatched && ((hitObject < 0) == (bvhRayHits[q] < 0));
+		}
+		double linearRayTime = ElapsedMicroseconds(start, BenchmarkClock::now()) / LINEAR_QUERIES;
+
+		start = BenchmarkClock::now();
+		for (int q = 0; q < LINEAR_QUERIES; q++)
+		{
+			float nearestSquared = FLT_MAX;
+			for (int i = 0; i < objectCount; i++)
+			{
+				nearestSquared = std::min(nearestSquared, DistanceSquared(boxes[i], origins[q]));
+			}
+			bMatched = bMatched && (std::fabs(std::sqrt(nearestSquared) - bvhNearest[q]) < 0.001f);
+		}
+		double linearNearestTime = ElapsedMicroseconds(start, BenchmarkClock::now()) / LINEAR_QUERIES;
+
+		std::cout << std::fixed << std::setprecision(2)
+			<< std::setw(10) << objectCount
+			<< std::setw(12) << buildTime
+			<< std::setw(12) << refitTime
+			<< std::setw(11) << bvhFrustumTime << " /" << std::setw(9) << linearFrustumTime
+			<< std::setw(11) << bvhRayTime << " /" << std::setw(9) << linearRayTime
+			<< std::setw(11) << bvhNearestTime << " /" << std::setw(9) << linearNearestTime
+			<< (bMatched ? "" : "  MISMATCH") << std::endl;
+
+		bAllMatched = bAllMatched && bMatched;
+	}
+
+	return(bAllMatched);
+}
@@ -0,0 +1,25 @@
+///////////////////////////////////////////////////////////////////////////////
+// bvhbenchmark.h
+// ============
+// measure how the scene bounding volume hierarchy scales with object count
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  BVHBenchmark
+ *
+ *  This class times building and refitting the bounding
+ *  volume hierarchy and its frustum, ray and nearest object
+ *  queries for randomly placed objects, from one thousand
+ *  up to one million of them.  Each query is also done with
+ *  a plain loop over every object, both to compare the cost
+ *  and to check that the results match.  It runs without a
+ *  window or OpenGL context.
+ ***********************************************************/
+class BVHBenchmark
+{
+public:
+	// run all of the measurements and print a results table
+	static bool Run();
+};
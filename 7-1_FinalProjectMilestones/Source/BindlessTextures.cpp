@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////
+// bindlesstextures.cpp
+// ============
+// share the array textures with the shaders through bindless texture handles
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BindlessTextures.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  BindlessTextures()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BindlessTextures::BindlessTextures()
+{
+	m_handleBuffer = 0;
+	for (int i = 0; i < TextureArrays::MAX_ARRAYS; i++)
+	{
+		m_textures[i] = 0;
+		m_handles[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~BindlessTextures()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BindlessTextures::~BindlessTextures()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the OpenGL
+ *  driver exposes the bindless texture extension.  GLEW has
+ *  to be initialized first.
+ ***********************************************************/
+bool BindlessTextures::IsSupported()
+{
+	return(GLEW_ARB_bindless_texture != GL_FALSE);
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ *
+ *  This method is used for creating the shader storage
+ *  buffer for the handles and binding it to the binding
+ *  point declared in the bindless fragment shader.
+ ***********************************************************/
+bool BindlessTextures::CreateBuffer()
+{
+	if (IsSupported() == false)
+	{
+		std::cout << "Could not enable bindless textures, ARB_bindless_texture is not supported" << std::endl;
+		return(false);
+	}
+
+	glCreateBuffers(1, &m_handleBuffer);
+	glNamedBufferStorage(m_handleBuffer, sizeof(m_handles), m_handles, GL_DYNAMIC_STORAGE_BIT);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HANDLE_BUFFER_BINDING, m_handleBuffer);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for making the handles non-resident
+ *  and freeing the handle buffer.
+ ***********************************************************/
+void BindlessTextures::Destroy()
+{
+	for (int i = 0; i < TextureArrays::MAX_ARRAYS; i++)
+	{
+		if (m_handles[i] != 0)
+		{
+			glMakeTextureHandleNonResidentARB(m_handles[i]);
+		}
+		m_textures[i] = 0;
+		m_handles[i] = 0;
+	}
+
+	if (m_handleBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_handleBuffer);
+		m_handleBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for picking up array textures that
+ *  were created or replaced since the last update.  The
+ *  handle of a new texture is made resident and written to
+ *  the handle buffer first, and only then is the handle of
+ *  the texture it replaced made non-resident.  A grown array
+ *  keeps its old texture until after this update, so the
+ *  buffer never holds the handle of a deleted texture.  The
+ *  texture parameters cannot change once a handle exists,
+ *  which is fine because they are set when an array texture
+ *  is created and never again.
+ ***********************************************************/
+void BindlessTextures::Update(const TextureArrays& textureArrays)
+{
+	GLuint64 replacedHandles[TextureArrays::MAX_ARRAYS];
+	int replacedCount = 0;
+	bool bChanged = false;
+
+	if (m_handleBuffer == 0)
+	{
+		return;
+	}
+
+	for (int i = 0; i < textureArrays.GetArrayCount(); i++)
+	{
+		GLuint texture = textureArrays.GetTexture(i);
+		if (m_textures[i] != texture)
+		{
+			if (m_handles[i] != 0)
+			{
+				replacedHandles[replacedCount++] = m_handles[i];
+			}
+			m_textures[i] = texture;
+			m_handles[i] = glGetTextureHandleARB(texture);
+			glMakeTextureHandleResidentARB(m_handles[i]);
+			bChanged = true;
+		}
+	}
+
+	if (bChanged)
+	{
+		glNamedBufferSubData(m_handleBuffer, 0, sizeof(m_handles), m_handles);
+	}
+
+	// the shaders now read the new handles
+	for (int i = 0; i < replacedCount; i++)
+	{
+		glMakeTextureHandleNonResidentARB(replacedHandles[i]);
+	}
+}
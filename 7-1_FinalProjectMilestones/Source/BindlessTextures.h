@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+// bindlesstextures.h
+// ============
+// share the array textures with the shaders through bindless texture handles
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureArrays.h"
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  BindlessTextures
+ *
+ *  This class makes a bindless handle resident for every
+ *  array texture and stores the handles in a shader storage
+ *  buffer, indexed by array index.  The shader builds its
+ *  sampler from the handle of the array selected by the
+ *  instance data, so no texture is bound to a texture unit
+ *  and no sampler uniform is set while drawing.  It needs
+ *  the ARB_bindless_texture extension - without it the
+ *  array textures are bound to texture units instead.
+ ***********************************************************/
+class BindlessTextures
+{
+public:
+	// constructor
+	BindlessTextures();
+	// destructor
+	~BindlessTextures();
+
+	// binding point of the handle buffer in the shaders
+	static const GLuint HANDLE_BUFFER_BINDING = 2;
+
+	// true when OpenGL supports bindless textures
+	static bool IsSupported();
+
+	// create the handle buffer and bind it to its binding point
+	bool CreateBuffer();
+	// release the handles and free the handle buffer - this has
+	// to happen before the array textures are deleted
+	void Destroy();
+
+	// make the handles of new or replaced array textures
+	// resident and store them in the handle buffer
+	void Update(const TextureArrays& textureArrays);
+
+	// true once the handle buffer was created
+	bool IsEnabled() const { return(m_handleBuffer != 0); }
+
+private:
+	// shader storage buffer holding one handle per array
+	GLuint m_handleBuffer;
+	// array textures and their resident handles
+	GLuint m_textures[TextureArrays::MAX_ARRAYS];
+	GLuint64 m_handles[TextureArrays::MAX_ARRAYS];
+};
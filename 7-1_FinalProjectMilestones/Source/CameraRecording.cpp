@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerarecording.cpp
+// ============
+// compact binary log of the camera state and input for deterministic playback
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraRecording.h"
+
+#include <cstring>
+#include <fstream>
+
+// declaration of global variables
+namespace
+{
+	// identifies a recording file and the version of its layout
+	const char RECORDING_MAGIC[4] = { 'C', 'A', 'M', 'R' };
+	const uint32_t RECORDING_VERSION = 1;
+}
+
+/***********************************************************
+ *  CameraRecording()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraRecording::CameraRecording()
+{
+	m_startState = CAMERA_STATE();
+	m_ticksPerSecond = TICKS_PER_SECOND;
+}
+
+/***********************************************************
+ *  ~CameraRecording()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CameraRecording::~CameraRecording()
+{
+	m_samples.clear();
+	m_checkpoints.clear();
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for throwing away the recorded steps
+ *  and starting a new recording from a camera state.
+ ***********************************************************/
+void CameraRecording::Clear(const CAMERA_STATE& startState)
+{
+	m_startState = startState;
+	m_ticksPerSecond = TICKS_PER_SECOND;
+	m_samples.clear();
+	m_checkpoints.clear();
+}
+
+/***********************************************************
+ *  AddSample()
+ *
+ *  This method is used for adding the input of the next
+ *  camera step to the recording.
+ ***********************************************************/
+void CameraRecording::AddSample(const INPUT_SAMPLE& sample)
+{
+	m_samples.push_back(sample);
+}
+
+/***********************************************************
+ *  AddCheckpoint()
+ *
+ *  This method is used for saving the camera state after the
+ *  passed in number of steps.
+ ***********************************************************/
+void CameraRecording::AddCheckpoint(uint32_t tick, const CAMERA_STATE& state)
+{
+	CHECKPOINT checkpoint;
+
+	checkpoint.tick = tick;
+	checkpoint.state = state;
+	m_checkpoints.push_back(checkpoint);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for reading a recording file.  The
+ *  counts in the header are checked against the size of the
+ *  file before anything is read, and the recording is left
+ *  empty when the file is not a valid recording.
+ ***********************************************************/
+bool CameraRecording::Load(const char* filename)
+{
+	RECORDING_HEADER header;
+	CAMERA_STATE emptyState = CAMERA_STATE();
+
+	Clear(emptyState);
+
+	std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		return(false);
+	}
+	uint64_t fileSize = (uint64_t)file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	if (fileSize < sizeof(header))
+	{
+		return(false);
+	}
+	file.read((char*)&header, sizeof(header));
+
+	uint64_t expectedSize = sizeof(header) +
+		(uint64_t)header.sampleCount * sizeof(INPUT_SAMPLE) +
+		(uint64_t)header.checkpointCount * sizeof(CHECKPOINT);
+	if ((!file) ||
+		(memcmp(header.magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC)) != 0) ||
+		(header.version != RECORDING_VERSION) ||
+		(header.ticksPerSecond == 0) ||
+		(expectedSize != fileSize))
+	{
+		return(false);
+	}
+
+	m_samples.resize(header.sampleCount);
+	m_checkpoints.resize(header.checkpointCount);
+	file.read((char*)m_samples.data(), m_samples.size() * sizeof(INPUT_SAMPLE));
+	file.read((char*)m_checkpoints.data(), m_checkpoints.size() * sizeof(CHECKPOINT));
+	if (!file)
+	{
+		Clear(emptyState);
+		return(false);
+	}
+
+	m_startState = header.startState;
+	m_ticksPerSecond = (int)header.ticksPerSecond;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Save()
+ *
+ *  This method is used for writing the recording file.
+ ***********************************************************/
+bool CameraRecording::Save(const char* filename) const
+{
+	RECORDING_HEADER header = RECORDING_HEADER();
+
+	memcpy(header.magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+	header.version = RECORDING_VERSION;
+	header.ticksPerSecond = (uint32_t)m_ticksPerSecond;
+	header.sampleCount = (uint32_t)m_samples.size();
+	header.checkpointCount = (uint32_t)m_checkpoints.size();
+	header.startState = m_startState;
+
+	std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return(false);
+	}
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)m_samples.data(), m_samples.size() * sizeof(INPUT_SAMPLE));
+	file.write((const char*)m_checkpoints.data(), m_checkpoints.size() * sizeof(CHECKPOINT));
+	file.close();
+
+	return(!file.fail());
+}
@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerarecording.h
+// ============
+// compact binary log of the camera state and input for deterministic playback
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  CameraRecording
+ *
+ *  This class holds a recorded camera session - the camera
+ *  state when the recording started, followed by one input
+ *  sample for every fixed time step of the camera.  A sample
+ *  holds the camera keys that were held down and the mouse
+ *  and scroll wheel movement, so stepping a camera from the
+ *  start state through the samples always ends up with the
+ *  same views.  The camera state is also saved at regular
+ *  steps, so that playback can check that it has not drifted
+ *  from the recording.  The session is kept in memory, and
+ *  it is read and written as one binary file.
+ ***********************************************************/
+class CameraRecording
+{
+public:
+	// constructor
+	CameraRecording();
+	// destructor
+	~CameraRecording();
+
+	// rate that the camera is stepped at while recording
+	static const int TICKS_PER_SECOND = 60;
+	// number of steps between two saved camera states
+	static const int CHECKPOINT_INTERVAL = 60;
+
+	// camera keys held down during a step
+	enum INPUT_KEY
+	{
+		INPUT_KEY_FORWARD = 1 << 0,
+		INPUT_KEY_BACKWARD = 1 << 1,
+		INPUT_KEY_LEFT = 1 << 2,
+		INPUT_KEY_RIGHT = 1 << 3,
+		INPUT_KEY_UP = 1 << 4,
+		INPUT_KEY_DOWN = 1 << 5,
+		INPUT_KEY_ORTHOGRAPHIC = 1 << 6,
+		INPUT_KEY_PERSPECTIVE = 1 << 7
+	};
+
+	// every camera value that the input changes
+	struct CAMERA_STATE
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		glm::vec3 up;
+		glm::vec3 right;
+		glm::vec3 worldUp;
+		float yaw;
+		float pitch;
+		float zoom;
+		float movementSpeed;
+		float mouseSensitivity;
+		uint32_t orthographic;
+	};
+
+	// the input of one camera step
+	struct INPUT_SAMPLE
+	{
+		uint32_t keys;
+		float mouseOffsetX;
+		float mouseOffsetY;
+		float scrollOffset;
+	};
+
+	// the camera state after a number of steps
+	struct CHECKPOINT
+	{
+		uint32_t tick;
+		CAMERA_STATE state;
+	};
+
+	// start a new recording from a camera state
+	void Clear(const CAMERA_STATE& startState);
+	// add the input of the next step
+	void AddSample(const INPUT_SAMPLE& sample);
+	// add the camera state after a number of steps
+	void AddCheckpoint(uint32_t tick, const CAMERA_STATE& state);
+
+	// read and write the recording file
+	bool Load(const char* filename);
+	bool Save(const char* filename) const;
+
+	// the recorded session
+	const CAMERA_STATE& GetStartState() const { return(m_startState); }
+	int GetTicksPerSecond() const { return(m_ticksPerSecond); }
+	int GetTickCount() const { return((int)m_samples.size()); }
+	const INPUT_SAMPLE& GetSample(int tick) const { return(m_samples[tick]); }
+	int GetCheckpointCount() const { return((int)m_checkpoints.size()); }
+	const CHECKPOINT& GetCheckpoint(int index) const { return(m_checkpoints[index]); }
+
+private:
+	// layout of the recording file - the header, then the
+	// input samples, then the checkpoints
+	struct RECORDING_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t ticksPerSecond;
+		uint32_t sampleCount;
+		uint32_t checkpointCount;
+		CAMERA_STATE startState;
+	};
+
+	// camera state when the recording started
+	CAMERA_STATE m_startState;
+	// rate that the samples were recorded at
+	int m_ticksPerSecond;
+	// input of every step and the saved camera states
+	std::vector<INPUT_SAMPLE> m_samples;
+	std::vector<CHECKPOINT> m_checkpoints;
+};
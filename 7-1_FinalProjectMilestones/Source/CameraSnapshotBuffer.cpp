@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerasnapshotbuffer.cpp
+// ============
+// lock-free triple buffer handing camera snapshots to the render thread
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraSnapshotBuffer.h"
+
+// declaration of global variables
+namespace
+{
+	// masks the slot index out of the middle index
+	const int SLOT_MASK = 3;
+}
+
+/***********************************************************
+ *  CameraSnapshotBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraSnapshotBuffer::CameraSnapshotBuffer()
+{
+	CAMERA_SNAPSHOT snapshot = CAMERA_SNAPSHOT();
+
+	m_middle.store(1);
+	m_back = 0;
+	m_front = 2;
+	Reset(snapshot);
+}
+
+/***********************************************************
+ *  ~CameraSnapshotBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CameraSnapshotBuffer::~CameraSnapshotBuffer()
+{
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for filling every slot with the same
+ *  snapshot, so the reader has a snapshot before the first
+ *  one is published.
+ ***********************************************************/
+void CameraSnapshotBuffer::Reset(const CAMERA_SNAPSHOT& snapshot)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		m_snapshots[i] = snapshot;
+	}
+	m_middle.store(1);
+	m_back = 0;
+	m_front = 2;
+}
+
+/***********************************************************
+ *  Publish()
+ *
+ *  This method is used for handing a finished snapshot to the
+ *  reader.  The snapshot is written into the back slot, which
+ *  is then swapped with the middle slot, and the slot that
+ *  comes back becomes the next back slot.
+ ***********************************************************/
+void CameraSnapshotBuffer::Publish(const CAMERA_SNAPSHOT& snapshot)
+{
+	m_snapshots[m_back] = snapshot;
+	m_back = m_middle.exchange(m_back | NEW_SNAPSHOT, std::memory_order_acq_rel) & SLOT_MASK;
+}
+
+/***********************************************************
+ *  Read()
+ *
+ *  This method is used for getting the newest finished
+ *  snapshot.  When the middle slot holds a snapshot that has
+ *  not been read yet, it is swapped with the front slot.
+ ***********************************************************/
+const CameraSnapshotBuffer::CAMERA_SNAPSHOT& CameraSnapshotBuffer::Read()
+{
+	if (m_middle.load(std::memory_order_relaxed) & NEW_SNAPSHOT)
+	{
+		m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & SLOT_MASK;
+	}
+
+	return(m_snapshots[m_front]);
+}
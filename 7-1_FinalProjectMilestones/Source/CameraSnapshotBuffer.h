@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerasnapshotbuffer.h
+// ============
+// lock-free triple buffer handing camera snapshots to the render thread
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+
+/***********************************************************
+ *  CameraSnapshotBuffer
+ *
+ *  This class passes the camera snapshots of the simulation
+ *  thread to the render thread without any locks.  It holds
+ *  three snapshots - the writer fills the back one while the
+ *  reader uses the front one, and a finished snapshot is
+ *  swapped with the middle one in a single atomic exchange.
+ *  Neither thread ever waits for the other, and the reader
+ *  always gets the newest finished snapshot.  Only one thread
+ *  may publish and only one thread may read.
+ ***********************************************************/
+class CameraSnapshotBuffer
+{
+public:
+	// constructor
+	CameraSnapshotBuffer();
+	// destructor
+	~CameraSnapshotBuffer();
+
+	// the camera values needed to build the view
+	struct CAMERA_POSE
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		glm::vec3 up;
+		float zoom;
+	};
+
+	// the camera before and after one simulation step, and the
+	// time of the step in seconds from the simulation start
+	struct CAMERA_SNAPSHOT
+	{
+		CAMERA_POSE previous;
+		CAMERA_POSE current;
+		double time;
+		uint64_t tick;
+	};
+
+	// fill every slot with a snapshot - only while no thread
+	// is publishing or reading
+	void Reset(const CAMERA_SNAPSHOT& snapshot);
+	// hand a finished snapshot to the reader
+	void Publish(const CAMERA_SNAPSHOT& snapshot);
+	// the newest finished snapshot, valid until the next read
+	const CAMERA_SNAPSHOT& Read();
+
+private:
+	// set in the middle index when it holds a snapshot that the
+	// reader has not taken yet
+	static const int NEW_SNAPSHOT = 4;
+
+	CAMERA_SNAPSHOT m_snapshots[3];
+	// slot shared between the threads, with the new flag
+	std::atomic<int> m_middle;
+	// slot owned by the writer and slot owned by the reader
+	int m_back;
+	int m_front;
+};
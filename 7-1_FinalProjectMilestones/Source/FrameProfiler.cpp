@@ -0,0 +1,450 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.cpp
+// ============
+// time nested CPU and GPU zones of each frame and export them as a trace
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameProfiler.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// most zones kept for the trace - about 40 MB of events
+	const size_t MAX_TRACE_EVENTS = 1000000;
+	// zones at this depth or less are summed up for the overlay
+	const int OVERLAY_DEPTH = 1;
+	// seconds between refreshes of the overlay text
+	const double OVERLAY_INTERVAL = 0.5;
+	// trace thread IDs of the CPU and GPU zones
+	const int CPU_TRACE_THREAD = 1;
+	const int GPU_TRACE_THREAD = 2;
+}
+
+FrameProfiler* FrameProfiler::s_pActive = NULL;
+
+/***********************************************************
+ *  FrameProfiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameProfiler::FrameProfiler()
+{
+	m_bGPUTimers = false;
+	m_gpuStart = 0;
+	for (int i = 0; i < GPU_FRAME_COUNT; i++)
+	{
+		for (int query = 0; query < MAX_GPU_ZONES * 2; query++)
+		{
+			m_gpuFrames[i].queries[query] = 0;
+		}
+		m_gpuFrames[i].zoneCount = 0;
+		m_gpuFrames[i].bPending = false;
+	}
+	m_gpuFrame = 0;
+	m_droppedGPUFrames = 0;
+	m_overlayFrames = 0;
+	m_bOverlayChanged = false;
+}
+
+/***********************************************************
+ *  ~FrameProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameProfiler::~FrameProfiler()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for making this the profiler that
+ *  the zones report to.  The GPU and CPU clocks are read
+ *  together once, so that the GPU zones can be placed on the
+ *  same time line as the CPU zones.  An OpenGL context must
+ *  be current when the GPU timers are used.
+ ***********************************************************/
+void FrameProfiler::Start(bool bGPUTimers)
+{
+	m_bGPUTimers = bGPUTimers;
+	if (m_bGPUTimers)
+	{
+		for (int i = 0; i < GPU_FRAME_COUNT; i++)
+		{
+			glCreateQueries(GL_TIMESTAMP, MAX_GPU_ZONES * 2, m_gpuFrames[i].queries);
+			m_gpuFrames[i].zoneCount = 0;
+			m_gpuFrames[i].bPending = false;
+		}
+		glGetInteger64v(GL_TIMESTAMP, &m_gpuStart);
+	}
+	m_cpuStart = ProfilerClock::now();
+	m_overlayStart = m_cpuStart;
+	m_events.reserve(MAX_TRACE_EVENTS / 10);
+
+	s_pActive = this;
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping the zones reporting to
+ *  this profiler and freeing the timestamp queries.  The
+ *  recorded zones are kept for writing the trace.
+ ***********************************************************/
+void FrameProfiler::Stop()
+{
+	if (s_pActive == this)
+	{
+		s_pActive = NULL;
+	}
+	if (m_bGPUTimers)
+	{
+		for (int i = 0; i < GPU_FRAME_COUNT; i++)
+		{
+			glDeleteQueries(MAX_GPU_ZONES * 2, m_gpuFrames[i].queries);
+			m_gpuFrames[i].bPending = false;
+		}
+		m_bGPUTimers = false;
+	}
+	m_openZones.clear();
+	m_openGPUZones.clear();
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a new frame.  The query
+ *  set of the frame is the one used two frames ago, whose
+ *  results are collected first if they are ready.  Every
+ *  frame is a zone of its own.
+ ***********************************************************/
+void FrameProfiler::BeginFrame()
+{
+	m_gpuFrame = (m_gpuFrame + 1) % GPU_FRAME_COUNT;
+
+	GPU_FRAME& frame = m_gpuFrames[m_gpuFrame];
+	if (frame.bPending)
+	{
+		CollectGPUFrame(frame);
+	}
+	frame.zoneCount = 0;
+
+	BeginZone("Frame");
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for closing the frame zone, marking
+ *  the frame's GPU queries as waiting for results, and
+ *  refreshing the overlay text every half second.
+ ***********************************************************/
+void FrameProfiler::EndFrame()
+{
+	EndZone();
+
+	m_gpuFrames[m_gpuFrame].bPending = (m_gpuFrames[m_gpuFrame].zoneCount > 0);
+
+	m_overlayFrames++;
+	if (std::chrono::duration<double>(ProfilerClock::now() - m_overlayStart).count() >= OVERLAY_INTERVAL)
+	{
+		UpdateOverlay();
+	}
+}
+
+/***********************************************************
+ *  BeginZone()
+ *
+ *  This method is used for opening a CPU zone.  The name
+ *  must stay valid until the trace is written, so it is
+ *  normally a string literal.
+ ***********************************************************/
+void FrameProfiler::BeginZone(const char* name)
+{
+	ZONE_EVENT zone;
+
+	zone.name = name;
+	zone.startMicroseconds = Now();
+	zone.durationMicroseconds = 0;
+	zone.depth = (int)m_openZones.size();
+	zone.bGPU = false;
+	m_openZones.push_back(zone);
+}
+
+/***********************************************************
+ *  EndZone()
+ *
+ *  This method is used for closing the most recently opened
+ *  CPU zone and recording it.
+ ***********************************************************/
+void FrameProfiler::EndZone()
+{
+	if (m_openZones.empty())
+	{
+		return;
+	}
+
+	ZONE_EVENT zone = m_openZones.back();
+	m_openZones.pop_back();
+	zone.durationMicroseconds = Now() - zone.startMicroseconds;
+	RecordEvent(zone);
+}
+
+/***********************************************************
+ *  BeginGPUZone()
+ *
+ *  This method is used for opening a GPU zone by writing a
+ *  timestamp query.  Zones past the per frame limit are not
+ *  timed on the GPU.
+ ***********************************************************/
+void FrameProfiler::BeginGPUZone(const char* name)
+{
+	GPU_FRAME& frame = m_gpuFrames[m_gpuFrame];
+
+	if ((m_bGPUTimers == false) || (frame.zoneCount >= MAX_GPU_ZONES))
+	{
+		m_openGPUZones.push_back(-1);
+		return;
+	}
+
+	int zone = frame.zoneCount;
+	frame.zoneCount++;
+	frame.names[zone] = name;
+	frame.depths[zone] = (int)m_openGPUZones.size();
+	glQueryCounter(frame.queries[zone * 2], GL_TIMESTAMP);
+	m_openGPUZones.push_back(zone);
+}
+
+/***********************************************************
+ *  EndGPUZone()
+ *
+ *  This method is used for closing the most recently opened
+ *  GPU zone by writing its second timestamp query.
+ ***********************************************************/
+void FrameProfiler::EndGPUZone()
+{
+	if (m_openGPUZones.empty())
+	{
+		return;
+	}
+
+	int zone = m_openGPUZones.back();
+	m_openGPUZones.pop_back();
+	if (zone >= 0)
+	{
+		glQueryCounter(m_gpuFrames[m_gpuFrame].queries[zone * 2 + 1], GL_TIMESTAMP);
+	}
+}
+
+/***********************************************************
+ *  CollectGPUFrame()
+ *
+ *  This method is used for reading the timestamps of a
+ *  frame's GPU zones once every zone has ended on the GPU.
+ *  A frame whose results are not ready yet is dropped rather
+ *  than waited for.
+ ***********************************************************/
+void FrameProfiler::CollectGPUFrame(GPU_FRAME& frame)
+{
+	GLint available = 1;
+
+	frame.bPending = false;
+
+	for (int zone = 0; (zone < frame.zoneCount) && (available != 0); zone++)
+	{
+		glGetQueryObjectiv(frame.queries[zone * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	}
+	if (available == 0)
+	{
+		m_droppedGPUFrames++;
+		return;
+	}
+
+	for (int zone = 0; zone < frame.zoneCount; zone++)
+	{
+		GLint64 start = 0;
+		GLint64 end = 0;
+		ZONE_EVENT event;
+
+		glGetQueryObjecti64v(frame.queries[zone * 2], GL_QUERY_RESULT, &start);
+		glGetQueryObjecti64v(frame.queries[zone * 2 + 1], GL_QUERY_RESULT, &end);
+
+		event.name = frame.names[zone];
+		event.startMicroseconds = (long long)((start - m_gpuStart) / 1000);
+		event.durationMicroseconds = (long long)((end - start) / 1000);
+		event.depth = frame.depths[zone];
+		event.bGPU = true;
+		RecordEvent(event);
+	}
+}
+
+/***********************************************************
+ *  RecordEvent()
+ *
+ *  This method is used for adding a finished zone to the
+ *  trace, up to the event limit, and adding the time of the
+ *  outer zones to the overlay totals.
+ ***********************************************************/
+void FrameProfiler::RecordEvent(const ZONE_EVENT& event)
+{
+	if (m_events.size() < MAX_TRACE_EVENTS)
+	{
+		m_events.push_back(event);
+	}
+
+	if (event.depth > OVERLAY_DEPTH)
+	{
+		return;
+	}
+	for (size_t i = 0; i < m_overlayTotals.size(); i++)
+	{
+		if ((m_overlayTotals[i].name == event.name) && (m_overlayTotals[i].bGPU == event.bGPU))
+		{
+			m_overlayTotals[i].durationMicroseconds += event.durationMicroseconds;
+			return;
+		}
+	}
+	m_overlayTotals.push_back(event);
+}
+
+/***********************************************************
+ *  UpdateOverlay()
+ *
+ *  This method is used for building the overlay text from
+ *  the average time per frame of each outer zone since the
+ *  last refresh, and starting the next interval.
+ ***********************************************************/
+void FrameProfiler::UpdateOverlay()
+{
+	std::ostringstream text;
+
+	text << std::fixed << std::setprecision(2);
+	for (size_t i = 0; i < m_overlayTotals.size(); i++)
+	{
+		double milliseconds = (double)m_overlayTotals[i].durationMicroseconds / 1000.0 / (double)m_overlayFrames;
+
+		text << ((i > 0) ? " | " : "") << (m_overlayTotals[i].bGPU ? "GPU " : "")
+			<< m_overlayTotals[i].name << " " << milliseconds << " ms";
+	}
+
+	m_overlayText = text.str();
+	m_bOverlayChanged = true;
+	m_overlayTotals.clear();
+	m_overlayFrames = 0;
+	m_overlayStart = ProfilerClock::now();
+}
+
+/***********************************************************
+ *  GetOverlayText()
+ *
+ *  This method is used for getting the overlay text, only
+ *  when it changed since the last call so the window title
+ *  is not set every frame.
+ ***********************************************************/
+bool FrameProfiler::GetOverlayText(std::string& text)
+{
+	if (m_bOverlayChanged == false)
+	{
+		return(false);
+	}
+
+	text = m_overlayText;
+	m_bOverlayChanged = false;
+
+	return(true);
+}
+
+/***********************************************************
+ *  WriteChromeTrace()
+ *
+ *  This method is used for writing the recorded zones in the
+ *  Chrome trace event format, with the CPU and the GPU zones
+ *  shown as two threads.
+ ***********************************************************/
+bool FrameProfiler::WriteChromeTrace(const char* filename)
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cout << "Could not write the profiler trace:" << filename << std::endl;
+		return(false);
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << CPU_TRACE_THREAD << ",\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_TRACE_THREAD << ",\"args\":{\"name\":\"GPU\"}}";
+	for (size_t i = 0; i < m_events.size(); i++)
+	{
+		const ZONE_EVENT& event = m_events[i];
+
+		file << ",\n{\"name\":\"" << event.name
+			<< "\",\"cat\":\"" << (event.bGPU ? "gpu" : "cpu")
+			<< "\",\"ph\":\"X\",\"ts\":" << event.startMicroseconds
+			<< ",\"dur\":" << event.durationMicroseconds
+			<< ",\"pid\":1,\"tid\":" << (event.bGPU ? GPU_TRACE_THREAD : CPU_TRACE_THREAD) << "}";
+	}
+	file << "\n]}\n";
+
+	std::cout << "INFO: Wrote " << m_events.size() << " profiler zones to " << filename;
+	if (m_droppedGPUFrames > 0)
+	{
+		std::cout << " (" << m_droppedGPUFrames << " frames of GPU timings were not ready in time)";
+	}
+	std::cout << std::endl;
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  Now()
+ *
+ *  This method is used for reading the CPU clock in
+ *  microseconds from the start of profiling.
+ ***********************************************************/
+long long FrameProfiler::Now() const
+{
+	return((long long)std::chrono::duration_cast<std::chrono::microseconds>(ProfilerClock::now() - m_cpuStart).count());
+}
+
+/***********************************************************
+ *  Scope()
+ *
+ *  The constructor of a scoped zone opens the zone on the
+ *  active profiler, if there is one.
+ ***********************************************************/
+FrameProfiler::Scope::Scope(const char* name, bool bGPU)
+{
+	m_pProfiler = s_pActive;
+	m_bGPU = bGPU;
+	if (NULL != m_pProfiler)
+	{
+		m_pProfiler->BeginZone(name);
+		if (m_bGPU)
+		{
+			m_pProfiler->BeginGPUZone(name);
+		}
+	}
+}
+
+/***********************************************************
+ *  ~Scope()
+ *
+ *  The destructor of a scoped zone closes the zone.
+ ***********************************************************/
+FrameProfiler::Scope::~Scope()
+{
+	if (NULL != m_pProfiler)
+	{
+		if (m_bGPU)
+		{
+			m_pProfiler->EndGPUZone();
+		}
+		m_pProfiler->EndZone();
+	}
+}
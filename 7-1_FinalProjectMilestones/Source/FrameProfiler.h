@@ -0,0 +1,159 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.h
+// ============
+// time nested CPU and GPU zones of each frame and export them as a trace
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// set to 0 in the project settings to compile every profiler
+// zone out of the program
+#ifndef FRAME_PROFILER_ENABLED
+#define FRAME_PROFILER_ENABLED 1
+#endif
+
+/***********************************************************
+ *  FrameProfiler
+ *
+ *  This class measures named zones of each frame.  CPU zones
+ *  are timed with the steady clock, and GPU zones also write
+ *  OpenGL timestamp queries.  The GPU results are read two
+ *  frames later, and only when they are already available,
+ *  so reading them never waits for the GPU.  Zones nest, and
+ *  every zone is kept for a Chrome trace file that can be
+ *  opened in chrome://tracing or Perfetto.  The average time
+ *  of the outermost zones can also be shown in the window
+ *  title.  Zones are opened with the PROFILE_ macros below,
+ *  which do nothing while no profiler is active and nothing
+ *  at all when the profiler is compiled out.
+ ***********************************************************/
+class FrameProfiler
+{
+public:
+	// constructor
+	FrameProfiler();
+	// destructor
+	~FrameProfiler();
+
+	// number of GPU zones that can be timed in one frame
+	static const int MAX_GPU_ZONES = 32;
+
+	// make this the profiler that the zones report to, or
+	// stop profiling
+	void Start(bool bGPUTimers);
+	void Stop();
+	// the profiler that the zones report to, or NULL
+	static FrameProfiler* GetActive() { return(s_pActive); }
+
+	// mark the start and the end of a frame
+	void BeginFrame();
+	void EndFrame();
+
+	// open and close a zone - the zones must close in the
+	// opposite order that they opened in
+	void BeginZone(const char* name);
+	void EndZone();
+	void BeginGPUZone(const char* name);
+	void EndGPUZone();
+
+	// write every zone that was recorded as a Chrome trace
+	bool WriteChromeTrace(const char* filename);
+	// get the text for the window title when it has been
+	// refreshed since the last call
+	bool GetOverlayText(std::string& text);
+
+	// opens a zone for the rest of the C++ scope
+	class Scope
+	{
+	public:
+		Scope(const char* name, bool bGPU);
+		~Scope();
+
+	private:
+		FrameProfiler* m_pProfiler;
+		bool m_bGPU;
+	};
+
+private:
+	typedef std::chrono::steady_clock ProfilerClock;
+
+	// one timed zone, with the times in microseconds from the
+	// start of profiling
+	struct ZONE_EVENT
+	{
+		const char* name;
+		long long startMicroseconds;
+		long long durationMicroseconds;
+		int depth;
+		bool bGPU;
+	};
+
+	// the timestamp queries of one frame's GPU zones
+	struct GPU_FRAME
+	{
+		GLuint queries[MAX_GPU_ZONES * 2];
+		const char* names[MAX_GPU_ZONES];
+		int depths[MAX_GPU_ZONES];
+		int zoneCount;
+		bool bPending;
+	};
+
+	// number of frames of GPU queries that are in flight
+	static const int GPU_FRAME_COUNT = 2;
+
+	// the profiler that the zones report to
+	static FrameProfiler* s_pActive;
+
+	// true while GPU zones write timestamp queries
+	bool m_bGPUTimers;
+	// clock readings that the event times count from
+	ProfilerClock::time_point m_cpuStart;
+	GLint64 m_gpuStart;
+	// zones recorded for the trace, and the open zones
+	std::vector<ZONE_EVENT> m_events;
+	std::vector<ZONE_EVENT> m_openZones;
+	// GPU queries of the recent frames and the open GPU zones
+	GPU_FRAME m_gpuFrames[GPU_FRAME_COUNT];
+	int m_gpuFrame;
+	std::vector<int> m_openGPUZones;
+	// GPU frames dropped because their results were late
+	unsigned int m_droppedGPUFrames;
+	// outermost zone times summed up for the overlay
+	std::vector<ZONE_EVENT> m_overlayTotals;
+	int m_overlayFrames;
+	ProfilerClock::time_point m_overlayStart;
+	std::string m_overlayText;
+	bool m_bOverlayChanged;
+
+	// microseconds from the start of profiling
+	long long Now() const;
+	// add a finished zone to the trace and the overlay
+	void RecordEvent(const ZONE_EVENT& event);
+	// read the results of a frame of GPU queries when ready
+	void CollectGPUFrame(GPU_FRAME& frame);
+	// rebuild the overlay text from the summed up zone times
+	void UpdateOverlay();
+};
+
+#if FRAME_PROFILER_ENABLED
+#define PROFILE_JOIN_NAME(prefix, line) prefix##line
+#define PROFILE_SCOPE_NAME(line) PROFILE_JOIN_NAME(profileScope, line)
+// time the rest of the C++ scope on the CPU
+#define PROFILE_SCOPE(name) FrameProfiler::Scope PROFILE_SCOPE_NAME(__LINE__)(name, false)
+// time the rest of the C++ scope on the CPU and the GPU
+#define PROFILE_GPU_SCOPE(name) FrameProfiler::Scope PROFILE_SCOPE_NAME(__LINE__)(name, true)
+// mark the start and the end of a frame
+#define PROFILE_BEGIN_FRAME() do { if (NULL != FrameProfiler::GetActive()) { FrameProfiler::GetActive()->BeginFrame(); } } while (0)
+#define PROFILE_END_FRAME() do { if (NULL != FrameProfiler::GetActive()) { FrameProfiler::GetActive()->EndFrame(); } } while (0)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+#define PROFILE_BEGIN_FRAME()
+#define PROFILE_END_FRAME()
+#endif
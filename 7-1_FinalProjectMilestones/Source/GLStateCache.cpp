@@ -0,0 +1,263 @@
+///////////////////////////////////////////////////////////////////////////////
+// glstatecache.cpp
+// ============
+// shadow the OpenGL render state and drop calls that would not change it
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GLStateCache.h"
+
+/***********************************************************
+ *  GLStateCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GLStateCache::GLStateCache()
+{
+	Invalidate();
+
+	m_stats.issuedCalls = 0;
+	m_stats.skippedCalls = 0;
+	m_stats.totalIssuedCalls = 0;
+	m_stats.totalSkippedCalls = 0;
+}
+
+/***********************************************************
+ *  ~GLStateCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GLStateCache::~GLStateCache()
+{
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for forgetting all of the shadowed
+ *  state.  It needs to be called whenever OpenGL state is
+ *  changed without going through this class.
+ ***********************************************************/
+void GLStateCache::Invalidate()
+{
+	m_program = -1;
+	for (int i = 0; i < MAX_TEXTURE_UNITS; i++)
+	{
+		m_textures[i] = -1;
+	}
+	m_vertexArray = -1;
+	for (int i = 0; i < CAPABILITY_COUNT; i++)
+	{
+		m_capabilities[i] = -1;
+	}
+	m_blendSource = -1;
+	m_blendDestination = -1;
+	for (int i = 0; i < 4; i++)
+	{
+		m_clearColor[i] = 0.0f;
+	}
+	m_bClearColorKnown = false;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for adding the call counts of the
+ *  previous frame to the totals and starting a new frame.
+ ***********************************************************/
+void GLStateCache::BeginFrame()
+{
+	m_stats.totalIssuedCalls += m_stats.issuedCalls;
+	m_stats.totalSkippedCalls += m_stats.skippedCalls;
+	m_stats.issuedCalls = 0;
+	m_stats.skippedCalls = 0;
+}
+
+/***********************************************************
+ *  CountCall()
+ *
+ *  This method is used for counting a state call that was
+ *  issued or skipped.
+ ***********************************************************/
+void GLStateCache::CountCall(bool bIssued)
+{
+	if (bIssued)
+	{
+		m_stats.issuedCalls++;
+	}
+	else
+	{
+		m_stats.skippedCalls++;
+	}
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for making a shader program current.
+ ***********************************************************/
+void GLStateCache::UseProgram(GLuint program)
+{
+	bool bChanged = (m_program != (GLint)program);
+
+	if (bChanged)
+	{
+		glUseProgram(program);
+		m_program = (GLint)program;
+	}
+	CountCall(bChanged);
+}
+
+/***********************************************************
+ *  BindTexture()
+ *
+ *  This method is used for binding a 2D texture to a texture
+ *  unit.  The texture is bound directly to the unit, so the
+ *  active texture unit never has to be switched.
+ ***********************************************************/
+void GLStateCache::BindTexture(int unit, GLuint texture)
+{
+	bool bChanged = true;
+
+	if ((unit >= 0) && (unit < MAX_TEXTURE_UNITS))
+	{
+		bChanged = (m_textures[unit] != (GLint)texture);
+		m_textures[unit] = (GLint)texture;
+	}
+	if (bChanged)
+	{
+		glBindTextureUnit((GLuint)unit, texture);
+	}
+	CountCall(bChanged);
+}
+
+/***********************************************************
+ *  BindVertexArray()
+ *
+ *  This method is used for binding a vertex array object.
+ ***********************************************************/
+void GLStateCache::BindVertexArray(GLuint vao)
+{
+	bool bChanged = (m_vertexArray != (GLint)vao);
+
+	if (bChanged)
+	{
+		glBindVertexArray(vao);
+		m_vertexArray = (GLint)vao;
+	}
+	CountCall(bChanged);
+}
+
+/***********************************************************
+ *  Enable()
+ *
+ *  This method is used for enabling an OpenGL capability.
+ ***********************************************************/
+void GLStateCache::Enable(GLenum capability)
+{
+	SetCapability(capability, true);
+}
+
+/***********************************************************
+ *  Disable()
+ *
+ *  This method is used for disabling an OpenGL capability.
+ ***********************************************************/
+void GLStateCache::Disable(GLenum capability)
+{
+	SetCapability(capability, false);
+}
+
+/***********************************************************
+ *  SetBlendFunc()
+ *
+ *  This method is used for setting the blending factors.
+ ***********************************************************/
+void GLStateCache::SetBlendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+	bool bChanged = (m_blendSource != (GLint)sourceFactor) ||
+		(m_blendDestination != (GLint)destinationFactor);
+
+	if (bChanged)
+	{
+		glBlendFunc(sourceFactor, destinationFactor);
+		m_blendSource = (GLint)sourceFactor;
+		m_blendDestination = (GLint)destinationFactor;
+	}
+	CountCall(bChanged);
+}
+
+/***********************************************************
+ *  SetClearColor()
+ *
+ *  This method is used for setting the color that the frame
+ *  buffer is cleared to.
+ ***********************************************************/
+void GLStateCache::SetClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	bool bChanged = (m_bClearColorKnown == false) ||
+		(m_clearColor[0] != red) || (m_clearColor[1] != green) ||
+		(m_clearColor[2] != blue) || (m_clearColor[3] != alpha);
+
+	if (bChanged)
+	{
+		glClearColor(red, green, blue, alpha);
+		m_clearColor[0] = red;
+		m_clearColor[1] = green;
+		m_clearColor[2] = blue;
+		m_clearColor[3] = alpha;
+		m_bClearColorKnown = true;
+	}
+	CountCall(bChanged);
+}
+
+/***********************************************************
+ *  FindCapability()
+ *
+ *  This method is used for getting the shadow slot of an
+ *  OpenGL capability.
+ ***********************************************************/
+int GLStateCache::FindCapability(GLenum capability)
+{
+	switch (capability)
+	{
+	case GL_DEPTH_TEST:
+		return(CAPABILITY_DEPTH_TEST);
+	case GL_BLEND:
+		return(CAPABILITY_BLEND);
+	case GL_CULL_FACE:
+		return(CAPABILITY_CULL_FACE);
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  SetCapability()
+ *
+ *  This method is used for enabling or disabling an OpenGL
+ *  capability.  Capabilities without a shadow slot are
+ *  always passed on.
+ ***********************************************************/
+void GLStateCache::SetCapability(GLenum capability, bool bEnabled)
+{
+	int slot = FindCapability(capability);
+	bool bChanged = true;
+
+	if (slot >= 0)
+	{
+		bChanged = (m_capabilities[slot] != (int)bEnabled);
+		m_capabilities[slot] = (int)bEnabled;
+	}
+	if (bChanged)
+	{
+		if (bEnabled)
+		{
+			glEnable(capability);
+		}
+		else
+		{
+			glDisable(capability);
+		}
+	}
+	CountCall(bChanged);
+}
@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// glstatecache.h
+// ============
+// shadow the OpenGL render state and drop calls that would not change it
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  GLStateCache
+ *
+ *  This class keeps a copy of the OpenGL state that the
+ *  scene changes while rendering - the shader program, the
+ *  texture bound to each texture unit, the vertex array,
+ *  the enable bits, the blend function and the clear color.
+ *  A call is only passed on to OpenGL when it changes the
+ *  state, and every call is counted as issued or skipped so
+ *  the savings can be measured.  The shader uniform values
+ *  are shadowed by the ShaderUniforms class, which reports
+ *  its calls through the same counters.
+ ***********************************************************/
+class GLStateCache
+{
+public:
+	// constructor
+	GLStateCache();
+	// destructor
+	~GLStateCache();
+
+	// number of texture units that are shadowed
+	static const int MAX_TEXTURE_UNITS = 16;
+
+	// state calls counted for the current frame and in total
+	struct STATE_STATS
+	{
+		unsigned int issuedCalls;
+		unsigned int skippedCalls;
+		unsigned long long totalIssuedCalls;
+		unsigned long long totalSkippedCalls;
+	};
+
+	// forget the shadowed state, so that the next call of
+	// each kind is always passed on to OpenGL
+	void Invalidate();
+	// start counting the calls for a new frame
+	void BeginFrame();
+
+	// change the OpenGL state only when it differs
+	void UseProgram(GLuint program);
+	void BindTexture(int unit, GLuint texture);
+	void BindVertexArray(GLuint vao);
+	void Enable(GLenum capability);
+	void Disable(GLenum capability);
+	void SetBlendFunc(GLenum sourceFactor, GLenum destinationFactor);
+	void SetClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+
+	// count a call that was filtered outside of this class
+	void CountCall(bool bIssued);
+
+	// state call counters
+	const STATE_STATS& GetStats() const { return(m_stats); }
+
+private:
+	// capabilities whose enable bit is shadowed
+	enum CAPABILITY
+	{
+		CAPABILITY_DEPTH_TEST = 0,
+		CAPABILITY_BLEND,
+		CAPABILITY_CULL_FACE,
+		CAPABILITY_COUNT
+	};
+
+	// shadowed values - a value of -1 means not known
+	GLint m_program;
+	GLint m_textures[MAX_TEXTURE_UNITS];
+	GLint m_vertexArray;
+	int m_capabilities[CAPABILITY_COUNT];
+	GLint m_blendSource;
+	GLint m_blendDestination;
+	GLfloat m_clearColor[4];
+	bool m_bClearColorKnown;
+	// state call counters
+	STATE_STATS m_stats;
+
+	// find the shadow slot of a capability, -1 when not shadowed
+	static int FindCapability(GLenum capability);
+	// set an enable bit through the shadow
+	void SetCapability(GLenum capability, bool bEnabled);
+};
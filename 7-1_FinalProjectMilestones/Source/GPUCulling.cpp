@@ -0,0 +1,314 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculling.cpp
+// ============
+// cull the scene instances in a compute shader that writes the indirect draws
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GPUCulling.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// invocations per work group, matching local_size_x in
+	// the compute shader
+	const int WORK_GROUP_SIZE = 64;
+}
+
+/***********************************************************
+ *  GPUCulling()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GPUCulling::GPUCulling()
+{
+	m_program = 0;
+	m_frustumPlanesLocation = -1;
+	m_instanceCountLocation = -1;
+	m_batchCountLocation = -1;
+	m_cullPassLocation = -1;
+	m_viewMatrixLocation = -1;
+	m_projectionScaleLocation = -1;
+	m_boundsBuffer.buffer = 0;
+	m_boundsBuffer.capacity = 0;
+	m_sourceInstanceBuffer.buffer = 0;
+	m_sourceInstanceBuffer.capacity = 0;
+	m_instanceBatchBuffer.buffer = 0;
+	m_instanceBatchBuffer.capacity = 0;
+	m_batchCommandBuffer.buffer = 0;
+	m_batchCommandBuffer.capacity = 0;
+	m_lodBuffer.buffer = 0;
+	m_lodBuffer.capacity = 0;
+	m_instanceCount = 0;
+	m_pStateCache = NULL;
+}
+
+/***********************************************************
+ *  ~GPUCulling()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GPUCulling::~GPUCulling()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  LoadShader()
+ *
+ *  This method is used for reading the compute shader from
+ *  its GLSL file, compiling and linking it, and looking up
+ *  its uniforms.  The compile or link log is printed when
+ *  either step fails.
+ ***********************************************************/
+bool GPUCulling::LoadShader(const char* filename)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		std::cout << "Could not open compute shader file:" << filename << std::endl;
+		return(false);
+	}
+	std::stringstream source;
+	source << file.rdbuf();
+	std::string sourceText = source.str();
+	const GLchar* sourcePointer = sourceText.c_str();
+
+	GLint status = 0;
+	GLchar log[1024];
+
+	GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(shader, 1, &sourcePointer, NULL);
+	glCompileShader(shader);
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status == GL_FALSE)
+	{
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		std::cout << "Could not compile compute shader " << filename << ":\n" << log << std::endl;
+		glDeleteShader(shader);
+		return(false);
+	}
+
+	m_program = glCreateProgram();
+	glAttachShader(m_program, shader);
+	glLinkProgram(m_program);
+	glDeleteShader(shader);
+	glGetProgramiv(m_program, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE)
+	{
+		glGetProgramInfoLog(m_program, sizeof(log), NULL, log);
+		std::cout << "Could not link compute shader " << filename << ":\n" << log << std::endl;
+		glDeleteProgram(m_program);
+		m_program = 0;
+		return(false);
+	}
+
+	m_frustumPlanesLocation = glGetUniformLocation(m_program, "frustumPlanes");
+	m_instanceCountLocation = glGetUniformLocation(m_program, "instanceCount");
+	m_batchCountLocation = glGetUniformLocation(m_program, "batchCount");
+	m_cullPassLocation = glGetUniformLocation(m_program, "cullPass");
+	m_viewMatrixLocation = glGetUniformLocation(m_program, "viewMatrix");
+	m_projectionScaleLocation = glGetUniformLocation(m_program, "projectionScale");
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetLODSelection()
+ *
+ *  This method is used for passing the level of detail
+ *  boundaries to the compute shader.  They never change, so
+ *  they are only set once.
+ ***********************************************************/
+void GPUCulling::SetLODSelection(const float* screenSizes, float hysteresis)
+{
+	if (m_program == 0)
+	{
+		return;
+	}
+
+	glProgramUniform1fv(m_program, glGetUniformLocation(m_program, "lodScreenSizes"), MeshLibrary::LOD_COUNT - 1, screenSizes);
+	glProgramUniform1f(m_program, glGetUniformLocation(m_program, "lodHysteresis"), hysteresis);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the compute program and
+ *  the storage buffers.
+ ***********************************************************/
+void GPUCulling::Destroy()
+{
+	if (m_program != 0)
+	{
+		glDeleteProgram(m_program);
+		m_program = 0;
+	}
+	DestroyBuffer(m_boundsBuffer);
+	DestroyBuffer(m_sourceInstanceBuffer);
+	DestroyBuffer(m_instanceBatchBuffer);
+	DestroyBuffer(m_batchCommandBuffer);
+	DestroyBuffer(m_lodBuffer);
+	m_instanceCount = 0;
+}
+
+/***********************************************************
+ *  SetInstances()
+ *
+ *  This method is used for uploading the instances of every
+ *  batch, their bounding spheres packed as (center, radius)
+ *  vectors, and the batch index of each instance.  It only
+ *  needs to be called when the batches are built or objects
+ *  move.  The levels of detail start over at the full level
+ *  when the number of instances changes.
+ ***********************************************************/
+void GPUCulling::SetInstances(
+	const MeshLibrary::INSTANCE_DATA* instances,
+	const float* centerX,
+	const float* centerY,
+	const float* centerZ,
+	const float* radius,
+	const int* instanceBatches,
+	int instanceCount)
+{
+	bool bResetLODs = (instanceCount != m_instanceCount);
+
+	m_instanceCount = instanceCount;
+	if (instanceCount <= 0)
+	{
+		return;
+	}
+
+	m_bounds.resize(instanceCount);
+	for (int i = 0; i < instanceCount; i++)
+	{
+		m_bounds[i] = glm::vec4(centerX[i], centerY[i], centerZ[i], radius[i]);
+	}
+
+	UploadBuffer(m_boundsBuffer, m_bounds.data(), instanceCount * sizeof(glm::vec4));
+	UploadBuffer(m_sourceInstanceBuffer, instances, instanceCount * sizeof(MeshLibrary::INSTANCE_DATA));
+	UploadBuffer(m_instanceBatchBuffer, instanceBatches, instanceCount * sizeof(int));
+	if (bResetLODs)
+	{
+		std::vector<GLuint> lods(instanceCount, 0);
+		UploadBuffer(m_lodBuffer, lods.data(), instanceCount * sizeof(GLuint));
+	}
+}
+
+/***********************************************************
+ *  Dispatch()
+ *
+ *  This method is used for running the compute shader over
+ *  every instance.  The draw commands must already be in the
+ *  command buffer with an instance count of 0 and the first
+ *  instance of their batch.  The first pass counts the
+ *  visible instances of every level, the second splits each
+ *  batch range into one slice per level from those counts,
+ *  and the third copies the instances into their slices, so
+ *  the levels share the batch range instead of each needing
+ *  room for the whole batch.  The last barrier makes the
+ *  instances and the counts visible to the draw that reads
+ *  them as vertex attributes and indirect commands.
+ ***********************************************************/
+void GPUCulling::Dispatch(
+	const ViewFrustum& frustum,
+	const glm::mat4& view,
+	float projectionScale,
+	const int* batchCommands,
+	int batchCount,
+	GLuint drawInstanceBuffer,
+	GLuint drawCommandBuffer)
+{
+	if ((m_program == 0) || (m_instanceCount <= 0) || (batchCount <= 0))
+	{
+		return;
+	}
+
+	glm::vec4 planes[ViewFrustum::PLANE_COUNT];
+	frustum.GetPlanes(planes);
+
+	UploadBuffer(m_batchCommandBuffer, batchCommands, batchCount * sizeof(int));
+
+	if (NULL != m_pStateCache)
+	{
+		m_pStateCache->UseProgram(m_program);
+	}
+	else
+	{
+		glUseProgram(m_program);
+	}
+	glProgramUniform4fv(m_program, m_frustumPlanesLocation, ViewFrustum::PLANE_COUNT, &planes[0].x);
+	glProgramUniform1ui(m_program, m_instanceCountLocation, (GLuint)m_instanceCount);
+	glProgramUniform1ui(m_program, m_batchCountLocation, (GLuint)batchCount);
+	glProgramUniformMatrix4fv(m_program, m_viewMatrixLocation, 1, GL_FALSE, glm::value_ptr(view));
+	glProgramUniform1f(m_program, m_projectionScaleLocation, projectionScale);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BOUNDS_BINDING, m_boundsBuffer.buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SOURCE_INSTANCES_BINDING, m_sourceInstanceBuffer.buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_INSTANCES_BINDING, drawInstanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_COMMANDS_BINDING, drawCommandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BATCHES_BINDING, m_instanceBatchBuffer.buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BATCH_COMMANDS_BINDING, m_batchCommandBuffer.buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_LODS_BINDING, m_lodBuffer.buffer);
+
+	GLuint instanceGroups = (GLuint)((m_instanceCount + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE);
+	GLuint batchGroups = (GLuint)((batchCount + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE);
+
+	// count the visible instances of every level
+	glProgramUniform1ui(m_program, m_cullPassLocation, 0);
+	glDispatchCompute(instanceGroups, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// give every level its slice of the batch range
+	glProgramUniform1ui(m_program, m_cullPassLocation, 1);
+	glDispatchCompute(batchGroups, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// copy the visible instances into their slices
+	glProgramUniform1ui(m_program, m_cullPassLocation, 2);
+	glDispatchCompute(instanceGroups, 1, 1);
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+/***********************************************************
+ *  UploadBuffer()
+ *
+ *  This method is used for replacing the contents of a
+ *  storage buffer.  A new buffer is only created when the
+ *  data does not fit into the current one.
+ ***********************************************************/
+void GPUCulling::UploadBuffer(STORAGE_BUFFER& storage, const void* data, size_t size)
+{
+	if (size > storage.capacity)
+	{
+		DestroyBuffer(storage);
+		glCreateBuffers(1, &storage.buffer);
+		glNamedBufferData(storage.buffer, size, data, GL_DYNAMIC_DRAW);
+		storage.capacity = size;
+	}
+	else
+	{
+		glNamedBufferSubData(storage.buffer, 0, size, data);
+	}
+}
+
+/***********************************************************
+ *  DestroyBuffer()
+ *
+ *  This method is used for freeing a storage buffer.
+ ***********************************************************/
+void GPUCulling::DestroyBuffer(STORAGE_BUFFER& storage)
+{
+	if (storage.buffer != 0)
+	{
+		glDeleteBuffers(1, &storage.buffer);
+		storage.buffer = 0;
+	}
+	storage.capacity = 0;
+}
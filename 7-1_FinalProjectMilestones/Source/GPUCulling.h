@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculling.h
+// ============
+// cull the scene instances in a compute shader that writes the indirect draws
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLStateCache.h"
+#include "MeshLibrary.h"
+#include "ViewFrustum.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  GPUCulling
+ *
+ *  This class runs the frustum test for every instance in a
+ *  compute shader.  The instances of all of the batches and
+ *  their bounding spheres are kept in shader storage buffers
+ *  and only uploaded again when objects move.  Each frame
+ *  the CPU writes one indirect draw command per batch and
+ *  level of detail with no instances, and the compute shader
+ *  picks the level of every visible instance, counts it in
+ *  the matching command and then packs the levels of each
+ *  batch one after the other into the batch's range of the
+ *  draw instance buffer, so the CPU never looks at a single
+ *  object.  The level of each instance is kept on the
+ *  GPU between frames for the hysteresis.  Only the core
+ *  OpenGL 4.3 compute features are used, so it also runs on
+ *  software renderers.
+ ***********************************************************/
+class GPUCulling
+{
+public:
+	// constructor
+	GPUCulling();
+	// destructor
+	~GPUCulling();
+
+	// binding points used by the storage blocks of the
+	// compute shader
+	enum BINDING_POINT
+	{
+		INSTANCE_BOUNDS_BINDING = 3,
+		SOURCE_INSTANCES_BINDING = 4,
+		DRAW_INSTANCES_BINDING = 5,
+		DRAW_COMMANDS_BINDING = 6,
+		INSTANCE_BATCHES_BINDING = 7,
+		BATCH_COMMANDS_BINDING = 8,
+		INSTANCE_LODS_BINDING = 9
+	};
+
+	// compile and link the compute shader from a GLSL file
+	bool LoadShader(const char* filename);
+	// free the compute program and the storage buffers
+	void Destroy();
+
+	// true once the compute shader is loaded
+	bool IsEnabled() const { return(m_program != 0); }
+
+	// set the state cache used for selecting the program
+	void SetStateCache(GLStateCache* pStateCache) { m_pStateCache = pStateCache; }
+
+	// set the smallest screen size of each level of detail
+	// but the last, and the hysteresis around them - call
+	// after the shader is loaded
+	void SetLODSelection(const float* screenSizes, float hysteresis);
+
+	// upload the instances in batch order, their bounding
+	// spheres and the batch that each one belongs to
+	void SetInstances(
+		const MeshLibrary::INSTANCE_DATA* instances,
+		const float* centerX,
+		const float* centerY,
+		const float* centerZ,
+		const float* radius,
+		const int* instanceBatches,
+		int instanceCount);
+
+	// test every instance against the frustum and pack the
+	// visible ones into the draw instance buffer and the draw
+	// commands - batchCommands holds the first command of each
+	// batch, followed by one for each further level of detail,
+	// or -1 for a batch that is not drawn.  The compute
+	// program is left selected afterwards
+	void Dispatch(
+		const ViewFrustum& frustum,
+		const glm::mat4& view,
+		float projectionScale,
+		const int* batchCommands,
+		int batchCount,
+		GLuint drawInstanceBuffer,
+		GLuint drawCommandBuffer);
+
+private:
+	// a storage buffer that only grows
+	struct STORAGE_BUFFER
+	{
+		GLuint buffer;
+		size_t capacity;
+	};
+
+	// compute program and its uniform locations
+	GLuint m_program;
+	GLint m_frustumPlanesLocation;
+	GLint m_instanceCountLocation;
+	GLint m_batchCountLocation;
+	GLint m_cullPassLocation;
+	GLint m_viewMatrixLocation;
+	GLint m_projectionScaleLocation;
+	// storage buffers read by the compute shader
+	STORAGE_BUFFER m_boundsBuffer;
+	STORAGE_BUFFER m_sourceInstanceBuffer;
+	STORAGE_BUFFER m_instanceBatchBuffer;
+	STORAGE_BUFFER m_batchCommandBuffer;
+	// level of detail of every instance, read and written by
+	// the compute shader
+	STORAGE_BUFFER m_lodBuffer;
+	// number of instances uploaded
+	int m_instanceCount;
+	// staging list for packing the bounding spheres
+	std::vector<glm::vec4> m_bounds;
+	// state cache used for selecting the program
+	GLStateCache* m_pStateCache;
+
+	// replace the contents of a storage buffer, growing it
+	// when the data does not fit
+	static void UploadBuffer(STORAGE_BUFFER& storage, const void* data, size_t size);
+	// free a storage buffer
+	static void DestroyBuffer(STORAGE_BUFFER& storage);
+};
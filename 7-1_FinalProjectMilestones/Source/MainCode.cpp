@@ -9,6 +9,8 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <string>           // window title text
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -18,16 +20,24 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "BindlessTextures.h"
+#include "BVHBenchmark.h"
+#include "FrameProfiler.h"
+#include "GLStateCache.h"
+#include "RenderBenchmark.h"
 #include "SceneManager.h"
 #include "ViewManager.h"
-#include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "ShaderUniforms.h"
+#include "UniformBuffers.h"
 
 // Namespace for declaring global variables
 namespace
 {
 	// Macro for window title
 	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones by Dawson Kennedy"; 
+	// scene file that is rendered
+	const char* const SCENE_FILENAME = "scenes/discGolfScene.json";
 
 	// Main GLFW window
 	GLFWwindow* g_Window = nullptr;
@@ -36,13 +46,23 @@ namespace
 	SceneManager* g_SceneManager = nullptr;
 	// shader manager object for dynamic interaction with the shader code
 	ShaderManager* g_ShaderManager = nullptr;
+	// cached shader uniform locations for the per-draw shader settings
+	ShaderUniforms* g_ShaderUniforms = nullptr;
+	// uniform buffers for the camera and light data shared by all shaders
+	UniformBuffers* g_UniformBuffers = nullptr;
+	// OpenGL state cache for dropping redundant state changes
+	GLStateCache* g_StateCache = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+#if FRAME_PROFILER_ENABLED
+	// frame profiler, only created when profiling is asked for
+	FrameProfiler* g_Profiler = nullptr;
+#endif
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
-bool InitializeGLFW();
+bool InitializeGLFW(bool bHeadless);
 bool InitializeGLEW();
 
 
@@ -54,60 +74,352 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// bindless textures are used whenever the driver has them,
+	// unless the texture unit path is asked for
+	bool bAllowBindless = true;
+	// the frustum culling runs on the CPU unless the compute
+	// shader path is asked for
+	bool bGPUCulling = false;
+	// the render benchmark draws the scene offscreen in a hidden
+	// window instead of running the interactive loop
+	bool bBenchmark = false;
+	bool bBenchmarkPassed = true;
+	RenderBenchmark::BENCHMARK_SETTINGS benchmarkSettings;
+	RenderBenchmark::GetDefaultSettings(benchmarkSettings);
+	// the camera can be recorded to a file, or a recorded file
+	// can be played back in fixed steps
+	const char* recordCameraFilename = NULL;
+	const char* playCameraFilename = NULL;
+	// the interactive loop only draws a frame when something
+	// changed, and otherwise waits for events
+	bool bRenderOnDemand = false;
+	// the camera is stepped on its own thread at a fixed rate
+	bool bSimulationThread = false;
+#if FRAME_PROFILER_ENABLED
+	// the profiler writes a trace when the program ends, and
+	// can show the zone times in the window title
+	bool bProfile = false;
+	bool bProfileOverlay = false;
+	const char* profileTraceFilename = "profile_trace.json";
+#endif
+
+	// the spatial index benchmark runs without opening a window
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--bvh-benchmark") == 0)
+		{
+			return(BVHBenchmark::Run() ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		if (strcmp(argv[i], "--no-bindless") == 0)
+		{
+			bAllowBindless = false;
+		}
+		if (strcmp(argv[i], "--gpu-culling") == 0)
+		{
+			bGPUCulling = true;
+		}
+		if (strcmp(argv[i], "--benchmark") == 0)
+		{
+			bBenchmark = true;
+		}
+		if ((strcmp(argv[i], "--benchmark-frames") == 0) && (i + 1 < argc))
+		{
+			benchmarkSettings.frameCount = atoi(argv[++i]);
+		}
+		if ((strcmp(argv[i], "--benchmark-output") == 0) && (i + 1 < argc))
+		{
+			benchmarkSettings.outputFilename = argv[++i];
+		}
+		if (strcmp(argv[i], "--sim-thread") == 0)
+		{
+			bSimulationThread = true;
+		}
+		if (strcmp(argv[i], "--on-demand") == 0)
+		{
+			bRenderOnDemand = true;
+		}
+		if ((strcmp(argv[i], "--record-camera") == 0) && (i + 1 < argc))
+		{
+			recordCameraFilename = argv[++i];
+		}
+		if ((strcmp(argv[i], "--play-camera") == 0) && (i + 1 < argc))
+		{
+			playCameraFilename = argv[++i];
+		}
+#if FRAME_PROFILER_ENABLED
+		if (strcmp(argv[i], "--profile") == 0)
+		{
+			bProfile = true;
+		}
+		if (strcmp(argv[i], "--profile-overlay") == 0)
+		{
+			bProfile = true;
+			bProfileOverlay = true;
+		}
+		if ((strcmp(argv[i], "--profile-trace") == 0) && (i + 1 < argc))
+		{
+			bProfile = true;
+			profileTraceFilename = argv[++i];
+		}
+#endif
+	}
+
+	// the benchmark moves the camera itself and never reads the
+	// input, so there would be nothing to record
+	if ((bBenchmark) && (NULL != recordCameraFilename))
+	{
+		std::cout << "Could not record the camera - --record-camera cannot be used with --benchmark" << std::endl;
+		return(EXIT_FAILURE);
+	}
+
 	// if GLFW fails initialization, then terminate the application
-	if (InitializeGLFW() == false)
+	if (InitializeGLFW(bBenchmark) == false)
 	{
 		return(EXIT_FAILURE);
 	}
 
 	// try to create a new shader manager object
 	g_ShaderManager = new ShaderManager();
+	// try to create a new shader uniforms object
+	g_ShaderUniforms = new ShaderUniforms();
+	// try to create a new uniform buffers object
+	g_UniformBuffers = new UniformBuffers();
+	// try to create a new OpenGL state cache object
+	g_StateCache = new GLStateCache();
 	// try to create a new view manager object
 	g_ViewManager = new ViewManager(
-		g_ShaderManager);
+		g_ShaderManager,
+		g_UniformBuffers);
 
-	// try to create the main display window
+	// try to create the main display window - the benchmark
+	// only needs its context, which InitializeGLFW() has set up
+	// to be created headless
 	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
 
+	// a recording that cannot be read ends the program, so a
+	// scripted run never measures the wrong views
+	if (NULL != playCameraFilename)
+	{
+		if (g_ViewManager->StartPlayback(playCameraFilename) == false)
+		{
+			return(EXIT_FAILURE);
+		}
+	}
+	else if (NULL != recordCameraFilename)
+	{
+		g_ViewManager->StartRecording(recordCameraFilename);
+	}
+
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
 	{
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"shaders/vertexShader.glsl",
-		"shaders/fragmentShader.glsl");
-	g_ShaderManager->use();
+	// enable blending for supporting tranparent rendering - set
+	// through the state cache, so that it knows the blend state
+	g_StateCache->Enable(GL_BLEND);
+	g_StateCache->SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+#if FRAME_PROFILER_ENABLED
+	// the GPU timers need the OpenGL context
+	if (bProfile)
+	{
+		g_Profiler = new FrameProfiler();
+		g_Profiler->Start(true);
+	}
+#endif
+
+	// load the shader code from the external GLSL files - the
+	// bindless fragment shader needs ARB_bindless_texture
+	bool bBindless = bAllowBindless && BindlessTextures::IsSupported();
+	GLint shaderProgramID = 0;
+	{
+		PROFILE_SCOPE("Load shaders");
+		g_ShaderManager->LoadShaders(
+			"shaders/vertexShader.glsl",
+			bBindless ? "shaders/fragmentShaderBindless.glsl" : "shaders/fragmentShader.glsl");
+		std::cout << "INFO: Textures are sampled through " << (bBindless ? "bindless handles" : "texture units") << std::endl;
+		g_ShaderManager->use();
+
+		// look up all the active uniform locations of the loaded
+		// shader program once, instead of on every draw
+		glGetIntegerv(GL_CURRENT_PROGRAM, &shaderProgramID);
+		g_ShaderUniforms->LoadUniformLocations((GLuint)shaderProgramID);
+		g_ShaderUniforms->SetStateCache(g_StateCache);
+	}
+
+	// create the camera and light uniform buffers shared by the shaders
+	g_UniformBuffers->CreateBuffers();
 
 	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
+	g_SceneManager = new SceneManager(
+		g_ShaderManager,
+		g_ShaderUniforms,
+		g_UniformBuffers,
+		g_StateCache);
+	if (bBindless)
+	{
+		g_SceneManager->EnableBindlessTextures();
+	}
+	if (bGPUCulling)
+	{
+		bGPUCulling = g_SceneManager->EnableGPUCulling("shaders/cullCompute.glsl");
+	}
+	std::cout << "INFO: Objects are culled on the " << (bGPUCulling ? "GPU" : "CPU") << std::endl;
+	{
+		PROFILE_SCOPE("Prepare scene");
+		g_SceneManager->PrepareScene(SCENE_FILENAME);
+	}
+
+	// render the scripted benchmark frames instead of the
+	// interactive loop
+	if (bBenchmark)
+	{
+		RenderBenchmark benchmark(g_SceneManager, g_UniformBuffers, g_StateCache);
+
+		benchmarkSettings.sceneName = SCENE_FILENAME;
+		benchmarkSettings.bGPUCulling = bGPUCulling;
+		benchmarkSettings.bBindlessTextures = bBindless;
+		if (NULL != playCameraFilename)
+		{
+			benchmarkSettings.frameCount = g_ViewManager->GetPlaybackTickCount();
+			benchmarkSettings.cameraRecording = playCameraFilename;
+			benchmark.SetCameraPlayback(g_ViewManager);
+		}
+		bBenchmarkPassed = benchmark.Run((GLuint)shaderProgramID, benchmarkSettings);
+		glfwSetWindowShouldClose(g_Window, true);
+	}
+
+	if (bRenderOnDemand)
+	{
+		std::cout << "INFO: Frames are only drawn when the view or the scene changes" << std::endl;
+	}
+
+	// the camera thread is only started once everything before
+	// the loop has succeeded, so an early exit never leaves it
+	// running - recordings and the benchmark step the camera
+	// with the frames, so they keep it on this thread
+	if ((bSimulationThread) && (!bBenchmark))
+	{
+		if (g_ViewManager->StartSimulation() == false)
+		{
+			std::cout << "INFO: The camera is not simulated on its own thread while it is recorded or played back" << std::endl;
+		}
+	}
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		// when nothing would change on the screen, block until
+		// the next event instead of drawing the same frame again
+		if ((bRenderOnDemand) &&
+			(g_ViewManager->NeedsRedraw() == false) &&
+			(g_SceneManager->NeedsRedraw() == false))
+		{
+			glfwWaitEvents();
+			g_ViewManager->ResetFrameTime();
+			continue;
+		}
+
+		PROFILE_BEGIN_FRAME();
+
+		// start counting the state calls for this frame
+		g_StateCache->BeginFrame();
+
+		// Enable z-depth - the state cache only passes on the
+		// calls that change the current state
+		g_StateCache->UseProgram((GLuint)shaderProgramID);
+		g_StateCache->Enable(GL_DEPTH_TEST);
 
 		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		g_StateCache->SetClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// convert from 3D object space to 2D view
 		g_ViewManager->PrepareSceneView();
+		g_SceneManager->SetCameraView(
+			g_ViewManager->GetViewMatrix(),
+			g_ViewManager->GetProjectionMatrix());
 
 		// refresh the 3D scene
-		g_SceneManager->RenderScene();
-
+		{
+			PROFILE_GPU_SCOPE("Render scene");
+			g_SceneManager->RenderScene();
+		}
 
 		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+		{
+			PROFILE_SCOPE("Swap buffers");
+			glfwSwapBuffers(g_Window);
+		}
 
 		// query the latest GLFW events
-		glfwPollEvents();
+		{
+			PROFILE_SCOPE("Poll events");
+			glfwPollEvents();
+		}
+
+		PROFILE_END_FRAME();
+
+		// the program ends after the last recorded camera step
+		if (g_ViewManager->IsPlaybackFinished())
+		{
+			glfwSetWindowShouldClose(g_Window, true);
+		}
+
+#if FRAME_PROFILER_ENABLED
+		// show the average zone times in the window title
+		std::string overlayText;
+		if ((bProfileOverlay) && (NULL != g_Profiler) && (g_Profiler->GetOverlayText(overlayText)))
+		{
+			glfwSetWindowTitle(g_Window, (std::string(WINDOW_TITLE) + " - " + overlayText).c_str());
+		}
+#endif
+	}
+
+#if FRAME_PROFILER_ENABLED
+	// write the recorded zones while the context still exists
+	if (NULL != g_Profiler)
+	{
+		g_Profiler->Stop();
+		g_Profiler->WriteChromeTrace(profileTraceFilename);
+		delete g_Profiler;
+		g_Profiler = NULL;
+	}
+#endif
+
+	// report the rendering counters for the session
+	if ((NULL != g_SceneManager) && (g_SceneManager->GetFrameStats().frameCount > 0))
+	{
+		const SceneManager::FRAME_STATS& stats = g_SceneManager->GetFrameStats();
+		unsigned long long totalDrawCalls = stats.totalDrawCalls + stats.drawCalls;
+
+		std::cout << "INFO: Frames rendered: " << stats.frameCount << "\n";
+		std::cout << "INFO: Draw calls per frame: " << (totalDrawCalls / stats.frameCount) << "\n";
+		std::cout << "INFO: Indirect draw commands in the last frame: " << stats.drawCommands << "\n";
+		std::cout << "INFO: Instances per frame: " << stats.instances << std::endl;
+		// the GPU culling results are never read back
+		if (!bGPUCulling)
+		{
+			std::cout << "INFO: Triangles in the last frame: " << stats.triangles << "\n";
+			std::cout << "INFO: Objects visible in the last frame: " << stats.visibleObjects << ", culled: " << stats.culledObjects << std::endl;
+		}
+	}
+	if ((NULL != g_StateCache) && (NULL != g_SceneManager) && (g_SceneManager->GetFrameStats().frameCount > 0))
+	{
+		const GLStateCache::STATE_STATS& stateStats = g_StateCache->GetStats();
+		unsigned int frameCount = g_SceneManager->GetFrameStats().frameCount;
+
+		std::cout << "INFO: GL state calls issued per frame: " << ((stateStats.totalIssuedCalls + stateStats.issuedCalls) / frameCount) << "\n";
+		std::cout << "INFO: GL state calls skipped per frame: " << ((stateStats.totalSkippedCalls + stateStats.skippedCalls) / frameCount) << std::endl;
+	}
+
+	// write the camera recording
+	if (NULL != g_ViewManager)
+	{
+		g_ViewManager->StopRecording();
 	}
 
 	// clear the allocated manager objects from memory
@@ -121,38 +433,76 @@ int main(int argc, char* argv[])
 		delete g_ViewManager;
 		g_ViewManager = NULL;
 	}
+	if (NULL != g_UniformBuffers)
+	{
+		delete g_UniformBuffers;
+		g_UniformBuffers = NULL;
+	}
+	if (NULL != g_ShaderUniforms)
+	{
+		delete g_ShaderUniforms;
+		g_ShaderUniforms = NULL;
+	}
+	if (NULL != g_StateCache)
+	{
+		delete g_StateCache;
+		g_StateCache = NULL;
+	}
 	if (NULL != g_ShaderManager)
 	{
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
 
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+	// Terminates the program, reporting a benchmark that could
+	// not be completed as a failure
+	exit(bBenchmarkPassed ? EXIT_SUCCESS : EXIT_FAILURE); 
 }
 
 /***********************************************************
  *	InitializeGLFW()
  * 
  *  This function is used to initialize the GLFW library.   
+ *  A headless setup creates the context through EGL in a
+ *  hidden window, so the benchmark runs on Mesa llvmpipe on
+ *  machines without a GPU or a display server.
  ***********************************************************/
-bool InitializeGLFW()
+bool InitializeGLFW(bool bHeadless)
 {
 	// GLFW: initialize and configure library
 	// --------------------------------------
-	glfwInit();
+#ifdef GLFW_PLATFORM_NULL
+	// GLFW 3.4 and later can run without any display server
+	if (bHeadless)
+	{
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+	}
+#endif
+	if (glfwInit() == GLFW_FALSE)
+	{
+		std::cout << "Could not initialize GLFW" << std::endl;
+		return(false);
+	}
 
 #ifdef __APPLE__
-	// set the version of OpenGL and profile to use
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#else
-	// set the version of OpenGL and profile to use
+	// macOS stops at OpenGL 4.1, and the renderer needs 4.5 for
+	// direct state access, multi-draw indirect and its shaders
+	std::cout << "Could not create an OpenGL 4.5 context - macOS only provides OpenGL 4.1" << std::endl;
+	glfwTerminate();
+	return(false);
+#endif
+
+	// set the version of OpenGL and profile to use - 4.5 is the
+	// newest version that Mesa llvmpipe provides, and nothing
+	// in the renderer needs 4.6
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-#endif
+	if (bHeadless)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+	}
 	// GLFW: end -------------------------------
 
 	return(true);
@@ -171,6 +521,14 @@ bool InitializeGLEW()
 
 	// try to initialize the GLEW library
 	GLEWInitResult = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	// with an EGL context there is no GLX display, but the core
+	// OpenGL functions have already been loaded at this point
+	if (GLEW_ERROR_NO_GLX_DISPLAY == GLEWInitResult)
+	{
+		GLEWInitResult = GLEW_OK;
+	}
+#endif
 	if (GLEW_OK != GLEWInitResult)
 	{
 		std::cerr << glewGetErrorString(GLEWInitResult) << std::endl;
@@ -0,0 +1,575 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshlibrary.cpp
+// ============
+// generate the basic shape meshes and draw them with hardware instancing
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshLibrary.h"
+
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+// the commands are read straight from the buffer by OpenGL,
+// so the structure must match the indirect command layout
+static_assert(sizeof(MeshLibrary::DRAW_COMMAND) == 20, "DRAW_COMMAND does not match the indirect draw command layout");
+
+// declaration of global variables
+namespace
+{
+	// number of segments around the round shapes at each
+	// level of detail
+	const int LOD_SLICES[MeshLibrary::LOD_COUNT] = { 36, 16, 8 };
+	// floats per vertex - position, normal and texture coordinate
+	const int FLOATS_PER_VERTEX = 8;
+
+	// vertex buffer binding indices used by every vertex array
+	const GLuint VERTEX_BINDING = 0;
+	const GLuint INSTANCE_BINDING = 1;
+
+	// vertex attribute locations declared by the vertex shader
+	const GLuint ATTRIB_POSITION = 0;
+	const GLuint ATTRIB_NORMAL = 1;
+	const GLuint ATTRIB_TEXCOORD = 2;
+	const GLuint ATTRIB_INSTANCE_MODEL = 3;	// uses locations 3 to 6
+	const GLuint ATTRIB_INSTANCE_COLOR = 7;
+	const GLuint ATTRIB_INSTANCE_TEXTURE = 8;	// UV scale, texture layer and array index
+	const GLuint ATTRIB_INSTANCE_MATERIAL = 9;
+
+	const float PI = 3.14159265358979f;
+
+	// append one interleaved vertex to the vertex list
+	void AddVertex(
+		std::vector<GLfloat>& vertices,
+		float x, float y, float z,
+		float nx, float ny, float nz,
+		float u, float v)
+	{
+		vertices.push_back(x);
+		vertices.push_back(y);
+		vertices.push_back(z);
+		vertices.push_back(nx);
+		vertices.push_back(ny);
+		vertices.push_back(nz);
+		vertices.push_back(u);
+		vertices.push_back(v);
+	}
+}
+
+/***********************************************************
+ *  MeshLibrary()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshLibrary::MeshLibrary()
+{
+	for (int i = 0; i < MESH_TYPE_COUNT; i++)
+	{
+		for (int lod = 0; lod < LOD_COUNT; lod++)
+		{
+			m_meshes[i][lod].firstIndex = 0;
+			m_meshes[i][lod].indexCount = 0;
+			m_meshes[i][lod].baseVertex = 0;
+			m_meshes[i][lod].boundsMin = glm::vec3(0.0f);
+			m_meshes[i][lod].boundsMax = glm::vec3(0.0f);
+		}
+	}
+	m_vao = 0;
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_instanceBuffer = 0;
+	m_instanceCapacity = 0;
+	m_commandBuffer = 0;
+	m_commandCapacity = 0;
+	m_pStateCache = NULL;
+}
+
+/***********************************************************
+ *  ~MeshLibrary()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshLibrary::~MeshLibrary()
+{
+	DestroyMeshes();
+}
+
+/***********************************************************
+ *  LoadMesh()
+ *
+ *  This method is used for making sure that the passed in
+ *  mesh type can be drawn.  The meshes share their buffers,
+ *  so the first call generates all of them at once - they
+ *  are small, and the shared buffers never have to grow.
+ ***********************************************************/
+bool MeshLibrary::LoadMesh(int mesh)
+{
+	if ((mesh < 0) || (mesh >= MESH_TYPE_COUNT))
+	{
+		std::cout << "Could not load mesh: unknown mesh type " << mesh << std::endl;
+		return(false);
+	}
+
+	// the meshes only need to be generated once
+	if (m_vao != 0)
+	{
+		return(true);
+	}
+
+	return(BuildMeshBuffers());
+}
+
+/***********************************************************
+ *  BuildMeshBuffers()
+ *
+ *  This method is used for generating the geometry of every
+ *  level of detail of every mesh type into one vertex list
+ *  and one index list, recording where each mesh starts, and
+ *  uploading both lists to the GPU.  The plane has no round
+ *  edges, so all of its levels share the same geometry.  The
+ *  indices of each mesh count from its own first vertex,
+ *  which the draws pass on as the base vertex.  The vertex
+ *  array reads the vertex data from binding 0 and the
+ *  per-instance data from binding 1, which advances once per
+ *  instance.
+ ***********************************************************/
+bool MeshLibrary::BuildMeshBuffers()
+{
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+
+	for (int mesh = 0; mesh < MESH_TYPE_COUNT; mesh++)
+	{
+		for (int lod = 0; lod < LOD_COUNT; lod++)
+		{
+			std::vector<GLfloat> meshVertices;
+			std::vector<GLuint> meshIndices;
+			GL_MESH& glMesh = m_meshes[mesh][lod];
+
+			if ((mesh == MESH_PLANE) && (lod > 0))
+			{
+				glMesh = m_meshes[mesh][0];
+				continue;
+			}
+
+			switch (mesh)
+			{
+			case MESH_PLANE:
+				BuildPlane(meshVertices, meshIndices);
+				glMesh.boundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+				glMesh.boundsMax = glm::vec3(1.0f, 0.0f, 1.0f);
+				break;
+			case MESH_CYLINDER:
+				BuildCylinder(meshVertices, meshIndices, 1.0f, LOD_SLICES[lod]);
+				glMesh.boundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+				glMesh.boundsMax = glm::vec3(1.0f, 1.0f, 1.0f);
+				break;
+			case MESH_TAPERED_CYLINDER:
+				BuildCylinder(meshVertices, meshIndices, 0.5f, LOD_SLICES[lod]);
+				glMesh.boundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+				glMesh.boundsMax = glm::vec3(1.0f, 1.0f, 1.0f);
+				break;
+			case MESH_CONE:
+				BuildCone(meshVertices, meshIndices, LOD_SLICES[lod]);
+				glMesh.boundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+				glMesh.boundsMax = glm::vec3(1.0f, 1.0f, 1.0f);
+				break;
+			}
+
+			glMesh.firstIndex = (GLuint)indices.size();
+			glMesh.indexCount = (GLsizei)meshIndices.size();
+			glMesh.baseVertex = (GLint)(vertices.size() / FLOATS_PER_VERTEX);
+			vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+			indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+		}
+	}
+
+	glCreateBuffers(1, &m_vertexBuffer);
+	glNamedBufferStorage(m_vertexBuffer, vertices.size() * sizeof(GLfloat), vertices.data(), 0);
+	glCreateBuffers(1, &m_indexBuffer);
+	glNamedBufferStorage(m_indexBuffer, indices.size() * sizeof(GLuint), indices.data(), 0);
+
+	glCreateVertexArrays(1, &m_vao);
+	glVertexArrayVertexBuffer(m_vao, VERTEX_BINDING, m_vertexBuffer, 0, FLOATS_PER_VERTEX * sizeof(GLfloat));
+	glVertexArrayElementBuffer(m_vao, m_indexBuffer);
+
+	// position, normal and texture coordinate from the vertex buffer
+	glEnableVertexArrayAttrib(m_vao, ATTRIB_POSITION);
+	glVertexArrayAttribFormat(m_vao, ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexArrayAttribBinding(m_vao, ATTRIB_POSITION, VERTEX_BINDING);
+	glEnableVertexArrayAttrib(m_vao, ATTRIB_NORMAL);
+	glVertexArrayAttribFormat(m_vao, ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat));
+	glVertexArrayAttribBinding(m_vao, ATTRIB_NORMAL, VERTEX_BINDING);
+	glEnableVertexArrayAttrib(m_vao, ATTRIB_TEXCOORD);
+	glVertexArrayAttribFormat(m_vao, ATTRIB_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat));
+	glVertexArrayAttribBinding(m_vao, ATTRIB_TEXCOORD, VERTEX_BINDING);
+
+	// the model matrix takes one attribute location per column
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glEnableVertexArrayAttrib(m_vao, ATTRIB_INSTANCE_MODEL + column);
+		glVertexArrayAttribFormat(m_vao, ATTRIB_INSTANCE_MODEL + column, 4, GL_FLOAT, GL_FALSE,
+			(GLuint)(offsetof(INSTANCE_DATA, model) + column * sizeof(glm::vec4)));
+		glVertexArrayAttribBinding(m_vao, ATTRIB_INSTANCE_MODEL + column, INSTANCE_BINDING);
+	}
+	glEnableVertexArrayAttrib(m_vao, ATTRIB_INSTANCE_COLOR);
+	glVertexArrayAttribFormat(m_vao, ATTRIB_INSTANCE_COLOR, 4, GL_FLOAT, GL_FALSE, (GLuint)offsetof(INSTANCE_DATA, color));
+	glVertexArrayAttribBinding(m_vao, ATTRIB_INSTANCE_COLOR, INSTANCE_BINDING);
+	glEnableVertexArrayAttrib(m_vao, ATTRIB_INSTANCE_TEXTURE);
+	glVertexArrayAttribFormat(m_vao, ATTRIB_INSTANCE_TEXTURE, 4, GL_FLOAT, GL_FALSE, (GLuint)offsetof(INSTANCE_DATA, uvScale));
+	glVertexArrayAttribBinding(m_vao, ATTRIB_INSTANCE_TEXTURE, INSTANCE_BINDING);
+	glEnableVertexArrayAttrib(m_vao, ATTRIB_INSTANCE_MATERIAL);
+	glVertexArrayAttribFormat(m_vao, ATTRIB_INSTANCE_MATERIAL, 1, GL_FLOAT, GL_FALSE, (GLuint)offsetof(INSTANCE_DATA, materialIndex));
+	glVertexArrayAttribBinding(m_vao, ATTRIB_INSTANCE_MATERIAL, INSTANCE_BINDING);
+	glVertexArrayBindingDivisor(m_vao, INSTANCE_BINDING, 1);
+
+	glVertexArrayVertexBuffer(m_vao, INSTANCE_BINDING, m_instanceBuffer, 0, sizeof(INSTANCE_DATA));
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyMeshes()
+ *
+ *  This method is used for freeing the shared vertex array
+ *  and mesh buffers, the instance buffer and the command
+ *  buffer.
+ ***********************************************************/
+void MeshLibrary::DestroyMeshes()
+{
+	if (m_vao != 0)
+	{
+		if (NULL != m_pStateCache)
+		{
+			// a deleted name can be reused by a new vertex array
+			m_pStateCache->Invalidate();
+		}
+		glDeleteVertexArrays(1, &m_vao);
+		glDeleteBuffers(1, &m_vertexBuffer);
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_vao = 0;
+		m_vertexBuffer = 0;
+		m_indexBuffer = 0;
+		for (int i = 0; i < MESH_TYPE_COUNT; i++)
+		{
+			for (int lod = 0; lod < LOD_COUNT; lod++)
+			{
+				m_meshes[i][lod].indexCount = 0;
+			}
+		}
+	}
+	if (m_instanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_instanceBuffer = 0;
+		m_instanceCapacity = 0;
+	}
+	if (m_commandBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_commandBuffer);
+		m_commandBuffer = 0;
+		m_commandCapacity = 0;
+	}
+}
+
+/***********************************************************
+ *  SetInstanceData()
+ *
+ *  This method is used for uploading the instance data for
+ *  all of the instanced draws of a frame.  The buffer only
+ *  grows, and when it is replaced the vertex array is
+ *  pointed at the new buffer.
+ ***********************************************************/
+void MeshLibrary::SetInstanceData(const INSTANCE_DATA* instances, int instanceCount)
+{
+	if (instanceCount <= 0)
+	{
+		return;
+	}
+
+	ReserveInstances(instanceCount);
+	glNamedBufferSubData(m_instanceBuffer, 0, instanceCount * sizeof(INSTANCE_DATA), instances);
+}
+
+/***********************************************************
+ *  ReserveInstances()
+ *
+ *  This method is used for growing the instance buffer to
+ *  hold at least the passed in number of instances.  The
+ *  contents are lost when the buffer grows.
+ ***********************************************************/
+void MeshLibrary::ReserveInstances(int instanceCount)
+{
+	if (instanceCount <= m_instanceCapacity)
+	{
+		return;
+	}
+
+	if (m_instanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_instanceBuffer);
+	}
+	glCreateBuffers(1, &m_instanceBuffer);
+	glNamedBufferData(m_instanceBuffer, instanceCount * sizeof(INSTANCE_DATA), NULL, GL_DYNAMIC_DRAW);
+	m_instanceCapacity = instanceCount;
+
+	if (m_vao != 0)
+	{
+		glVertexArrayVertexBuffer(m_vao, INSTANCE_BINDING, m_instanceBuffer, 0, sizeof(INSTANCE_DATA));
+	}
+}
+
+/***********************************************************
+ *  DrawMeshInstanced()
+ *
+ *  This method is used for drawing a range of the instance
+ *  buffer with one level of detail of the passed in mesh in
+ *  a single draw call.
+ ***********************************************************/
+void MeshLibrary::DrawMeshInstanced(int mesh, int lod, int firstInstance, int instanceCount)
+{
+	if ((mesh < 0) || (mesh >= MESH_TYPE_COUNT) ||
+		(lod < 0) || (lod >= LOD_COUNT) ||
+		(m_vao == 0) || (instanceCount <= 0))
+	{
+		return;
+	}
+
+	BindVertexArray();
+	glDrawElementsInstancedBaseVertexBaseInstance(
+		GL_TRIANGLES,
+		m_meshes[mesh][lod].indexCount,
+		GL_UNSIGNED_INT,
+		(const void*)(m_meshes[mesh][lod].firstIndex * sizeof(GLuint)),
+		instanceCount,
+		m_meshes[mesh][lod].baseVertex,
+		(GLuint)firstInstance);
+}
+
+/***********************************************************
+ *  MakeDrawCommand()
+ *
+ *  This method is used for filling in the indirect command
+ *  that draws a range of the instance buffer with one level
+ *  of detail of the passed in mesh, using the offsets of the
+ *  mesh in the shared buffers.
+ ***********************************************************/
+void MeshLibrary::MakeDrawCommand(int mesh, int lod, int firstInstance, int instanceCount, DRAW_COMMAND& command) const
+{
+	const GL_MESH& glMesh = m_meshes[mesh][lod];
+
+	command.count = (GLuint)glMesh.indexCount;
+	command.instanceCount = (GLuint)instanceCount;
+	command.firstIndex = glMesh.firstIndex;
+	command.baseVertex = glMesh.baseVertex;
+	command.baseInstance = (GLuint)firstInstance;
+}
+
+/***********************************************************
+ *  SetDrawCommands()
+ *
+ *  This method is used for uploading the indirect draw
+ *  commands of a frame.  Like the instance buffer, the
+ *  command buffer only grows.
+ ***********************************************************/
+void MeshLibrary::SetDrawCommands(const DRAW_COMMAND* commands, int commandCount)
+{
+	if (commandCount <= 0)
+	{
+		return;
+	}
+
+	if (commandCount > m_commandCapacity)
+	{
+		if (m_commandBuffer != 0)
+		{
+			glDeleteBuffers(1, &m_commandBuffer);
+		}
+		glCreateBuffers(1, &m_commandBuffer);
+		glNamedBufferData(m_commandBuffer, commandCount * sizeof(DRAW_COMMAND), commands, GL_DYNAMIC_DRAW);
+		m_commandCapacity = commandCount;
+	}
+	else
+	{
+		glNamedBufferSubData(m_commandBuffer, 0, commandCount * sizeof(DRAW_COMMAND), commands);
+	}
+}
+
+/***********************************************************
+ *  DrawIndirect()
+ *
+ *  This method is used for issuing a range of the command
+ *  buffer with one multi-draw call.  The commands are drawn
+ *  in order, so sorted commands keep their order.
+ ***********************************************************/
+void MeshLibrary::DrawIndirect(int firstCommand, int commandCount)
+{
+	if ((m_vao == 0) || (m_commandBuffer == 0) || (commandCount <= 0))
+	{
+		return;
+	}
+
+	BindVertexArray();
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glMultiDrawElementsIndirect(
+		GL_TRIANGLES,
+		GL_UNSIGNED_INT,
+		(const void*)(firstCommand * sizeof(DRAW_COMMAND)),
+		commandCount,
+		0);
+}
+
+/***********************************************************
+ *  BindVertexArray()
+ *
+ *  This method is used for binding the shared vertex array,
+ *  through the state cache when there is one.
+ ***********************************************************/
+void MeshLibrary::BindVertexArray()
+{
+	if (NULL != m_pStateCache)
+	{
+		m_pStateCache->BindVertexArray(m_vao);
+	}
+	else
+	{
+		glBindVertexArray(m_vao);
+	}
+}
+
+/***********************************************************
+ *  BuildPlane()
+ *
+ *  This method is used for building a flat plane that spans
+ *  -1 to 1 on the X and Z axes and faces up the Y axis.
+ ***********************************************************/
+void MeshLibrary::BuildPlane(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices)
+{
+	AddVertex(vertices, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f);
+	AddVertex(vertices, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f);
+	AddVertex(vertices, 1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f);
+	AddVertex(vertices, -1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f);
+
+	indices.push_back(0);
+	indices.push_back(1);
+	indices.push_back(2);
+	indices.push_back(0);
+	indices.push_back(2);
+	indices.push_back(3);
+}
+
+/***********************************************************
+ *  BuildCylinder()
+ *
+ *  This method is used for building a capped cylinder with
+ *  a bottom radius of 1 at Y 0 and the passed in top radius
+ *  at Y 1, with the passed in number of segments around it.
+ *  A top radius below 1 gives a tapered cylinder.
+ ***********************************************************/
+void MeshLibrary::BuildCylinder(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, float topRadius, int slices)
+{
+	// the side normals lean outwards by the taper of the sides
+	float slope = 1.0f - topRadius;
+	float normalLength = std::sqrt(1.0f + slope * slope);
+
+	GLuint firstVertex = (GLuint)(vertices.size() / FLOATS_PER_VERTEX);
+	for (int i = 0; i <= slices; i++)
+	{
+		float u = (float)i / (float)slices;
+		float x = std::cos(u * 2.0f * PI);
+		float z = std::sin(u * 2.0f * PI);
+		float nx = x / normalLength;
+		float ny = slope / normalLength;
+		float nz = z / normalLength;
+
+		AddVertex(vertices, x, 0.0f, z, nx, ny, nz, u, 0.0f);
+		AddVertex(vertices, x * topRadius, 1.0f, z * topRadius, nx, ny, nz, u, 1.0f);
+	}
+	for (int i = 0; i < slices; i++)
+	{
+		GLuint bottom = firstVertex + i * 2;
+		indices.push_back(bottom);
+		indices.push_back(bottom + 1);
+		indices.push_back(bottom + 3);
+		indices.push_back(bottom);
+		indices.push_back(bottom + 3);
+		indices.push_back(bottom + 2);
+	}
+
+	BuildCap(vertices, indices, 0.0f, 1.0f, false, slices);
+	BuildCap(vertices, indices, 1.0f, topRadius, true, slices);
+}
+
+/***********************************************************
+ *  BuildCone()
+ *
+ *  This method is used for building a cone with a base
+ *  radius of 1 at Y 0 and its tip at Y 1, with the passed in
+ *  number of segments around it.
+ ***********************************************************/
+void MeshLibrary::BuildCone(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, int slices)
+{
+	float normalLength = std::sqrt(2.0f);
+
+	// each slice has its own tip vertex so the texture
+	// coordinates and normals follow the slice
+	GLuint firstVertex = (GLuint)(vertices.size() / FLOATS_PER_VERTEX);
+	for (int i = 0; i <= slices; i++)
+	{
+		float u = (float)i / (float)slices;
+		float x = std::cos(u * 2.0f * PI);
+		float z = std::sin(u * 2.0f * PI);
+		float nx = x / normalLength;
+		float ny = 1.0f / normalLength;
+		float nz = z / normalLength;
+
+		AddVertex(vertices, x, 0.0f, z, nx, ny, nz, u, 0.0f);
+		AddVertex(vertices, 0.0f, 1.0f, 0.0f, nx, ny, nz, u, 1.0f);
+	}
+	for (int i = 0; i < slices; i++)
+	{
+		GLuint bottom = firstVertex + i * 2;
+		indices.push_back(bottom);
+		indices.push_back(bottom + 1);
+		indices.push_back(bottom + 2);
+	}
+
+	BuildCap(vertices, indices, 0.0f, 1.0f, false, slices);
+}
+
+/***********************************************************
+ *  BuildCap()
+ *
+ *  This method is used for building a flat round cap at the
+ *  passed in height, facing either up or down.
+ ***********************************************************/
+void MeshLibrary::BuildCap(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, float y, float radius, bool bFacingUp, int slices)
+{
+	float ny = bFacingUp ? 1.0f : -1.0f;
+
+	GLuint center = (GLuint)(vertices.size() / FLOATS_PER_VERTEX);
+	AddVertex(vertices, 0.0f, y, 0.0f, 0.0f, ny, 0.0f, 0.5f, 0.5f);
+	for (int i = 0; i <= slices; i++)
+	{
+		float angle = ((float)i / (float)slices) * 2.0f * PI;
+		float x = std::cos(angle);
+		float z = std::sin(angle);
+
+		AddVertex(vertices, x * radius, y, z * radius, 0.0f, ny, 0.0f, 0.5f + 0.5f * x, 0.5f + 0.5f * z);
+	}
+	for (int i = 0; i < slices; i++)
+	{
+		GLuint edge = center + 1 + i;
+		indices.push_back(center);
+		if (bFacingUp)
+		{
+			indices.push_back(edge + 1);
+			indices.push_back(edge);
+		}
+		else
+		{
+			indices.push_back(edge);
+			indices.push_back(edge + 1);
+		}
+	}
+}
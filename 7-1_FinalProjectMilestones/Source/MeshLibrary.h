@@ -0,0 +1,160 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshlibrary.h
+// ============
+// generate the basic shape meshes and draw them with hardware instancing
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLStateCache.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  MeshLibrary
+ *
+ *  This class generates the same basic shapes as the
+ *  ShapeMeshes class (plane, cylinder, tapered cylinder and
+ *  cone), each at several levels of detail, and packs all of
+ *  them into one shared vertex buffer and one shared index
+ *  buffer, with a table of where each mesh starts.  A single
+ *  vertex array reads the vertices and, for every instance,
+ *  a model matrix, color and surface values from one shared
+ *  instance buffer.  Any number of copies of a mesh can be
+ *  drawn with a single instanced draw call, and any number
+ *  of those draws can be issued with one multi-draw call
+ *  from a buffer of indirect draw commands.
+ ***********************************************************/
+class MeshLibrary
+{
+public:
+	// constructor
+	MeshLibrary();
+	// destructor
+	~MeshLibrary();
+
+	// basic meshes that scene objects can reference by name
+	enum MESH_TYPE
+	{
+		MESH_PLANE = 0,
+		MESH_CYLINDER,
+		MESH_TAPERED_CYLINDER,
+		MESH_CONE,
+		MESH_TYPE_COUNT
+	};
+
+	// number of levels of detail generated for every mesh -
+	// level 0 is the full tessellation, and each further level
+	// has fewer segments around the round shapes
+	static const int LOD_COUNT = 3;
+
+	// per-instance values read by the vertex shader - the
+	// color is the texture tint for textured instances and
+	// the object color for untextured ones, the array index
+	// and layer select the texture (an array index of -1
+	// means untextured), and the material index selects the
+	// entry of the material table
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		glm::vec2 uvScale;
+		float textureLayer;
+		float textureArray;
+		float materialIndex;
+		float padding[3];
+	};
+
+	// layout of one indirect indexed draw command, as read by
+	// glMultiDrawElementsIndirect()
+	struct DRAW_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// make sure a mesh is in the shared mesh buffers - the
+	// first call generates every mesh
+	bool LoadMesh(int mesh);
+	// free all of the loaded meshes and the instance buffer
+	void DestroyMeshes();
+
+	// set the state cache used for binding the vertex arrays
+	void SetStateCache(GLStateCache* pStateCache) { m_pStateCache = pStateCache; }
+
+	// replace the contents of the shared instance buffer
+	void SetInstanceData(const INSTANCE_DATA* instances, int instanceCount);
+	// make room for a number of instances in the instance
+	// buffer, for instance data written on the GPU
+	void ReserveInstances(int instanceCount);
+	// draw a range of the instance buffer with one level of
+	// detail of a mesh
+	void DrawMeshInstanced(int mesh, int lod, int firstInstance, int instanceCount);
+
+	// fill in the command that draws a range of the instance
+	// buffer with one level of detail of a mesh
+	void MakeDrawCommand(int mesh, int lod, int firstInstance, int instanceCount, DRAW_COMMAND& command) const;
+	// replace the contents of the indirect command buffer
+	void SetDrawCommands(const DRAW_COMMAND* commands, int commandCount);
+	// issue a range of the indirect command buffer with one call
+	void DrawIndirect(int firstCommand, int commandCount);
+
+	// the instance and indirect command buffers, so they can
+	// be filled in by a compute shader
+	GLuint GetInstanceBuffer() const { return(m_instanceBuffer); }
+	GLuint GetCommandBuffer() const { return(m_commandBuffer); }
+
+	// local space bounding box of a mesh, the same at every
+	// level of detail
+	const glm::vec3& GetBoundsMin(int mesh) const { return(m_meshes[mesh][0].boundsMin); }
+	const glm::vec3& GetBoundsMax(int mesh) const { return(m_meshes[mesh][0].boundsMax); }
+	// number of triangles in one level of detail of a mesh
+	int GetTriangleCount(int mesh, int lod) const { return(m_meshes[mesh][lod].indexCount / 3); }
+
+private:
+	// where a mesh lives in the shared mesh buffers
+	struct GL_MESH
+	{
+		GLuint firstIndex;
+		GLsizei indexCount;
+		GLint baseVertex;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	// mesh offsets indexed by mesh type and level of detail
+	GL_MESH m_meshes[MESH_TYPE_COUNT][LOD_COUNT];
+	// vertex array and buffers shared by all of the meshes
+	GLuint m_vao;
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	// buffer holding the instance data for every instanced draw
+	GLuint m_instanceBuffer;
+	// number of instances the instance buffer can hold
+	int m_instanceCapacity;
+	// buffer holding the indirect draw commands
+	GLuint m_commandBuffer;
+	// number of commands the command buffer can hold
+	int m_commandCapacity;
+	// state cache used for binding the vertex arrays
+	GLStateCache* m_pStateCache;
+
+	// generate every mesh into the shared mesh buffers and
+	// set up the vertex array
+	bool BuildMeshBuffers();
+	// bind the shared vertex array
+	void BindVertexArray();
+
+	// build the interleaved position/normal/uv vertices and the
+	// triangle indices for each shape
+	static void BuildPlane(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices);
+	static void BuildCylinder(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, float topRadius, int slices);
+	static void BuildCone(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, int slices);
+	static void BuildCap(std::vector<GLfloat>& vertices, std::vector<GLuint>& indices, float y, float radius, bool bFacingUp, int slices);
+};
@@ -0,0 +1,410 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderbenchmark.cpp
+// ============
+// render the scene offscreen along a scripted camera path and report frame times
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderBenchmark.h"
+#include "FrameProfiler.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// default number of measured frames, and of frames drawn
+	// first so that the caches and drivers settle
+	const int DEFAULT_FRAME_COUNT = 600;
+	const int DEFAULT_WARMUP_FRAMES = 30;
+	// default size of the offscreen framebuffer, the same as
+	// the display window
+	const int DEFAULT_WIDTH = 1000;
+	const int DEFAULT_HEIGHT = 800;
+
+	// the camera circles the basket once over the measured
+	// frames, moving in and out twice and up and down once
+	const glm::vec3 PATH_TARGET = glm::vec3(0.0f, 4.0f, 0.0f);
+	const float PATH_MID_DISTANCE = 20.0f;
+	const float PATH_DISTANCE_RANGE = 10.0f;
+	const float PATH_MID_HEIGHT = 7.0f;
+	const float PATH_HEIGHT_RANGE = 3.0f;
+	// projection of the default perspective view
+	const float CAMERA_ZOOM = 80.0f;
+	const float NEAR_PLANE = 0.1f;
+	const float FAR_PLANE = 100.0f;
+
+	const float PI = 3.14159265358979f;
+
+	typedef std::chrono::steady_clock BenchmarkClock;
+
+	// milliseconds between two clock readings
+	double ElapsedMilliseconds(BenchmarkClock::time_point start, BenchmarkClock::time_point end)
+	{
+		return(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	// quote a string for the JSON report
+	std::string QuoteJSON(const std::string& text)
+	{
+		std::string quoted = "\"";
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			char c = text[i];
+			if ((c == '"') || (c == '\\'))
+			{
+				quoted += '\\';
+				quoted += c;
+			}
+			else if ((unsigned char)c >= 0x20)
+			{
+				quoted += c;
+			}
+		}
+		quoted += "\"";
+		return(quoted);
+	}
+}
+
+/***********************************************************
+ *  RenderBenchmark()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderBenchmark::RenderBenchmark(
+	SceneManager* pSceneManager,
+	UniformBuffers* pUniformBuffers,
+	GLStateCache* pStateCache)
+{
+	m_pSceneManager = pSceneManager;
+	m_pUniformBuffers = pUniformBuffers;
+	m_pStateCache = pStateCache;
+	m_pViewManager = NULL;
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+}
+
+/***********************************************************
+ *  ~RenderBenchmark()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderBenchmark::~RenderBenchmark()
+{
+	DestroyFramebuffer();
+	m_pSceneManager = NULL;
+	m_pUniformBuffers = NULL;
+	m_pStateCache = NULL;
+	m_pViewManager = NULL;
+}
+
+/***********************************************************
+ *  GetDefaultSettings()
+ *
+ *  This method is used for filling in the settings that are
+ *  used when the command line does not change them.
+ ***********************************************************/
+void RenderBenchmark::GetDefaultSettings(BENCHMARK_SETTINGS& settings)
+{
+	settings.frameCount = DEFAULT_FRAME_COUNT;
+	settings.warmupFrames = DEFAULT_WARMUP_FRAMES;
+	settings.width = DEFAULT_WIDTH;
+	settings.height = DEFAULT_HEIGHT;
+	settings.sceneName.clear();
+	settings.outputFilename.clear();
+	settings.cameraRecording.clear();
+	settings.bGPUCulling = false;
+	settings.bBindlessTextures = false;
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for rendering the warm up frames and
+ *  then the measured frames into the offscreen framebuffer.
+ *  The CPU time of a frame ends when the scene has been
+ *  submitted, and the frame time ends after glFinish(), which
+ *  takes the place of the buffer swap.  The counters of the
+ *  measured frames are added up for the report.
+ ***********************************************************/
+bool RenderBenchmark::Run(GLuint programID, const BENCHMARK_SETTINGS& settings)
+{
+	std::vector<double> cpuTimes;
+	std::vector<double> frameTimes;
+	COUNTER_TOTALS totals;
+	float aspectRatio = (float)settings.width / (float)settings.height;
+
+	if ((settings.frameCount <= 0) || (CreateFramebuffer(settings.width, settings.height) == false))
+	{
+		return(false);
+	}
+
+	totals.drawCalls = 0;
+	totals.drawCommands = 0;
+	totals.instances = 0;
+	totals.triangles = 0;
+	cpuTimes.reserve(settings.frameCount);
+	frameTimes.reserve(settings.frameCount);
+
+	std::cout << "INFO: Benchmark rendering " << settings.warmupFrames << " warm up and "
+		<< settings.frameCount << " measured frames at " << settings.width << "x" << settings.height << std::endl;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, settings.width, settings.height);
+
+	for (int frame = -settings.warmupFrames; frame < settings.frameCount; frame++)
+	{
+		PROFILE_BEGIN_FRAME();
+		BenchmarkClock::time_point frameStart = BenchmarkClock::now();
+
+		m_pStateCache->BeginFrame();
+		m_pStateCache->UseProgram(programID);
+		m_pStateCache->Enable(GL_DEPTH_TEST);
+		m_pStateCache->SetClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// the warm up frames follow the start of the path, and
+		// the playback starts over for the measured frames
+		if (NULL != m_pViewManager)
+		{
+			if (frame == 0)
+			{
+				m_pViewManager->RestartPlayback();
+			}
+			m_pViewManager->PrepareSceneView();
+			m_pSceneManager->SetCameraView(
+				m_pViewManager->GetViewMatrix(),
+				m_pViewManager->GetProjectionMatrix());
+		}
+		else
+		{
+			SetCameraPath(std::max(frame, 0), settings.frameCount, aspectRatio);
+		}
+		{
+			PROFILE_GPU_SCOPE("Render scene");
+			m_pSceneManager->RenderScene();
+		}
+
+		BenchmarkClock::time_point submitEnd = BenchmarkClock::now();
+		{
+			PROFILE_SCOPE("Finish frame");
+			glFinish();
+		}
+		BenchmarkClock::time_point frameEnd = BenchmarkClock::now();
+		PROFILE_END_FRAME();
+
+		if (frame >= 0)
+		{
+			const SceneManager::FRAME_STATS& stats = m_pSceneManager->GetFrameStats();
+
+			cpuTimes.push_back(ElapsedMilliseconds(frameStart, submitEnd));
+			frameTimes.push_back(ElapsedMilliseconds(frameStart, frameEnd));
+			totals.drawCalls += stats.drawCalls;
+			totals.drawCommands += stats.drawCommands;
+			totals.instances += stats.instances;
+			totals.triangles += stats.triangles;
+		}
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	DestroyFramebuffer();
+
+	return(WriteReport(settings, Summarize(cpuTimes), Summarize(frameTimes), totals));
+}
+
+/***********************************************************
+ *  CreateFramebuffer()
+ *
+ *  This method is used for creating the offscreen framebuffer
+ *  with a color and a depth attachment of the passed in size.
+ ***********************************************************/
+bool RenderBenchmark::CreateFramebuffer(int width, int height)
+{
+	DestroyFramebuffer();
+
+	glCreateRenderbuffers(1, &m_colorBuffer);
+	glNamedRenderbufferStorage(m_colorBuffer, GL_RGBA8, width, height);
+	glCreateRenderbuffers(1, &m_depthBuffer);
+	glNamedRenderbufferStorage(m_depthBuffer, GL_DEPTH_COMPONENT24, width, height);
+
+	glCreateFramebuffers(1, &m_framebuffer);
+	glNamedFramebufferRenderbuffer(m_framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glNamedFramebufferRenderbuffer(m_framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+
+	GLenum status = glCheckNamedFramebufferStatus(m_framebuffer, GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Could not create the benchmark framebuffer: status 0x" << std::hex << status << std::dec << std::endl;
+		DestroyFramebuffer();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyFramebuffer()
+ *
+ *  This method is used for freeing the offscreen framebuffer
+ *  and its attachments.
+ ***********************************************************/
+void RenderBenchmark::DestroyFramebuffer()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_colorBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		m_colorBuffer = 0;
+	}
+	if (m_depthBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  SetCameraPath()
+ *
+ *  This method is used for placing the camera of a frame on
+ *  the scripted path and passing its matrices to the shaders
+ *  and the scene.  The position only depends on the frame
+ *  number, not on the time, so slow frames see the same
+ *  views as fast ones.
+ ***********************************************************/
+void RenderBenchmark::SetCameraPath(int frame, int frameCount, float aspectRatio)
+{
+	float angle = ((float)frame / (float)frameCount) * 2.0f * PI;
+	float distance = PATH_MID_DISTANCE + PATH_DISTANCE_RANGE * std::cos(angle * 2.0f);
+	float height = PATH_MID_HEIGHT + PATH_HEIGHT_RANGE * std::sin(angle);
+	glm::vec3 position = PATH_TARGET + glm::vec3(distance * std::sin(angle), height, distance * std::cos(angle));
+
+	glm::mat4 view = glm::lookAt(position, PATH_TARGET, glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(CAMERA_ZOOM), aspectRatio, NEAR_PLANE, FAR_PLANE);
+
+	UniformBuffers::FRAME_DATA frameData;
+	frameData.view = view;
+	frameData.projection = projection;
+	frameData.viewPosition = glm::vec4(position, 1.0f);
+	m_pUniformBuffers->UpdateFrameData(frameData);
+
+	m_pSceneManager->SetCameraView(view, projection);
+}
+
+/***********************************************************
+ *  Summarize()
+ *
+ *  This method is used for finding the average and the
+ *  nearest rank percentiles of a list of frame times.
+ ***********************************************************/
+RenderBenchmark::TIME_SUMMARY RenderBenchmark::Summarize(std::vector<double> times)
+{
+	TIME_SUMMARY summary;
+	double total = 0.0;
+
+	summary.average = 0.0;
+	summary.p50 = 0.0;
+	summary.p95 = 0.0;
+	summary.p99 = 0.0;
+	if (times.empty())
+	{
+		return(summary);
+	}
+
+	std::sort(times.begin(), times.end());
+	for (size_t i = 0; i < times.size(); i++)
+	{
+		total += times[i];
+	}
+
+	// the smallest time that the percentage of frames are at
+	// or below
+	const double percents[3] = { 50.0, 95.0, 99.0 };
+	double* results[3] = { &summary.p50, &summary.p95, &summary.p99 };
+	for (int i = 0; i < 3; i++)
+	{
+		size_t rank = (size_t)std::ceil(percents[i] / 100.0 * (double)times.size());
+		*results[i] = times[std::max(rank, (size_t)1) - 1];
+	}
+	summary.average = total / (double)times.size();
+
+	return(summary);
+}
+
+/***********************************************************
+ *  WriteReport()
+ *
+ *  This method is used for writing the results as one JSON
+ *  object, either to the output file or to the standard
+ *  output.  The counters are averaged per frame.  Triangles
+ *  are only counted when the CPU culls the objects, so the
+ *  value is null on the GPU culling path.
+ ***********************************************************/
+bool RenderBenchmark::WriteReport(
+	const BENCHMARK_SETTINGS& settings,
+	const TIME_SUMMARY& cpuTimes,
+	const TIME_SUMMARY& frameTimes,
+	const COUNTER_TOTALS& totals)
+{
+	std::ostringstream report;
+	double frameCount = (double)settings.frameCount;
+	const char* renderer = (const char*)glGetString(GL_RENDERER);
+
+	report << std::fixed << std::setprecision(3);
+	report << "{\n";
+	report << "\t\"scene\": " << QuoteJSON(settings.sceneName) << ",\n";
+	report << "\t\"renderer\": " << QuoteJSON((NULL != renderer) ? renderer : "") << ",\n";
+	report << "\t\"width\": " << settings.width << ",\n";
+	report << "\t\"height\": " << settings.height << ",\n";
+	report << "\t\"frames\": " << settings.frameCount << ",\n";
+	report << "\t\"warmupFrames\": " << settings.warmupFrames << ",\n";
+	report << "\t\"camera\": " << (settings.cameraRecording.empty() ? "\"scripted\"" : QuoteJSON(settings.cameraRecording)) << ",\n";
+	report << "\t\"culling\": " << (settings.bGPUCulling ? "\"gpu\"" : "\"cpu\"") << ",\n";
+	report << "\t\"textures\": " << (settings.bBindlessTextures ? "\"bindless\"" : "\"units\"") << ",\n";
+	report << "\t\"cpuFrameMs\": { \"average\": " << cpuTimes.average << ", \"p50\": " << cpuTimes.p50
+		<< ", \"p95\": " << cpuTimes.p95 << ", \"p99\": " << cpuTimes.p99 << " },\n";
+	report << "\t\"frameMs\": { \"average\": " << frameTimes.average << ", \"p50\": " << frameTimes.p50
+		<< ", \"p95\": " << frameTimes.p95 << ", \"p99\": " << frameTimes.p99 << " },\n";
+	report << "\t\"drawCallsPerFrame\": " << (double)totals.drawCalls / frameCount << ",\n";
+	report << "\t\"drawCommandsPerFrame\": " << (double)totals.drawCommands / frameCount << ",\n";
+	report << "\t\"instancesPerFrame\": " << (double)totals.instances / frameCount << ",\n";
+	report << "\t\"trianglesPerFrame\": ";
+	if (settings.bGPUCulling)
+	{
+		report << "null\n";
+	}
+	else
+	{
+		report << (double)totals.triangles / frameCount << "\n";
+	}
+	report << "}\n";
+
+	if (settings.outputFilename.empty())
+	{
+		std::cout << report.str() << std::flush;
+		return(true);
+	}
+
+	std::ofstream file(settings.outputFilename);
+	if (!file)
+	{
+		std::cout << "Could not write the benchmark report:" << settings.outputFilename << std::endl;
+		return(false);
+	}
+	file << report.str();
+	std::cout << "INFO: Benchmark report written to " << settings.outputFilename << std::endl;
+
+	return(file.good());
+}
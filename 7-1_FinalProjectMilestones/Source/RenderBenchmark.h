@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderbenchmark.h
+// ============
+// render the scene offscreen along a scripted camera path and report frame times
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLStateCache.h"
+#include "SceneManager.h"
+#include "UniformBuffers.h"
+#include "ViewManager.h"
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  RenderBenchmark
+ *
+ *  This class renders a prepared scene into an offscreen
+ *  framebuffer for a fixed number of frames, with the camera
+ *  following a scripted path that only depends on the frame
+ *  number, or a camera recording that is played back one
+ *  step per frame, so every run sees the same views.  The
+ *  time of every frame is measured both for submitting the
+ *  frame on the CPU and for finishing it, and the average
+ *  and the 50th, 95th and 99th percentiles are written as
+ *  JSON together with the draw call and triangle counts.
+ *  Nothing is presented, so it runs in a hidden window on
+ *  machines without a GPU.
+ ***********************************************************/
+class RenderBenchmark
+{
+public:
+	// constructor
+	RenderBenchmark(
+		SceneManager* pSceneManager,
+		UniformBuffers* pUniformBuffers,
+		GLStateCache* pStateCache);
+	// destructor
+	~RenderBenchmark();
+
+	// what to measure and how the scene was set up, for the
+	// report
+	struct BENCHMARK_SETTINGS
+	{
+		int frameCount;
+		int warmupFrames;
+		int width;
+		int height;
+		std::string sceneName;
+		// file the JSON report is written to, or empty for
+		// the standard output
+		std::string outputFilename;
+		// camera recording that is played back, or empty for
+		// the scripted path
+		std::string cameraRecording;
+		bool bGPUCulling;
+		bool bBindlessTextures;
+	};
+
+	// fill in the default settings
+	static void GetDefaultSettings(BENCHMARK_SETTINGS& settings);
+
+	// follow the camera recording that the view manager plays
+	// back instead of the scripted path
+	void SetCameraPlayback(ViewManager* pViewManager) { m_pViewManager = pViewManager; }
+
+	// render the frames with the passed in shader program and
+	// write the report - returns false when the offscreen
+	// framebuffer or the report file could not be created
+	bool Run(GLuint programID, const BENCHMARK_SETTINGS& settings);
+
+private:
+	// summary of one list of frame times, in milliseconds
+	struct TIME_SUMMARY
+	{
+		double average;
+		double p50;
+		double p95;
+		double p99;
+	};
+
+	// rendering counters added up over the measured frames
+	struct COUNTER_TOTALS
+	{
+		unsigned long long drawCalls;
+		unsigned long long drawCommands;
+		unsigned long long instances;
+		unsigned long long triangles;
+	};
+
+	// pointer to the prepared scene
+	SceneManager* m_pSceneManager;
+	// pointer to the shared uniform buffers
+	UniformBuffers* m_pUniformBuffers;
+	// pointer to the OpenGL state cache
+	GLStateCache* m_pStateCache;
+	// pointer to the view manager playing back the camera, or
+	// NULL for the scripted path
+	ViewManager* m_pViewManager;
+	// offscreen framebuffer and its attachments
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+
+	// create and free the offscreen framebuffer
+	bool CreateFramebuffer(int width, int height);
+	void DestroyFramebuffer();
+	// set the camera of a frame along the scripted path
+	void SetCameraPath(int frame, int frameCount, float aspectRatio);
+	// average and percentiles of a list of frame times
+	static TIME_SUMMARY Summarize(std::vector<double> times);
+	// write the report as JSON
+	static bool WriteReport(
+		const BENCHMARK_SETTINGS& settings,
+		const TIME_SUMMARY& cpuTimes,
+		const TIME_SUMMARY& frameTimes,
+		const COUNTER_TOTALS& totals);
+};
@@ -0,0 +1,187 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ============
+// sort the draws of a frame by their render state before they are issued
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+
+// declaration of global variables
+namespace
+{
+	// the keys are sorted one byte at a time
+	const int RADIX_BITS = 8;
+	const int RADIX_BUCKETS = 1 << RADIX_BITS;
+	const int RADIX_PASSES = 64 / RADIX_BITS;
+
+	// sizes of the key fields in bits
+	const int PROGRAM_BITS = 8;
+	const int TEXTURE_BITS = 8;
+	const int MESH_BITS = 8;
+	const int DEPTH_BITS = 24;
+
+	const uint64_t DEPTH_MASK = (1ull << DEPTH_BITS) - 1;
+
+	// keep a field value inside its number of bits
+	uint64_t KeyField(int value, int bits)
+	{
+		return((uint64_t)value & ((1ull << bits) - 1));
+	}
+}
+
+const float RenderQueue::MAX_SORT_DEPTH = 1000.0f;
+
+/***********************************************************
+ *  RenderQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderQueue::RenderQueue()
+{
+}
+
+/***********************************************************
+ *  ~RenderQueue()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderQueue::~RenderQueue()
+{
+}
+
+/***********************************************************
+ *  MakeKey()
+ *
+ *  This method is used for packing the render state of a
+ *  draw into a sort key.  The depth is quantized to 24 bits
+ *  and inverted for transparent draws so that the farthest
+ *  ones sort first.
+ ***********************************************************/
+uint64_t RenderQueue::MakeKey(
+	int program,
+	bool bTransparent,
+	int textureSlot,
+	int mesh,
+	float depth)
+{
+	uint64_t key = 0;
+	uint64_t depthBits = 0;
+
+	// objects behind the camera sort with the nearest ones
+	if (depth > 0.0f)
+	{
+		if (depth >= MAX_SORT_DEPTH)
+		{
+			depthBits = DEPTH_MASK;
+		}
+		else
+		{
+			depthBits = (uint64_t)((depth / MAX_SORT_DEPTH) * (float)DEPTH_MASK);
+		}
+	}
+
+	// untextured draws use the value 0 so they sort first
+	uint64_t texture = KeyField(textureSlot + 1, TEXTURE_BITS);
+
+	key = KeyField(program, PROGRAM_BITS) << (64 - PROGRAM_BITS);
+	if (bTransparent == false)
+	{
+		key |= texture << (DEPTH_BITS + MESH_BITS);
+		key |= KeyField(mesh, MESH_BITS) << DEPTH_BITS;
+		key |= depthBits;
+	}
+	else
+	{
+		key |= 1ull << (64 - PROGRAM_BITS - 1);
+		key |= (DEPTH_MASK - depthBits) << (TEXTURE_BITS + MESH_BITS);
+		key |= texture << MESH_BITS;
+		key |= KeyField(mesh, MESH_BITS);
+	}
+
+	return(key);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the submitted
+ *  draws while keeping the allocated memory for the next
+ *  frame.
+ ***********************************************************/
+void RenderQueue::Clear()
+{
+	m_items.clear();
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for adding a draw to the queue.
+ ***********************************************************/
+void RenderQueue::Submit(uint64_t key, int payload)
+{
+	RENDER_ITEM item;
+
+	item.key = key;
+	item.payload = payload;
+	m_items.push_back(item);
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for sorting the submitted draws with
+ *  a least significant digit radix sort, one byte per pass.
+ *  The counts for every pass are gathered in a single walk
+ *  over the keys, and a pass is skipped when all of the keys
+ *  have the same value in that byte.  Draws with equal keys
+ *  stay in the order they were submitted.
+ ***********************************************************/
+void RenderQueue::Sort()
+{
+	size_t itemCount = m_items.size();
+	size_t counts[RADIX_PASSES][RADIX_BUCKETS] = {};
+
+	if (itemCount < 2)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < itemCount; i++)
+	{
+		uint64_t key = m_items[i].key;
+		for (int pass = 0; pass < RADIX_PASSES; pass++)
+		{
+			counts[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+		}
+	}
+
+	m_sortBuffer.resize(itemCount);
+	for (int pass = 0; pass < RADIX_PASSES; pass++)
+	{
+		size_t* passCounts = counts[pass];
+		int shift = pass * RADIX_BITS;
+
+		// nothing to reorder when every key has the same byte
+		if (passCounts[(m_items[0].key >> shift) & (RADIX_BUCKETS - 1)] == itemCount)
+		{
+			continue;
+		}
+
+		// turn the counts into the first output index of each bucket
+		size_t offset = 0;
+		for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+		{
+			size_t count = passCounts[bucket];
+			passCounts[bucket] = offset;
+			offset += count;
+		}
+
+		for (size_t i = 0; i < itemCount; i++)
+		{
+			size_t bucket = (m_items[i].key >> shift) & (RADIX_BUCKETS - 1);
+			m_sortBuffer[passCounts[bucket]++] = m_items[i];
+		}
+		m_items.swap(m_sortBuffer);
+	}
+}
@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ============
+// sort the draws of a frame by their render state before they are issued
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class collects the draws of a frame as 64-bit sort
+ *  keys with a payload index, and radix sorts them so that
+ *  draws sharing a shader program, texture and mesh are
+ *  issued next to each other.  Opaque draws are ordered by
+ *  state and then front to back, while transparent draws
+ *  come after all of the opaque ones, back to front.
+ *
+ *  Opaque key layout, from the highest bit down:
+ *    program (8) | transparent = 0 (1) | texture (8) | mesh (8) | depth (24)
+ *  Transparent key layout:
+ *    program (8) | transparent = 1 (1) | far to near depth (24) | texture (8) | mesh (8)
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// constructor
+	RenderQueue();
+	// destructor
+	~RenderQueue();
+
+	// depth values past this distance share the last depth bucket
+	static const float MAX_SORT_DEPTH;
+
+	struct RENDER_ITEM
+	{
+		uint64_t key;
+		int payload;
+	};
+
+	// build the sort key for a draw - a texture slot of -1
+	// means the draw is untextured
+	static uint64_t MakeKey(
+		int program,
+		bool bTransparent,
+		int textureSlot,
+		int mesh,
+		float depth);
+
+	// remove all of the submitted draws
+	void Clear();
+	// add a draw to the queue
+	void Submit(uint64_t key, int payload);
+	// sort the submitted draws by their keys
+	void Sort();
+
+	// read the sorted draws
+	int GetCount() const { return((int)m_items.size()); }
+	const RENDER_ITEM& GetItem(int index) const { return(m_items[index]); }
+
+private:
+	// submitted draws, sorted in place by Sort()
+	std::vector<RENDER_ITEM> m_items;
+	// work buffer for the radix sort passes
+	std::vector<RENDER_ITEM> m_sortBuffer;
+};
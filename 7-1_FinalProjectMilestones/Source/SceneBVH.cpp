@@ -0,0 +1,578 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.cpp
+// ============
+// bounding volume hierarchy for spatial queries over the scene objects
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// nodes with this many objects or fewer may stay leaves
+	const int MAX_LEAF_SIZE = 4;
+	// number of bins for the surface area heuristic
+	const int SAH_BIN_COUNT = 16;
+	// the tree never gets deeper than this, which bounds the
+	// size of the traversal stacks
+	const int MAX_TREE_DEPTH = 48;
+	const int TRAVERSAL_STACK_SIZE = 2 * MAX_TREE_DEPTH + 2;
+
+	// an empty box that any box can be merged into
+	SceneBVH::AABB EmptyBox()
+	{
+		SceneBVH::AABB box;
+		box.boundsMin = glm::vec3(FLT_MAX);
+		box.boundsMax = glm::vec3(-FLT_MAX);
+		return(box);
+	}
+
+	// grow a box to include another box
+	void MergeBox(SceneBVH::AABB& box, const SceneBVH::AABB& other)
+	{
+		box.boundsMin = glm::min(box.boundsMin, other.boundsMin);
+		box.boundsMax = glm::max(box.boundsMax, other.boundsMax);
+	}
+
+	// half the surface area of a box, 0 for an empty box
+	float HalfSurfaceArea(const SceneBVH::AABB& box)
+	{
+		glm::vec3 size = box.boundsMax - box.boundsMin;
+		if ((size.x < 0.0f) || (size.y < 0.0f) || (size.z < 0.0f))
+		{
+			return(0.0f);
+		}
+		return(size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	// distance along the ray to where it enters the box, or -1
+	// when the ray misses the box within the max distance
+	float RayBoxDistance(
+		const SceneBVH::AABB& box,
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		float maxDistance)
+	{
+		float tEnter = 0.0f;
+		float tExit = maxDistance;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float t0 = (box.boundsMin[axis] - origin[axis]) * inverseDirection[axis];
+			float t1 = (box.boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+			tEnter = std::max(tEnter, t0);
+			tExit = std::min(tExit, t1);
+		}
+
+		return((tEnter <= tExit) ? tEnter : -1.0f);
+	}
+
+	// squared distance from a point to a box, 0 inside the box
+	float PointBoxDistanceSquared(const SceneBVH::AABB& box, const glm::vec3& point)
+	{
+		glm::vec3 below = glm::max(box.boundsMin - point, glm::vec3(0.0f));
+		glm::vec3 above = glm::max(point - box.boundsMax, glm::vec3(0.0f));
+		glm::vec3 offset = glm::max(below, above);
+		return(glm::dot(offset, offset));
+	}
+}
+
+/***********************************************************
+ *  SceneBVH()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneBVH::SceneBVH()
+{
+}
+
+/***********************************************************
+ *  ~SceneBVH()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneBVH::~SceneBVH()
+{
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree over the passed
+ *  in object bounding boxes.  The root holds every object
+ *  and is split recursively until the leaves are small or
+ *  splitting them would not make queries cheaper.
+ ***********************************************************/
+void SceneBVH::Build(const std::vector<AABB>& objectBounds)
+{
+	int objectCount = (int)objectBounds.size();
+	std::vector<glm::vec3> centroids(objectCount);
+
+	Clear();
+	if (objectCount == 0)
+	{
+		return;
+	}
+
+	m_objectBounds = objectBounds;
+	m_objectOrder.resize(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		m_objectOrder[i] = i;
+		centroids[i] = (objectBounds[i].boundsMin + objectBounds[i].boundsMax) * 0.5f;
+	}
+
+	// a binary tree with small leaves has fewer than two nodes
+	// per object
+	m_nodes.reserve(2 * objectCount);
+
+	NODE root;
+	root.first = 0;
+	root.count = objectCount;
+	root.bounds = ComputeLeafBounds(0, objectCount);
+	m_nodes.push_back(root);
+
+	SplitNode(0, 0, centroids);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the objects and
+ *  nodes of the tree.
+ ***********************************************************/
+void SceneBVH::Clear()
+{
+	m_nodes.clear();
+	m_objectOrder.clear();
+	m_objectBounds.clear();
+}
+
+/***********************************************************
+ *  SplitNode()
+ *
+ *  This method is used for splitting a node along the axis
+ *  where its object centers are spread out the most.  The
+ *  object centers are sorted into bins, and the split between
+ *  two bins with the lowest surface area cost is used.  If no
+ *  split is cheaper than keeping a small leaf, or the objects
+ *  cannot be separated, the node stays a leaf.
+ ***********************************************************/
+void SceneBVH::SplitNode(int nodeIndex, int depth, std::vector<glm::vec3>& centroids)
+{
+	int first = m_nodes[nodeIndex].first;
+	int count = m_nodes[nodeIndex].count;
+
+	if ((count <= 2) || (depth >= MAX_TREE_DEPTH))
+	{
+		return;
+	}
+
+	// find the axis where the object centers spread the most
+	glm::vec3 centroidMin(FLT_MAX);
+	glm::vec3 centroidMax(-FLT_MAX);
+	for (int i = first; i < first + count; i++)
+	{
+		centroidMin = glm::min(centroidMin, centroids[m_objectOrder[i]]);
+		centroidMax = glm::max(centroidMax, centroids[m_objectOrder[i]]);
+	}
+	glm::vec3 extent = centroidMax - centroidMin;
+	int axis = 0;
+	if (extent.y > extent[axis])
+	{
+		axis = 1;
+	}
+	if (extent.z > extent[axis])
+	{
+		axis = 2;
+	}
+
+	int middle = first;
+	if (extent[axis] > 0.0f)
+	{
+		// sort the objects into bins along the axis
+		AABB binBounds[SAH_BIN_COUNT];
+		int binCounts[SAH_BIN_COUNT] = {};
+		float binScale = (float)SAH_BIN_COUNT / extent[axis];
+		for (int b = 0; b < SAH_BIN_COUNT; b++)
+		{
+			binBounds[b] = EmptyBox();
+		}
+		for (int i = first; i < first + count; i++)
+		{
+			int object = m_objectOrder[i];
+			int bin = std::min(SAH_BIN_COUNT - 1, (int)((centroids[object][axis] - centroidMin[axis]) * binScale));
+			binCounts[bin]++;
+			MergeBox(binBounds[bin], m_objectBounds[object]);
+		}
+
+		// sweep from both ends to get the cost of every split
+		float rightCosts[SAH_BIN_COUNT] = {};
+		AABB rightBox = EmptyBox();
+		int rightCount = 0;
+		for (int b = SAH_BIN_COUNT - 1; b > 0; b--)
+		{
+			MergeBox(rightBox, binBounds[b]);
+			rightCount += binCounts[b];
+			rightCosts[b] = rightCount * HalfSurfaceArea(rightBox);
+		}
+
+		float bestCost = FLT_MAX;
+		int bestSplit = -1;
+		AABB leftBox = EmptyBox();
+		int leftCount = 0;
+		for (int b = 0; b < SAH_BIN_COUNT - 1; b++)
+		{
+			MergeBox(leftBox, binBounds[b]);
+			leftCount += binCounts[b];
+			float cost = leftCount * HalfSurfaceArea(leftBox) + rightCosts[b + 1];
+			if ((leftCount > 0) && (leftCount < count) && (cost < bestCost))
+			{
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+
+		// small nodes stay leaves when splitting does not pay off
+		float leafCost = count * HalfSurfaceArea(m_nodes[nodeIndex].bounds);
+		if ((count <= MAX_LEAF_SIZE) && ((bestSplit < 0) || (bestCost >= leafCost)))
+		{
+			return;
+		}
+
+		if (bestSplit >= 0)
+		{
+			int* splitPoint = std::partition(
+				&m_objectOrder[first],
+				&m_objectOrder[first] + count,
+				[&](int object)
+				{
+					int bin = std::min(SAH_BIN_COUNT - 1, (int)((centroids[object][axis] - centroidMin[axis]) * binScale));
+					return(bin <= bestSplit);
+				});
+			middle = (int)(splitPoint - &m_objectOrder[0]);
+		}
+	}
+	else if (count <= MAX_LEAF_SIZE)
+	{
+		return;
+	}
+
+	// objects whose centers cannot be separated by the bins are
+	// split in half so that no leaf grows too large
+	if ((middle <= first) || (middle >= first + count))
+	{
+		middle = first + count / 2;
+		std::nth_element(
+			&m_objectOrder[first],
+			&m_objectOrder[middle],
+			&m_objectOrder[first] + count,
+			[&](int a, int b) { return(centroids[a][axis] < centroids[b][axis]); });
+	}
+
+	// both children are added next to each other
+	int leftIndex = (int)m_nodes.size();
+	NODE left;
+	left.first = first;
+	left.count = middle - first;
+	left.bounds = ComputeLeafBounds(left.first, left.count);
+	NODE right;
+	right.first = middle;
+	right.count = first + count - middle;
+	right.bounds = ComputeLeafBounds(right.first, right.count);
+	m_nodes.push_back(left);
+	m_nodes.push_back(right);
+
+	m_nodes[nodeIndex].first = leftIndex;
+	m_nodes[nodeIndex].count = 0;
+
+	SplitNode(leftIndex, depth + 1, centroids);
+	SplitNode(leftIndex + 1, depth + 1, centroids);
+}
+
+/***********************************************************
+ *  ComputeLeafBounds()
+ *
+ *  This method is used for merging the boxes of a range of
+ *  objects in the object order.
+ ***********************************************************/
+SceneBVH::AABB SceneBVH::ComputeLeafBounds(int first, int count) const
+{
+	AABB bounds = EmptyBox();
+
+	for (int i = first; i < first + count; i++)
+	{
+		MergeBox(bounds, m_objectBounds[m_objectOrder[i]]);
+	}
+
+	return(bounds);
+}
+
+/***********************************************************
+ *  SetObjectBounds()
+ *
+ *  This method is used for changing the bounding box of an
+ *  object after it moved.
+ ***********************************************************/
+void SceneBVH::SetObjectBounds(int object, const AABB& bounds)
+{
+	m_objectBounds[object] = bounds;
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method is used for updating every node box from the
+ *  current object boxes.  Children are always stored after
+ *  their parent, so walking the nodes backwards updates the
+ *  children of a node before the node itself.
+ ***********************************************************/
+void SceneBVH::Refit()
+{
+	for (int i = (int)m_nodes.size() - 1; i >= 0; i--)
+	{
+		NODE& node = m_nodes[i];
+
+		if (node.count > 0)
+		{
+			node.bounds = ComputeLeafBounds(node.first, node.count);
+		}
+		else
+		{
+			node.bounds = m_nodes[node.first].bounds;
+			MergeBox(node.bounds, m_nodes[node.first + 1].bounds);
+		}
+	}
+}
+
+/***********************************************************
+ *  QueryFrustum()
+ *
+ *  This method is used for finding every object whose box
+ *  touches the frustum.  Branches outside the frustum are
+ *  skipped, and branches completely inside are accepted
+ *  without testing their objects.
+ ***********************************************************/
+void SceneBVH::QueryFrustum(const ViewFrustum& frustum, std::vector<int>& visibleObjects) const
+{
+	int stack[TRAVERSAL_STACK_SIZE];
+	int stackSize = 0;
+
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const NODE& node = m_nodes[stack[--stackSize]];
+		ViewFrustum::CONTAINMENT containment = frustum.ClassifyBox(node.bounds.boundsMin, node.bounds.boundsMax);
+
+		if (containment == ViewFrustum::OUTSIDE)
+		{
+			continue;
+		}
+		if (containment == ViewFrustum::INSIDE)
+		{
+			AddSubtree((int)(&node - &m_nodes[0]), visibleObjects);
+			continue;
+		}
+
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				const AABB& bounds = m_objectBounds[m_objectOrder[i]];
+				if (frustum.IsBoxVisible(bounds.boundsMin, bounds.boundsMax))
+				{
+					visibleObjects.push_back(m_objectOrder[i]);
+				}
+			}
+		}
+		else
+		{
+			stack[stackSize++] = node.first;
+			stack[stackSize++] = node.first + 1;
+		}
+	}
+}
+
+/***********************************************************
+ *  AddSubtree()
+ *
+ *  This method is used for adding every object below a node
+ *  to the passed in list.
+ ***********************************************************/
+void SceneBVH::AddSubtree(int nodeIndex, std::vector<int>& objects) const
+{
+	int stack[TRAVERSAL_STACK_SIZE];
+	int stackSize = 0;
+
+	stack[stackSize++] = nodeIndex;
+	while (stackSize > 0)
+	{
+		const NODE& node = m_nodes[stack[--stackSize]];
+
+		if (node.count > 0)
+		{
+			objects.insert(objects.end(), &m_objectOrder[node.first], &m_objectOrder[node.first] + node.count);
+		}
+		else
+		{
+			stack[stackSize++] = node.first;
+			stack[stackSize++] = node.first + 1;
+		}
+	}
+}
+
+/***********************************************************
+ *  RayCast()
+ *
+ *  This method is used for finding the nearest object box
+ *  that is hit by a ray.  The nearer child is visited first,
+ *  and branches that start beyond the nearest hit so far are
+ *  skipped.
+ ***********************************************************/
+int SceneBVH::RayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& hitDistance) const
+{
+	int stack[TRAVERSAL_STACK_SIZE];
+	int stackSize = 0;
+	int hitObject = -1;
+	float nearest = maxDistance;
+	glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	if (m_nodes.empty() || (RayBoxDistance(m_nodes[0].bounds, origin, inverseDirection, nearest) < 0.0f))
+	{
+		return(-1);
+	}
+
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const NODE& node = m_nodes[stack[--stackSize]];
+
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				float distance = RayBoxDistance(m_objectBounds[m_objectOrder[i]], origin, inverseDirection, nearest);
+				if ((distance >= 0.0f) && (distance <= nearest))
+				{
+					nearest = distance;
+					hitObject = m_objectOrder[i];
+				}
+			}
+			continue;
+		}
+
+		float leftDistance = RayBoxDistance(m_nodes[node.first].bounds, origin, inverseDirection, nearest);
+		float rightDistance = RayBoxDistance(m_nodes[node.first + 1].bounds, origin, inverseDirection, nearest);
+
+		// push the farther child first so the nearer one is
+		// visited next
+		if ((leftDistance >= 0.0f) && (rightDistance >= 0.0f))
+		{
+			if (leftDistance < rightDistance)
+			{
+				stack[stackSize++] = node.first + 1;
+				stack[stackSize++] = node.first;
+			}
+			else
+			{
+				stack[stackSize++] = node.first;
+				stack[stackSize++] = node.first + 1;
+			}
+		}
+		else if (leftDistance >= 0.0f)
+		{
+			stack[stackSize++] = node.first;
+		}
+		else if (rightDistance >= 0.0f)
+		{
+			stack[stackSize++] = node.first + 1;
+		}
+	}
+
+	if (hitObject >= 0)
+	{
+		hitDistance = nearest;
+	}
+
+	return(hitObject);
+}
+
+/***********************************************************
+ *  FindNearest()
+ *
+ *  This method is used for finding the object whose box is
+ *  nearest to a point.  Branches whose box is farther away
+ *  than the nearest object found so far are skipped.
+ ***********************************************************/
+int SceneBVH::FindNearest(const glm::vec3& point, float& distance) const
+{
+	int stack[TRAVERSAL_STACK_SIZE];
+	int stackSize = 0;
+	int nearestObject = -1;
+	float nearestSquared = FLT_MAX;
+
+	if (m_nodes.empty())
+	{
+		return(-1);
+	}
+
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const NODE& node = m_nodes[stack[--stackSize]];
+
+		if (PointBoxDistanceSquared(node.bounds, point) >= nearestSquared)
+		{
+			continue;
+		}
+
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				float distanceSquared = PointBoxDistanceSquared(m_objectBounds[m_objectOrder[i]], point);
+				if (distanceSquared < nearestSquared)
+				{
+					nearestSquared = distanceSquared;
+					nearestObject = m_objectOrder[i];
+				}
+			}
+			continue;
+		}
+
+		// push the farther child first so the nearer one is
+		// visited next
+		float leftSquared = PointBoxDistanceSquared(m_nodes[node.first].bounds, point);
+		float rightSquared = PointBoxDistanceSquared(m_nodes[node.first + 1].bounds, point);
+		if (leftSquared < rightSquared)
+		{
+			stack[stackSize++] = node.first + 1;
+			stack[stackSize++] = node.first;
+		}
+		else
+		{
+			stack[stackSize++] = node.first;
+			stack[stackSize++] = node.first + 1;
+		}
+	}
+
+	if (nearestObject >= 0)
+	{
+		distance = std::sqrt(nearestSquared);
+	}
+
+	return(nearestObject);
+}
@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.h
+// ============
+// bounding volume hierarchy for spatial queries over the scene objects
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ViewFrustum.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneBVH
+ *
+ *  This class builds a binary tree of axis aligned bounding
+ *  boxes over a set of objects, splitting each node with
+ *  the surface area heuristic.  The nodes are stored in one
+ *  flat array with both children of a node next to each
+ *  other, and every child is stored after its parent, so
+ *  the tree can be refit after objects move with one
+ *  backwards walk over the array.  Frustum, ray and nearest
+ *  object queries only visit the branches that can contain
+ *  a result.
+ ***********************************************************/
+class SceneBVH
+{
+public:
+	// constructor
+	SceneBVH();
+	// destructor
+	~SceneBVH();
+
+	struct AABB
+	{
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	// build the tree over the passed in object bounding boxes -
+	// objects are referred to by their index in this list
+	void Build(const std::vector<AABB>& objectBounds);
+	// remove all of the objects and nodes
+	void Clear();
+
+	// change the bounding box of an object - Refit() needs to
+	// be called before the next query
+	void SetObjectBounds(int object, const AABB& bounds);
+	// update the node boxes after objects moved, keeping the
+	// tree structure
+	void Refit();
+
+	// add every object whose box touches the frustum to the
+	// visible list
+	void QueryFrustum(const ViewFrustum& frustum, std::vector<int>& visibleObjects) const;
+	// find the nearest object whose box is hit by the ray - the
+	// direction does not need to be normalized, and the hit
+	// distance is in units of its length.  Returns -1 on a miss
+	int RayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& hitDistance) const;
+	// find the object whose box is nearest to the point, or -1
+	// when there are no objects
+	int FindNearest(const glm::vec3& point, float& distance) const;
+
+	// size of the tree
+	int GetObjectCount() const { return((int)m_objectBounds.size()); }
+	int GetNodeCount() const { return((int)m_nodes.size()); }
+
+private:
+	// a leaf holds count objects starting at first in the
+	// object order, an inner node has a count of 0 and its
+	// children at first and first + 1
+	struct NODE
+	{
+		AABB bounds;
+		int first;
+		int count;
+	};
+
+	// tree nodes, the root is node 0
+	std::vector<NODE> m_nodes;
+	// object indices grouped by leaf
+	std::vector<int> m_objectOrder;
+	// bounding box of every object by object index
+	std::vector<AABB> m_objectBounds;
+
+	// split a node into two children, or leave it as a leaf
+	void SplitNode(int nodeIndex, int depth, std::vector<glm::vec3>& centroids);
+	// compute the box of a node from its objects
+	AABB ComputeLeafBounds(int first, int count) const;
+	// add every object below a node to the list
+	void AddSubtree(int nodeIndex, std::vector<int>& objects) const;
+};
@@ -0,0 +1,580 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneloader.cpp
+// ============
+// read 3D scene descriptions (textures and object records) from scene files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneLoader.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/***********************************************************
+ *  JSON_VALUE
+ *
+ *  Parsed JSON node - only the members matching the node
+ *  type are filled in.
+ ***********************************************************/
+struct SceneLoader::JSON_VALUE
+{
+	enum VALUE_TYPE
+	{
+		JSON_NULL,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	VALUE_TYPE type = JSON_NULL;
+	bool boolean = false;
+	double number = 0.0;
+	std::string text;
+	std::vector<JSON_VALUE> items;
+	std::vector<std::string> keys;
+
+	// find a member of an object node by key
+	const JSON_VALUE* Find(const char* key) const
+	{
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			if (keys[i].compare(key) == 0)
+			{
+				return(&items[i]);
+			}
+		}
+		return(NULL);
+	}
+};
+
+// declaration of global variables and helper functions
+namespace
+{
+	/***********************************************************
+	 *  ReadFloats()
+	 *
+	 *  Copy a JSON array of numbers into a float array - the
+	 *  array must contain exactly the requested count.
+	 ***********************************************************/
+	template <typename T>
+	bool ReadFloats(const T* value, float* result, int count)
+	{
+		if ((NULL == value) ||
+			(value->type != T::JSON_ARRAY) ||
+			(value->items.size() != (size_t)count))
+		{
+			return(false);
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			if (value->items[i].type != T::JSON_NUMBER)
+			{
+				return(false);
+			}
+			result[i] = (float)value->items[i].number;
+		}
+
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  SceneLoader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneLoader::SceneLoader()
+{
+	m_position = 0;
+}
+
+/***********************************************************
+ *  ~SceneLoader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneLoader::~SceneLoader()
+{
+}
+
+/***********************************************************
+ *  LoadSceneFile()
+ *
+ *  This method is used for reading the scene file and
+ *  converting its texture and object lists into the passed
+ *  in scene description.
+ ***********************************************************/
+bool SceneLoader::LoadSceneFile(const char* filename, SCENE_DESCRIPTION& scene)
+{
+	std::ifstream sceneFile(filename, std::ios::in | std::ios::binary);
+	if (!sceneFile.is_open())
+	{
+		std::cout << "Could not open scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	std::stringstream fileContents;
+	fileContents << sceneFile.rdbuf();
+	m_text = fileContents.str();
+	m_position = 0;
+	m_errorMessage.clear();
+
+	JSON_VALUE root;
+	bool bReturn = ParseValue(root);
+	if (bReturn == true)
+	{
+		SkipWhitespace();
+		if (m_position < m_text.size())
+		{
+			bReturn = SetError("unexpected data after the scene object");
+		}
+		else if (root.type != JSON_VALUE::JSON_OBJECT)
+		{
+			bReturn = SetError("the scene file must contain a JSON object");
+		}
+	}
+
+	if (bReturn == false)
+	{
+		// count the lines up to the failure for a useful message
+		int line = 1;
+		for (size_t i = 0; (i < m_position) && (i < m_text.size()); i++)
+		{
+			if (m_text[i] == '\n')
+			{
+				line++;
+			}
+		}
+		std::cout << "Could not parse scene file:" << filename << ", line:" << line << ", " << m_errorMessage << std::endl;
+		return(false);
+	}
+
+	scene.textures.clear();
+	scene.objects.clear();
+
+	const JSON_VALUE* textures = root.Find("textures");
+	if ((NULL != textures) && (textures->type == JSON_VALUE::JSON_ARRAY))
+	{
+		scene.textures.resize(textures->items.size());
+		for (size_t i = 0; i < textures->items.size(); i++)
+		{
+			if (ReadTexture(textures->items[i], scene.textures[i]) == false)
+			{
+				std::cout << "Invalid texture entry " << i << " in scene file:" << filename << std::endl;
+				return(false);
+			}
+		}
+	}
+
+	const JSON_VALUE* objects = root.Find("objects");
+	if ((NULL != objects) && (objects->type == JSON_VALUE::JSON_ARRAY))
+	{
+		scene.objects.resize(objects->items.size());
+		for (size_t i = 0; i < objects->items.size(); i++)
+		{
+			if (ReadObject(objects->items[i], scene.objects[i]) == false)
+			{
+				std::cout << "Invalid object entry " << i << " in scene file:" << filename << std::endl;
+				return(false);
+			}
+		}
+	}
+
+	// the parsed text is no longer needed
+	m_text.clear();
+	m_text.shrink_to_fit();
+
+	std::cout << "Successfully loaded scene:" << filename << ", textures:" << scene.textures.size() << ", objects:" << scene.objects.size() << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReadTexture()
+ *
+ *  This method is used for converting a parsed texture
+ *  entry into a scene texture.
+ ***********************************************************/
+bool SceneLoader::ReadTexture(const JSON_VALUE& value, SCENE_TEXTURE& texture)
+{
+	if (value.type != JSON_VALUE::JSON_OBJECT)
+	{
+		return(false);
+	}
+
+	const JSON_VALUE* tag = value.Find("tag");
+	const JSON_VALUE* file = value.Find("file");
+	if ((NULL == tag) || (tag->type != JSON_VALUE::JSON_STRING) ||
+		(NULL == file) || (file->type != JSON_VALUE::JSON_STRING))
+	{
+		return(false);
+	}
+
+	texture.tag = tag->text;
+	texture.filename = file->text;
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReadObject()
+ *
+ *  This method is used for converting a parsed object entry
+ *  into a scene object.  Only the mesh is required - every
+ *  other field falls back to an identity/no-op default.
+ ***********************************************************/
+bool SceneLoader::ReadObject(const JSON_VALUE& value, SCENE_OBJECT& object)
+{
+	if (value.type != JSON_VALUE::JSON_OBJECT)
+	{
+		return(false);
+	}
+
+	const JSON_VALUE* mesh = value.Find("mesh");
+	if ((NULL == mesh) || (mesh->type != JSON_VALUE::JSON_STRING))
+	{
+		return(false);
+	}
+	object.mesh = mesh->text;
+
+	const JSON_VALUE* name = value.Find("name");
+	if ((NULL != name) && (name->type == JSON_VALUE::JSON_STRING))
+	{
+		object.name = name->text;
+	}
+
+	const JSON_VALUE* texture = value.Find("texture");
+	if ((NULL != texture) && (texture->type == JSON_VALUE::JSON_STRING))
+	{
+		object.textureTag = texture->text;
+	}
+
+	const JSON_VALUE* material = value.Find("material");
+	if ((NULL != material) && (material->type == JSON_VALUE::JSON_STRING))
+	{
+		object.materialTag = material->text;
+	}
+
+	// set the defaults for the optional values
+	object.uvScale = glm::vec2(1.0f, 1.0f);
+	object.color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+	object.tint = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+	object.scaleXYZ = glm::vec3(1.0f, 1.0f, 1.0f);
+	object.rotationDegrees = glm::vec3(0.0f, 0.0f, 0.0f);
+	object.positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
+
+	if ((NULL != value.Find("uvScale")) &&
+		(ReadFloats(value.Find("uvScale"), &object.uvScale.x, 2) == false))
+	{
+		return(false);
+	}
+	if ((NULL != value.Find("color")) &&
+		(ReadFloats(value.Find("color"), &object.color.r, 4) == false))
+	{
+		return(false);
+	}
+	if ((NULL != value.Find("tint")) &&
+		(ReadFloats(value.Find("tint"), &object.tint.r, 4) == false))
+	{
+		return(false);
+	}
+	if ((NULL != value.Find("scale")) &&
+		(ReadFloats(value.Find("scale"), &object.scaleXYZ.x, 3) == false))
+	{
+		return(false);
+	}
+	if ((NULL != value.Find("rotation")) &&
+		(ReadFloats(value.Find("rotation"), &object.rotationDegrees.x, 3) == false))
+	{
+		return(false);
+	}
+	if ((NULL != value.Find("position")) &&
+		(ReadFloats(value.Find("position"), &object.positionXYZ.x, 3) == false))
+	{
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetError()
+ *
+ *  This method is used for recording the first parsing
+ *  error - it always returns false for convenience.
+ ***********************************************************/
+bool SceneLoader::SetError(const char* message)
+{
+	if (m_errorMessage.empty())
+	{
+		m_errorMessage = message;
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  SkipWhitespace()
+ *
+ *  This method is used for advancing the read position
+ *  past any whitespace characters.
+ ***********************************************************/
+void SceneLoader::SkipWhitespace()
+{
+	while ((m_position < m_text.size()) &&
+		((m_text[m_position] == ' ') || (m_text[m_position] == '\t') ||
+		 (m_text[m_position] == '\r') || (m_text[m_position] == '\n')))
+	{
+		m_position++;
+	}
+}
+
+/***********************************************************
+ *  ParseValue()
+ *
+ *  This method is used for parsing any JSON value at the
+ *  current read position.
+ ***********************************************************/
+bool SceneLoader::ParseValue(JSON_VALUE& value)
+{
+	SkipWhitespace();
+	if (m_position >= m_text.size())
+	{
+		return(SetError("unexpected end of file"));
+	}
+
+	switch (m_text[m_position])
+	{
+	case '{':
+		return(ParseObject(value));
+	case '[':
+		return(ParseArray(value));
+	case '"':
+		value.type = JSON_VALUE::JSON_STRING;
+		return(ParseString(value.text));
+	case 't':
+		value.type = JSON_VALUE::JSON_BOOL;
+		value.boolean = true;
+		return(ParseLiteral("true"));
+	case 'f':
+		value.type = JSON_VALUE::JSON_BOOL;
+		value.boolean = false;
+		return(ParseLiteral("false"));
+	case 'n':
+		value.type = JSON_VALUE::JSON_NULL;
+		return(ParseLiteral("null"));
+	default:
+		return(ParseNumber(value));
+	}
+}
+
+/***********************************************************
+ *  ParseObject()
+ *
+ *  This method is used for parsing a JSON object - the keys
+ *  and values are stored in matching order.
+ ***********************************************************/
+bool SceneLoader::ParseObject(JSON_VALUE& value)
+{
+	value.type = JSON_VALUE::JSON_OBJECT;
+	// skip the opening brace
+	m_position++;
+
+	SkipWhitespace();
+	if ((m_position < m_text.size()) && (m_text[m_position] == '}'))
+	{
+		m_position++;
+		return(true);
+	}
+
+	while (m_position < m_text.size())
+	{
+		std::string key;
+
+		SkipWhitespace();
+		if ((m_position >= m_text.size()) || (m_text[m_position] != '"'))
+		{
+			return(SetError("expected a quoted key"));
+		}
+		if (ParseString(key) == false)
+		{
+			return(false);
+		}
+
+		SkipWhitespace();
+		if ((m_position >= m_text.size()) || (m_text[m_position] != ':'))
+		{
+			return(SetError("expected ':' after key"));
+		}
+		m_position++;
+
+		value.keys.push_back(key);
+		value.items.push_back(JSON_VALUE());
+		if (ParseValue(value.items.back()) == false)
+		{
+			return(false);
+		}
+
+		SkipWhitespace();
+		if ((m_position < m_text.size()) && (m_text[m_position] == ','))
+		{
+			m_position++;
+		}
+		else if ((m_position < m_text.size()) && (m_text[m_position] == '}'))
+		{
+			m_position++;
+			return(true);
+		}
+		else
+		{
+			return(SetError("expected ',' or '}' in object"));
+		}
+	}
+
+	return(SetError("unexpected end of file in object"));
+}
+
+/***********************************************************
+ *  ParseArray()
+ *
+ *  This method is used for parsing a JSON array.
+ ***********************************************************/
+bool SceneLoader::ParseArray(JSON_VALUE& value)
+{
+	value.type = JSON_VALUE::JSON_ARRAY;
+	// skip the opening bracket
+	m_position++;
+
+	SkipWhitespace();
+	if ((m_position < m_text.size()) && (m_text[m_position] == ']'))
+	{
+		m_position++;
+		return(true);
+	}
+
+	while (m_position < m_text.size())
+	{
+		value.items.push_back(JSON_VALUE());
+		if (ParseValue(value.items.back()) == false)
+		{
+			return(false);
+		}
+
+		SkipWhitespace();
+		if ((m_position < m_text.size()) && (m_text[m_position] == ','))
+		{
+			m_position++;
+		}
+		else if ((m_position < m_text.size()) && (m_text[m_position] == ']'))
+		{
+			m_position++;
+			return(true);
+		}
+		else
+		{
+			return(SetError("expected ',' or ']' in array"));
+		}
+	}
+
+	return(SetError("unexpected end of file in array"));
+}
+
+/***********************************************************
+ *  ParseString()
+ *
+ *  This method is used for parsing a quoted JSON string.
+ *  Unicode escapes outside of ASCII are not needed for
+ *  scene files and are replaced with '?'.
+ ***********************************************************/
+bool SceneLoader::ParseString(std::string& text)
+{
+	// skip the opening quote
+	m_position++;
+
+	while (m_position < m_text.size())
+	{
+		char character = m_text[m_position++];
+		if (character == '"')
+		{
+			return(true);
+		}
+		if (character != '\\')
+		{
+			text.push_back(character);
+			continue;
+		}
+
+		if (m_position >= m_text.size())
+		{
+			break;
+		}
+		character = m_text[m_position++];
+		switch (character)
+		{
+		case 'n': text.push_back('\n'); break;
+		case 't': text.push_back('\t'); break;
+		case 'r': text.push_back('\r'); break;
+		case 'b': text.push_back('\b'); break;
+		case 'f': text.push_back('\f'); break;
+		case 'u':
+		{
+			if (m_position + 4 > m_text.size())
+			{
+				return(SetError("invalid unicode escape"));
+			}
+			long code = strtol(m_text.substr(m_position, 4).c_str(), NULL, 16);
+			text.push_back((code < 128) ? (char)code : '?');
+			m_position += 4;
+			break;
+		}
+		default:
+			// covers the quote, backslash and forward slash escapes
+			text.push_back(character);
+			break;
+		}
+	}
+
+	return(SetError("unterminated string"));
+}
+
+/***********************************************************
+ *  ParseNumber()
+ *
+ *  This method is used for parsing a JSON number.
+ ***********************************************************/
+bool SceneLoader::ParseNumber(JSON_VALUE& value)
+{
+	const char* start = m_text.c_str() + m_position;
+	char* end = NULL;
+
+	value.type = JSON_VALUE::JSON_NUMBER;
+	value.number = strtod(start, &end);
+	if (end == start)
+	{
+		return(SetError("unexpected character"));
+	}
+
+	m_position += (end - start);
+	return(true);
+}
+
+/***********************************************************
+ *  ParseLiteral()
+ *
+ *  This method is used for matching one of the fixed JSON
+ *  literals (true, false, null).
+ ***********************************************************/
+bool SceneLoader::ParseLiteral(const char* literal)
+{
+	std::string expected(literal);
+	if (m_text.compare(m_position, expected.size(), expected) != 0)
+	{
+		return(SetError("unexpected character"));
+	}
+
+	m_position += expected.size();
+	return(true);
+}
@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneloader.h
+// ============
+// read 3D scene descriptions (textures and object records) from scene files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SceneLoader
+ *
+ *  This class contains the code for parsing a JSON scene
+ *  file into a list of textures and a flat list of object
+ *  records that the scene manager turns into draw records.
+ ***********************************************************/
+class SceneLoader
+{
+public:
+	// constructor
+	SceneLoader();
+	// destructor
+	~SceneLoader();
+
+	struct SCENE_TEXTURE
+	{
+		std::string tag;
+		std::string filename;
+	};
+
+	struct SCENE_OBJECT
+	{
+		std::string name;
+		std::string mesh;
+		std::string textureTag;
+		glm::vec2 uvScale;
+		std::string materialTag;
+		glm::vec4 color;
+		glm::vec4 tint;
+		glm::vec3 scaleXYZ;
+		glm::vec3 rotationDegrees;
+		glm::vec3 positionXYZ;
+	};
+
+	struct SCENE_DESCRIPTION
+	{
+		std::vector<SCENE_TEXTURE> textures;
+		std::vector<SCENE_OBJECT> objects;
+	};
+
+	// parse the scene file into the passed in scene description
+	bool LoadSceneFile(const char* filename, SCENE_DESCRIPTION& scene);
+
+private:
+	struct JSON_VALUE;
+
+	// contents of the scene file being parsed
+	std::string m_text;
+	// current read position within the scene file contents
+	size_t m_position;
+	// description of the first parsing error
+	std::string m_errorMessage;
+
+	// JSON parsing helpers
+	void SkipWhitespace();
+	bool ParseValue(JSON_VALUE& value);
+	bool ParseObject(JSON_VALUE& value);
+	bool ParseArray(JSON_VALUE& value);
+	bool ParseString(std::string& text);
+	bool ParseNumber(JSON_VALUE& value);
+	bool ParseLiteral(const char* literal);
+	bool SetError(const char* message);
+
+	// scene description helpers
+	bool ReadTexture(const JSON_VALUE& value, SCENE_TEXTURE& texture);
+	bool ReadObject(const JSON_VALUE& value, SCENE_OBJECT& object);
+};
@@ -8,6 +8,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "FrameProfiler.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,14 +17,61 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+
 // declaration of global variables
 namespace
 {
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
+	// names used by the scene file for each of the basic meshes,
+	// in the same order as the MESH_TYPE values
+	const char* g_MeshNames[MeshLibrary::MESH_TYPE_COUNT] =
+	{
+		"plane",
+		"cylinder",
+		"taperedCylinder",
+		"cone"
+	};
+
+	// render queue index of the one shader program the scene uses
+	const int SCENE_PROGRAM = 0;
+
+	// scenes with at least this many objects are culled through
+	// the bounding volume hierarchy - smaller scenes are faster
+	// to test with one pass over the bounding spheres
+	const int BVH_CULL_THRESHOLD = 256;
+	// size of the ring buffer that texture pixels are streamed
+	// through, and how many bytes may be streamed per frame
+	// while the scene is running
+	const GLsizeiptr TEXTURE_RING_SIZE = 32 * 1024 * 1024;
+	const GLsizeiptr STREAMING_BYTES_PER_FRAME = 4 * 1024 * 1024;
+	// the last entry of the material table is never defined, so
+	// it stays black - objects without a material point to it
+	const int NO_MATERIAL = UniformBuffers::TOTAL_MATERIALS - 1;
+	// smallest projected size, as a fraction of the screen
+	// height, that each level of detail is drawn at - objects
+	// smaller than the last entry use the coarsest level
+	const float LOD_SCREEN_SIZES[MeshLibrary::LOD_COUNT - 1] = { 0.12f, 0.04f };
+	// how far past a boundary the size has to move before the
+	// level changes, so objects near a boundary do not pop
+	// back and forth
+	const float LOD_HYSTERESIS = 0.2f;
+
+	// pick the level of detail for a projected size, starting
+	// from the level the object was drawn at
+	int SelectLOD(float screenSize, int lod)
+	{
+		while ((lod > 0) && (screenSize > LOD_SCREEN_SIZES[lod - 1] * (1.0f + LOD_HYSTERESIS)))
+		{
+			lod--;
+		}
+		while ((lod < MeshLibrary::LOD_COUNT - 1) && (screenSize < LOD_SCREEN_SIZES[lod] * (1.0f - LOD_HYSTERESIS)))
+		{
+			lod++;
+		}
+		return(lod);
+	}
 }
 
 /***********************************************************
@@ -31,18 +79,38 @@ namespace
  *
  *  The constructor for the class
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager *pShaderManager)
+SceneManager::SceneManager(
+	ShaderManager *pShaderManager,
+	ShaderUniforms *pShaderUniforms,
+	UniformBuffers *pUniformBuffers,
+	GLStateCache *pStateCache)
 {
 	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
-
-	// initialize the texture collection
-	for (int i = 0; i < 16; i++)
+	m_pShaderUniforms = pShaderUniforms;
+	m_pUniformBuffers = pUniformBuffers;
+	m_pStateCache = pStateCache;
+	m_meshLibrary.SetStateCache(pStateCache);
+	m_gpuCulling.SetStateCache(pStateCache);
+
+	// initialize the rendering counters
+	m_frameStats.frameCount = 0;
+	m_frameStats.drawCalls = 0;
+	m_frameStats.drawCommands = 0;
+	m_frameStats.instances = 0;
+	m_frameStats.triangles = 0;
+	m_frameStats.visibleObjects = 0;
+	m_frameStats.culledObjects = 0;
+	m_frameStats.totalDrawCalls = 0;
+
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+
+	m_bBindlessTextures = false;
+	for (int i = 0; i < TextureArrays::MAX_ARRAYS; i++)
 	{
-		m_textureIDs[i].tag = "/0";
-		m_textureIDs[i].ID = -1;
+		m_bMipmapsPending[i] = false;
 	}
-	m_loadedTextures = 0;
+	m_bGPUInstancesDirty = true;
 }
 
 /***********************************************************
@@ -54,8 +122,23 @@ SceneManager::~SceneManager()
 {
 	// free the allocated objects
 	m_pShaderManager = NULL;
-	delete m_basicMeshes;
-	m_basicMeshes = NULL;
+	m_pShaderUniforms = NULL;
+	m_pUniformBuffers = NULL;
+	m_pStateCache = NULL;
+	// free the loaded meshes and the instance buffer
+	m_meshLibrary.DestroyMeshes();
+	// free the culling compute program and its buffers
+	m_gpuCulling.Destroy();
+	// free the images that were never uploaded and the
+	// texture upload ring
+	for (size_t i = 0; i < m_streamingImages.size(); i++)
+	{
+		TextureLoader::FreeImage(m_streamingImages[i]);
+	}
+	m_streamingImages.clear();
+	m_textureStreamer.Destroy();
+	// release the bindless handles before their textures go
+	m_bindlessTextures.Destroy();
 	// free the allocated OpenGL textures
 	DestroyGLTextures();
 }
@@ -63,316 +146,520 @@ SceneManager::~SceneManager()
 /***********************************************************
  *  CreateGLTexture()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  This method is used for placing an image decoded by the
+ *  texture loader into a layer of the array texture for its
+ *  size and format, and recording the layer in the slot that
+ *  was reserved for its tag.  The pixels are uploaded later
+ *  by UploadGLTexture().
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+bool SceneManager::CreateGLTexture(const TextureLoader::DECODED_IMAGE& image)
 {
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
-
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
-
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
+	GLenum internalFormat = GL_RGB8;
+	int levels = 1;
+	int slot = FindTextureSlot(image.tag);
 
-	// if the image was successfully read from the image file
-	if (image)
+	if ((slot < 0) || (m_textureIDs[slot].arrayIndex >= 0))
 	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		std::cout << "No texture slot reserved for image:" << image.filename << std::endl;
+		return false;
+	}
 
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// if the image was successfully read from the image file
+	// or its cache file
+	if ((image.pixels) || (image.bCached))
+	{
+		std::cout << "Successfully loaded image:" << image.filename << ", width:" << image.width << ", height:" << image.height << ", channels:" << image.colorChannels << std::endl;
 
+		// if the image comes block compressed from the cache,
+		// with all of its mipmap levels
+		if (image.bCached)
+		{
+			internalFormat = (image.cached.pHeader->format == TextureCache::CACHE_FORMAT_BC3) ?
+				GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+			levels = (int)image.cached.pHeader->levelCount;
+		}
 		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+		else if (image.colorChannels == 3)
+			internalFormat = GL_RGB8;
 		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+		else if (image.colorChannels == 4)
+			internalFormat = GL_RGBA8;
 		else
 		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+			std::cout << "Not implemented to handle image with " << image.colorChannels << " channels" << std::endl;
 			return false;
 		}
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+		// every mipmap level down to 1x1 is allocated
+		if (image.bCached == false)
+		{
+			for (int size = std::max(image.width, image.height); size > 1; size /= 2)
+			{
+				levels++;
+			}
+		}
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+		int arrayIndex = -1;
+		int layer = -1;
+		bool bGrown = false;
+		if (m_textureArrays.AllocateLayer(image.width, image.height, internalFormat, levels, arrayIndex, layer, bGrown) == false)
+		{
+			return false;
+		}
+
+		// a grown array has a new texture - it is bound, or its
+		// bindless handle is made resident and written to the
+		// handle buffer, in place of the old one right away, so
+		// nothing drawn before the upload samples the deleted
+		// texture
+		if (bGrown)
+		{
+			BindGLTextures();
+			m_textureArrays.DeleteRetiredTextures();
+		}
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+		// register the layer in the reserved slot - it is not
+		// sampled until the pixels are uploaded
+		m_textureIDs[slot].arrayIndex = arrayIndex;
+		m_textureIDs[slot].layer = layer;
+		m_textureIDs[slot].bHasAlpha = (image.colorChannels == 4);
 
 		return true;
 	}
 
-	std::cout << "Could not load image:" << filename << std::endl;
+	std::cout << "Could not load image:" << image.filename << std::endl;
 
 	// Error loading the image
 	return false;
 }
 
 /***********************************************************
- *  BindGLTextures()
+ *  UploadGLTexture()
  *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  This method is used for streaming the pixels of a decoded
+ *  image into its array texture layer through the upload
+ *  ring, and binding the array.  The mipmaps of its array
+ *  are generated after the whole batch of uploads.
+ *  A cached image already has every mipmap level, so its
+ *  levels are uploaded straight from the mapped cache file.
+ *  It returns false when the ring has no room and bWait is
+ *  not set, so the upload can be carried on with on the
+ *  next frame.
  ***********************************************************/
-void SceneManager::BindGLTextures()
+bool SceneManager::UploadGLTexture(TextureLoader::DECODED_IMAGE& image, bool bWait)
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	int slot = FindTextureSlot(image.tag);
+	GLuint textureID = m_textureArrays.GetTexture(m_textureIDs[slot].arrayIndex);
+	int layer = m_textureIDs[slot].layer;
+
+	if (image.bCached)
 	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		const TextureCache::CACHED_TEXTURE& cached = image.cached;
+		GLenum internalFormat = (cached.pHeader->format == TextureCache::CACHE_FORMAT_BC3) ?
+			GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+		// the levels that fit are kept when the ring fills up
+		while (image.uploadedLevels < (int)cached.pHeader->levelCount)
+		{
+			const TextureCache::CACHE_LEVEL& level = cached.pLevels[image.uploadedLevels];
+			if (m_textureStreamer.UploadCompressedImage(
+				textureID,
+				image.uploadedLevels,
+				layer,
+				(int)level.width,
+				(int)level.height,
+				internalFormat,
+				TextureCache::GetLevelData(cached, image.uploadedLevels),
+				(GLsizeiptr)level.size,
+				bWait) == false)
+			{
+				return false;
+			}
+			image.uploadedLevels++;
+		}
+	}
+	else
+	{
+		GLenum format = (image.colorChannels == 4) ? GL_RGBA : GL_RGB;
+		GLsizeiptr size = (GLsizeiptr)image.width * image.height * image.colorChannels;
+
+		if (m_textureStreamer.UploadImage(textureID, 0, layer, image.width, image.height, format, image.pixels, size, bWait) == false)
+		{
+			return false;
+		}
+
+		// the mipmaps are generated for the whole array once the
+		// current batch of uploads is done, since generating them
+		// covers every layer of the array
+		m_bMipmapsPending[m_textureIDs[slot].arrayIndex] = true;
 	}
+
+	m_textureIDs[slot].bReady = true;
+
+	// a new array texture is bound once its first layer is in
+	BindGLTextures();
+
+	// objects that use the texture are regrouped with the
+	// other objects that sample its array
+	for (size_t i = 0; i < m_drawRecords.size(); i++)
+	{
+		if (m_drawRecords[i].surface.textureSlot == slot)
+		{
+			BuildDrawBatches();
+			break;
+		}
+	}
+
+	return true;
 }
 
 /***********************************************************
- *  DestroyGLTextures()
+ *  RequestTexture()
  *
- *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  This method is used for reserving the next texture slot
+ *  for a tag and queuing its image file for decoding.  The
+ *  slot can be used by draw records right away, and it is
+ *  drawn untextured until the texture has been streamed in.
  ***********************************************************/
-void SceneManager::DestroyGLTextures()
+bool SceneManager::RequestTexture(const std::string& filename, const std::string& tag)
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	TEXTURE_INFO textureInfo;
+
+	// the tag ID is the slot, so every tag gets exactly one slot
+	if (m_textureTags.Find(tag) >= 0)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		std::cout << "Texture tag is already in use:" << tag << std::endl;
+		return false;
 	}
+	m_textureTags.Intern(tag);
+
+	textureInfo.tag = tag;
+	textureInfo.arrayIndex = -1;
+	textureInfo.layer = -1;
+	textureInfo.bHasAlpha = false;
+	textureInfo.bReady = false;
+	m_textureIDs.push_back(textureInfo);
+
+	m_textureLoader.QueueImage(filename, tag);
+
+	return true;
 }
 
 /***********************************************************
- *  FindTextureID()
+ *  UpdateStreamedTextures()
  *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for creating and uploading the
+ *  textures whose images have been decoded.  While the scene
+ *  is running it never waits - only images that are already
+ *  decoded are taken, the uploads stop once the per frame
+ *  byte budget is used, and an upload that finds the ring
+ *  full is kept for the next frame.  With bWait set it waits
+ *  until every queued image has been uploaded.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+void SceneManager::UpdateStreamedTextures(bool bWait)
 {
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
+	PROFILE_SCOPE("Stream textures");
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	TextureLoader::DECODED_IMAGE image;
+	GLsizeiptr streamedBytes = 0;
+
+	for (;;)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		// take the next decoded image when the previous one
+		// has been uploaded
+		if (m_streamingImages.empty())
 		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
+			bool bDecoded = bWait ?
+				m_textureLoader.WaitForDecodedImage(image) :
+				m_textureLoader.PollDecodedImage(image);
+			if (bDecoded == false)
+			{
+				break;
+			}
+			if (CreateGLTexture(image) == false)
+			{
+				std::cout << "Scene texture was not loaded:" << image.tag << std::endl;
+				TextureLoader::FreeImage(image);
+				continue;
+			}
+			m_streamingImages.push_back(image);
 		}
-		else
-			index++;
+
+		TextureLoader::DECODED_IMAGE& next = m_streamingImages.front();
+		if ((bWait == false) && (streamedBytes >= STREAMING_BYTES_PER_FRAME))
+		{
+			break;
+		}
+
+		std::chrono::steady_clock::time_point uploadStart = std::chrono::steady_clock::now();
+		if (UploadGLTexture(next, bWait) == false)
+		{
+			break;
+		}
+		double uploadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - uploadStart).count();
+
+		std::cout << "INFO: Texture " << next.tag << (next.bCached ? " mapped from cache in " : " decoded in ")
+			<< next.decodeMilliseconds << " ms, ";
+		if (next.cacheMilliseconds > 0.0)
+		{
+			std::cout << "cache written in " << next.cacheMilliseconds << " ms, ";
+		}
+		std::cout << "uploaded in " << uploadTime << " ms" << std::endl;
+
+		streamedBytes += next.bCached ?
+			(GLsizeiptr)next.cached.mappedSize :
+			(GLsizeiptr)next.width * next.height * next.colorChannels;
+		TextureLoader::FreeImage(next);
+		m_streamingImages.pop_front();
 	}
 
-	return(textureID);
+	// generate the texture mipmaps for mapping textures to
+	// lower resolutions, once per array for all of the layers
+	// uploaded above
+	for (int i = 0; i < m_textureArrays.GetArrayCount(); i++)
+	{
+		if (m_bMipmapsPending[i])
+		{
+			glGenerateTextureMipmap(m_textureArrays.GetTexture(i));
+			m_bMipmapsPending[i] = false;
+		}
+	}
 }
 
 /***********************************************************
- *  FindTextureSlot()
+ *  EnableBindlessTextures()
  *
- *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for switching the scene over to the
+ *  bindless texture path.  It has to be called before the
+ *  scene is prepared, and only together with the bindless
+ *  fragment shader, which reads the array texture handles
+ *  from a shader storage buffer instead of a sampler uniform.
+ ***********************************************************/
+bool SceneManager::EnableBindlessTextures()
+{
+	m_bBindlessTextures = m_bindlessTextures.CreateBuffer();
+	return(m_bBindlessTextures);
+}
+
+/***********************************************************
+ *  EnableGPUCulling()
+ *
+ *  This method is used for switching the frustum culling
+ *  over to the compute shader.  It has to be called before
+ *  the scene is prepared.  The CPU culling stays in use when
+ *  the compute shader can not be loaded.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+bool SceneManager::EnableGPUCulling(const char* shaderFilename)
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
+	bool bEnabled = m_gpuCulling.LoadShader(shaderFilename);
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	if (bEnabled)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureSlot = index;
-			bFound = true;
-		}
-		else
-			index++;
+		m_gpuCulling.SetLODSelection(LOD_SCREEN_SIZES, LOD_HYSTERESIS);
 	}
+	m_bGPUInstancesDirty = true;
 
-	return(textureSlot);
+	return(bEnabled);
 }
 
 /***********************************************************
- *  FindMaterial()
+ *  BindGLTextures()
  *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
+ *  This method is used for binding the array textures to
+ *  OpenGL texture units, each array on the unit matching its
+ *  index.  There are up to 16 arrays.  On the bindless path
+ *  nothing is bound - the handles of new or grown arrays are
+ *  made resident and written to the handle buffer instead.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+void SceneManager::BindGLTextures()
 {
-	if (m_objectMaterials.size() == 0)
+	PROFILE_SCOPE("Bind textures");
+
+	if (m_bBindlessTextures)
 	{
-		return(false);
+		m_bindlessTextures.Update(m_textureArrays);
+		return;
 	}
 
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
+	for (int i = 0; i < m_textureArrays.GetArrayCount(); i++)
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		// bind textures on corresponding texture units
+		if (NULL != m_pStateCache)
 		{
-			bFound = true;
-			material.ambientColor = m_objectMaterials[index].ambientColor;
-			material.ambientStrength = m_objectMaterials[index].ambientStrength;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
+			m_pStateCache->BindTexture(i, m_textureArrays.GetTexture(i));
 		}
 		else
 		{
-			index++;
+			glActiveTexture(GL_TEXTURE0 + i);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrays.GetTexture(i));
 		}
 	}
 
-	return(true);
+	// point every element of the sampler array at its unit -
+	// the shader picks the element by the instance array index
+	if (NULL != m_pShaderUniforms)
+	{
+		GLint textureUnits[TextureArrays::MAX_ARRAYS];
+		for (int i = 0; i < TextureArrays::MAX_ARRAYS; i++)
+		{
+			textureUnits[i] = i;
+		}
+		m_pShaderUniforms->SetSamplerArray(ShaderUniforms::UNIFORM_OBJECT_TEXTURES, textureUnits, TextureArrays::MAX_ARRAYS);
+	}
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  DestroyGLTextures()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for freeing the memory of all the
+ *  array textures.
  ***********************************************************/
-void SceneManager::SetTransformations(
-	glm::vec3 scaleXYZ,
-	float XrotationDegrees,
-	float YrotationDegrees,
-	float ZrotationDegrees,
-	glm::vec3 positionXYZ)
+void SceneManager::DestroyGLTextures()
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
-
-	if (NULL != m_pShaderManager)
+	m_textureArrays.Destroy();
+}
+
+/***********************************************************
+ *  FindTextureID()
+ *
+ *  This method is used for getting the ID of the array texture
+ *  holding the previously loaded texture bitmap associated
+ *  with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindTextureID(std::string_view tag)
+{
+	int textureID = -1;
+	int slot = FindTextureSlot(tag);
+
+	if ((slot >= 0) && (m_textureIDs[slot].arrayIndex >= 0))
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		textureID = m_textureArrays.GetTexture(m_textureIDs[slot].arrayIndex);
 	}
+
+	return(textureID);
 }
 
 /***********************************************************
- *  SetShaderColor()
+ *  FindTextureSlot()
  *
- *  This method is used for setting the passed in color
- *  into the shader for the next draw command
+ *  This method is used for getting a slot index for the previously
+ *  loaded texture bitmap associated with the passed in tag.  The
+ *  tag ID is the slot index.
  ***********************************************************/
-void SceneManager::SetShaderColor(
-	float redColorValue,
-	float greenColorValue,
-	float blueColorValue,
-	float alphaValue)
+int SceneManager::FindTextureSlot(std::string_view tag)
 {
-	// variables for this method
-	glm::vec4 currentColor;
+	return(m_textureTags.Find(tag));
+}
 
-	currentColor.r = redColorValue;
-	currentColor.g = greenColorValue;
-	currentColor.b = blueColorValue;
-	currentColor.a = alphaValue;
+/***********************************************************
+ *  FindMaterial()
+ *
+ *  This method is used for getting a material from the previously
+ *  defined materials list that is associated with the passed in tag.
+ ***********************************************************/
+bool SceneManager::FindMaterial(std::string_view tag, OBJECT_MATERIAL& material)
+{
+	int index = FindMaterialIndex(tag);
 
-	if (NULL != m_pShaderManager)
+	if (index < 0)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		return(false);
 	}
+
+	material.ambientColor = m_objectMaterials[index].ambientColor;
+	material.ambientStrength = m_objectMaterials[index].ambientStrength;
+	material.diffuseColor = m_objectMaterials[index].diffuseColor;
+	material.specularColor = m_objectMaterials[index].specularColor;
+	material.shininess = m_objectMaterials[index].shininess;
+
+	return(true);
 }
 
 /***********************************************************
- *  SetShaderTexture()
+ *  FindMaterialIndex()
  *
- *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  This method is used for getting the index of a previously
+ *  defined material that is associated with the passed in tag.
+ *  The tag ID is the material index.
  ***********************************************************/
-void SceneManager::SetShaderTexture(
-	std::string textureTag)
+int SceneManager::FindMaterialIndex(std::string_view tag)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
-
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
-	}
+	return(m_materialTags.Find(tag));
 }
 
 /***********************************************************
- *  SetTextureUVScale()
+ *  AddObjectMaterial()
  *
- *  This method is used for setting the texture UV scale
- *  values into the shader.
+ *  This method is used for adding a material to the defined
+ *  materials list under its tag.  A material whose tag is
+ *  already defined replaces the earlier one.  The list has
+ *  to fit into the material table of the shaders.
  ***********************************************************/
-void SceneManager::SetTextureUVScale(float u, float v)
+void SceneManager::AddObjectMaterial(const OBJECT_MATERIAL& material)
 {
-	if (NULL != m_pShaderManager)
+	if ((m_materialTags.Find(material.tag) < 0) &&
+		((int)m_objectMaterials.size() >= NO_MATERIAL))
+	{
+		std::cout << "No room in the material table for material:" << material.tag << std::endl;
+		return;
+	}
+
+	int index = m_materialTags.Intern(material.tag);
+
+	if (index < (int)m_objectMaterials.size())
+	{
+		m_objectMaterials[index] = material;
+	}
+	else
 	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+		m_objectMaterials.push_back(material);
 	}
 }
 
 /***********************************************************
- *  SetShaderMaterial()
+ *  UploadObjectMaterials()
  *
- *  This method is used for passing the material values
- *  into the shader.
+ *  This method is used for copying the defined materials
+ *  into the material table uniform buffer.  The table is
+ *  uploaded once, and each instance picks its entry through
+ *  the material index in the instance data, so changing the
+ *  material between draws costs nothing.
  ***********************************************************/
-void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+void SceneManager::UploadObjectMaterials()
 {
-	if (m_objectMaterials.size() > 0)
+	PROFILE_SCOPE("Upload materials");
+
+	UniformBuffers::MATERIAL_DATA materialData;
+
+	if (NULL == m_pUniformBuffers)
 	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+		return;
+	}
 
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
+	for (int i = 0; i < UniformBuffers::TOTAL_MATERIALS; i++)
+	{
+		UniformBuffers::MATERIAL& entry = materialData.materials[i];
+		if (i < (int)m_objectMaterials.size())
 		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+			const OBJECT_MATERIAL& material = m_objectMaterials[i];
+			entry.ambientColor = material.ambientColor;
+			entry.ambientStrength = material.ambientStrength;
+			entry.diffuseColor = material.diffuseColor;
+			entry.shininess = material.shininess;
+			entry.specularColor = material.specularColor;
 		}
+		else
+		{
+			entry.ambientColor = glm::vec3(0.0f);
+			entry.ambientStrength = 0.0f;
+			entry.diffuseColor = glm::vec3(0.0f);
+			entry.shininess = 0.0f;
+			entry.specularColor = glm::vec3(0.0f);
+		}
+		entry.padding = 0.0f;
 	}
+
+	m_pUniformBuffers->UpdateMaterialData(materialData);
 }
 
 /**************************************************************/
@@ -385,47 +672,50 @@ void SceneManager::SetShaderMaterial(
  *
  *  This method is used for preparing the 3D scene by loading
  *  the shapes, textures in memory to support the 3D scene
- *  rendering
+ *  rendering.  A slot is reserved for every texture in the
+ *  scene file order, all of the image files are decoded at
+ *  the same time on the texture loader threads, and each
+ *  one is streamed to OpenGL as soon as it is decoded.
  ***********************************************************/
-void SceneManager::LoadSceneTextures()
+void SceneManager::LoadSceneTextures(const std::vector<SceneLoader::SCENE_TEXTURE>& textures)
 {
-	bool bReturn = false;
-
-	// path to load textures
-	bReturn = CreateGLTexture(
-		"textures/bark2.jpg",
-		"bark");
+	PROFILE_SCOPE("Load scene textures");
 
-	bReturn = CreateGLTexture(
-		"textures/grass.jpg",
-		"grass");
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-	bReturn = CreateGLTexture(
-		"textures/Castle_Hayne_Woods.jpg",
-		"forest");
+	// create the ring that the texture pixels are streamed
+	// through - without it the pixels are uploaded directly
+	if (m_textureStreamer.IsInitialized() == false)
+	{
+		m_textureStreamer.Initialize(TEXTURE_RING_SIZE);
+	}
 
-	bReturn = CreateGLTexture(
-		"textures/stainless.jpg",
-		"stainless");
+	// the texture cache holds BC1 and BC3 blocks, so it is
+	// only used when OpenGL can sample them
+	m_textureLoader.SetCacheEnabled(GLEW_EXT_texture_compression_s3tc != GL_FALSE);
 
-	bReturn = CreateGLTexture(
-		"textures/Wire_Mesh.png",
-		"wire_mesh");
+	// load every texture listed in the scene file
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		if (RequestTexture(textures[i].filename, textures[i].tag) == false)
+		{
+			std::cout << "Scene texture was not loaded:" << textures[i].tag << std::endl;
+		}
+	}
 
-	bReturn = CreateGLTexture(
-		"textures/metal_chain-export.png",
-		"chains");
+	// wait for all of the textures before the scene is drawn
+	UpdateStreamedTextures(true);
 
-	bReturn = CreateGLTexture(
-		"textures/white_pine_needles.png",
-		"leaves");
+	std::cout << "INFO: Loaded " << textures.size() << " scene textures in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+		<< " ms" << std::endl;
 
 	// after the texture image data is loaded into memory, the
-	// loaded textures need to be bound to texture slots - there
-	// are a total of 16 available slots for scene textures
+	// array textures need to be bound to texture units - there
+	// are a total of 16 available units for the arrays
 	BindGLTextures();
-
 }
+
 /***********************************************************
 *  DefineObjectMaterials()
 *
@@ -435,20 +725,27 @@ void SceneManager::LoadSceneTextures()
 void SceneManager::DefineObjectMaterials()
 {
 	OBJECT_MATERIAL goldMaterial;
+	goldMaterial.ambientColor = glm::vec3(0.0f, 0.0f, 0.0f);
+	goldMaterial.ambientStrength = 0.0f;
 	goldMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.4f);
 	goldMaterial.specularColor = glm::vec3(0.6f, 0.6f, 0.6f);
 	goldMaterial.shininess = 52.0;
 	goldMaterial.tag = "metal";
 
-	m_objectMaterials.push_back(goldMaterial);
+	AddObjectMaterial(goldMaterial);
 
 	OBJECT_MATERIAL woodMaterial;
+	woodMaterial.ambientColor = glm::vec3(0.0f, 0.0f, 0.0f);
+	woodMaterial.ambientStrength = 0.0f;
 	woodMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.4f);
 	woodMaterial.specularColor = glm::vec3(0.6f, 0.6f, 0.6f);
 	woodMaterial.shininess = 52.0;
 	woodMaterial.tag = "wood";
 
-	m_objectMaterials.push_back(woodMaterial);
+	AddObjectMaterial(woodMaterial);
+
+	// send the whole material table to the shaders at once
+	UploadObjectMaterials();
 }
 
 /***********************************************************
@@ -459,36 +756,53 @@ void SceneManager::DefineObjectMaterials()
  ***********************************************************/
 void SceneManager::SetupSceneLights()
 {
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
-
-	m_pShaderManager->setVec3Value("globalAmbientColor", 1.0f, 0.5f, 0.0f);
-
-	m_pShaderManager->setVec3Value("lightSources[0].position", -3.0f, 22.0f, 8.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 1.0f, 0.75f, 0.8f);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", 0.0, 1.0, 1.0);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 4.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.1f);
-
-	m_pShaderManager->setVec3Value("lightSources[1].position", 3.0f, 22.0f, 8.0f);
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", 1.0f, 0.5f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", 1.0, 0.0, 1.0);
-	m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 4.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.1f);
-
-	m_pShaderManager->setVec3Value("lightSources[2].position", -2.0f, 2.0f, -8.0f);
-	m_pShaderManager->setVec3Value("lightSources[2].diffuseColor", 1.0f, 0.5f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[2].specularColor", 0.0, 1.0, 1.0);
-	m_pShaderManager->setFloatValue("lightSources[2].focalStrength", 4.0f);
-	m_pShaderManager->setFloatValue("lightSources[2].specularIntensity", 0.2f);
-
-	m_pShaderManager->setVec3Value("lightSources[3].position", -4.0f, 6.0f, 8.0f);
-	m_pShaderManager->setVec3Value("lightSources[3].diffuseColor", 1.0f, 0.75f, 0.8f);
-	m_pShaderManager->setVec3Value("lightSources[3].specularColor", 0.0f, 0.0f, 1.0f);
-	m_pShaderManager->setFloatValue("lightSources[3].focalStrength", 64.0f);
-	m_pShaderManager->setFloatValue("lightSources[3].specularIntensity", 1.8f);
-	
+	UniformBuffers::LIGHT_DATA lightData;
+
+	if (NULL != m_pShaderUniforms)
+	{
+		m_pShaderUniforms->SetBool(ShaderUniforms::UNIFORM_USE_LIGHTING, true);
+	}
+
+	lightData.globalAmbientColor = glm::vec3(1.0f, 0.5f, 0.0f);
+	lightData.padding = 0.0f;
+
+	lightData.lightSources[0].position = glm::vec3(-3.0f, 22.0f, 8.0f);
+	lightData.lightSources[0].diffuseColor = glm::vec3(1.0f, 0.75f, 0.8f);
+	lightData.lightSources[0].specularColor = glm::vec3(0.0f, 1.0f, 1.0f);
+	lightData.lightSources[0].focalStrength = 4.0f;
+	lightData.lightSources[0].specularIntensity = 0.1f;
+
+	lightData.lightSources[1].position = glm::vec3(3.0f, 22.0f, 8.0f);
+	lightData.lightSources[1].diffuseColor = glm::vec3(1.0f, 0.5f, 0.0f);
+	lightData.lightSources[1].specularColor = glm::vec3(1.0f, 0.0f, 1.0f);
+	lightData.lightSources[1].focalStrength = 4.0f;
+	lightData.lightSources[1].specularIntensity = 0.1f;
+
+	lightData.lightSources[2].position = glm::vec3(-2.0f, 2.0f, -8.0f);
+	lightData.lightSources[2].diffuseColor = glm::vec3(1.0f, 0.5f, 0.0f);
+	lightData.lightSources[2].specularColor = glm::vec3(0.0f, 1.0f, 1.0f);
+	lightData.lightSources[2].focalStrength = 4.0f;
+	lightData.lightSources[2].specularIntensity = 0.2f;
+
+	lightData.lightSources[3].position = glm::vec3(-4.0f, 6.0f, 8.0f);
+	lightData.lightSources[3].diffuseColor = glm::vec3(1.0f, 0.75f, 0.8f);
+	lightData.lightSources[3].specularColor = glm::vec3(0.0f, 0.0f, 1.0f);
+	lightData.lightSources[3].focalStrength = 64.0f;
+	lightData.lightSources[3].specularIntensity = 1.8f;
+
+	for (int i = 0; i < UniformBuffers::TOTAL_LIGHTS; i++)
+	{
+		lightData.lightSources[i].padding = 0.0f;
+	}
+
+	// all of the light sources are sent to the shaders at once
+	if (NULL != m_pUniformBuffers)
+	{
+		m_pUniformBuffers->UpdateLightData(lightData);
+	}
 }
 
+
 /**************************************************************/
 /*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
 /*** preparing and rendering their own 3D replicated scenes.***/
@@ -500,678 +814,779 @@ void SceneManager::SetupSceneLights()
 /***********************************************************
  *  PrepareScene()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
+ *  This method is used for preparing the 3D scene by reading
+ *  the scene file, loading the textures in memory, and
+ *  building the draw records that support the 3D scene
  *  rendering
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::PrepareScene(const char* sceneFilename)
 {
+	SceneLoader sceneLoader;
+	SceneLoader::SCENE_DESCRIPTION scene;
+
+	// read the textures and objects from the scene file
+	if (sceneLoader.LoadSceneFile(sceneFilename, scene) == false)
+	{
+		return;
+	}
+
 	// load the textures for the 3D scene
-	LoadSceneTextures();
+	LoadSceneTextures(scene.textures);
+
+	// define the materials that the scene objects refer to
+	DefineObjectMaterials();
+
+	// fill the light data block with the scene light sources
+	SetupSceneLights();
 
+	// convert the scene objects into draw records - this also
+	// loads each mesh that the scene references
+	BuildDrawRecords(scene.objects);
 
+	// group the draw records that can share one draw call
+	BuildDrawBatches();
+}
+
+/***********************************************************
+ *  BuildDrawRecords()
+ *
+ *  This method is used for converting the scene file objects
+ *  into the flat list of draw records.  All of the tag lookups
+ *  happen here once instead of every frame.
+ ***********************************************************/
+void SceneManager::BuildDrawRecords(const std::vector<SceneLoader::SCENE_OBJECT>& objects)
+{
 	// only one instance of a particular mesh needs to be
 	// loaded in memory no matter how many times it is drawn
 	// in the rendered 3D scene
+	bool bMeshLoaded[MeshLibrary::MESH_TYPE_COUNT] = { false };
+
+	m_drawRecords.clear();
+	m_drawRecords.reserve(objects.size());
+	m_transforms.Clear();
+
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		const SceneLoader::SCENE_OBJECT& object = objects[i];
+		DRAW_RECORD record;
+
+		record.mesh = -1;
+		for (int mesh = 0; mesh < MeshLibrary::MESH_TYPE_COUNT; mesh++)
+		{
+			if (object.mesh.compare(g_MeshNames[mesh]) == 0)
+			{
+				record.mesh = mesh;
+			}
+		}
+		if (record.mesh < 0)
+		{
+			std::cout << "Unknown mesh \"" << object.mesh << "\" for scene object:" << object.name << std::endl;
+			continue;
+		}
+
+		// objects whose texture is missing fall back to their color
+		record.surface.textureSlot = -1;
+		if (!object.textureTag.empty())
+		{
+			record.surface.textureSlot = FindTextureSlot(object.textureTag);
+			if (record.surface.textureSlot < 0)
+			{
+				std::cout << "Unknown texture \"" << object.textureTag << "\" for scene object:" << object.name << std::endl;
+			}
+		}
+
+		record.surface.uvScale = object.uvScale;
+		record.surface.tint = object.tint;
+		record.surface.color = object.color;
+		record.materialIndex = FindMaterialIndex(object.materialTag);
+		record.transformIndex = m_transforms.AddTransform(
+			object.scaleXYZ,
+			object.rotationDegrees,
+			object.positionXYZ);
+
+		if (bMeshLoaded[record.mesh] == false)
+		{
+			m_meshLibrary.LoadMesh(record.mesh);
+			bMeshLoaded[record.mesh] = true;
+		}
+
+		m_drawRecords.push_back(record);
+	}
+
+	// every scene object is static, so the model matrices are
+	// built once here and reused by every rendered frame
+	m_transforms.UpdateModelMatrices();
+}
+
+/***********************************************************
+ *  BuildDrawBatches()
+ *
+ *  This method is used for grouping the draw records that
+ *  use the same mesh and array texture into batches.
+ *  Objects with different textures of the same size and
+ *  format share a batch, and each instance selects its own
+ *  layer of the array, UV scale and material.  Objects whose
+ *  texture is still streaming in are drawn with their color
+ *  until it arrives, when the batches are built again.  The
+ *  instance data of each batch is stored contiguously so
+ *  that the whole batch is drawn with one indirect draw
+ *  command.  Batches whose texture or color can be see-through
+ *  are marked so the render queue draws them after the solid
+ *  ones.
+ ***********************************************************/
+void SceneManager::BuildDrawBatches()
+{
+	PROFILE_SCOPE("Build draw batches");
+
+	std::vector<int> recordBatch(m_drawRecords.size(), -1);
+	std::vector<int> recordArray(m_drawRecords.size(), -1);
+
+	m_drawBatches.clear();
+	m_instanceData.clear();
+	m_instanceRecords.clear();
+	m_instanceBatches.clear();
+
+	// find or create the batch of every draw record
+	for (size_t i = 0; i < m_drawRecords.size(); i++)
+	{
+		const DRAW_RECORD& record = m_drawRecords[i];
+		int textureSlot = record.surface.textureSlot;
+
+		if ((textureSlot >= 0) && (m_textureIDs[textureSlot].bReady))
+		{
+			recordArray[i] = m_textureIDs[textureSlot].arrayIndex;
+		}
+
+		for (size_t b = 0; b < m_drawBatches.size(); b++)
+		{
+			const DRAW_BATCH& batch = m_drawBatches[b];
+			if ((batch.mesh == record.mesh) &&
+				(batch.textureArray == recordArray[i]))
+			{
+				recordBatch[i] = (int)b;
+				break;
+			}
+		}
+
+		if (recordBatch[i] < 0)
+		{
+			DRAW_BATCH batch;
+			batch.mesh = record.mesh;
+			batch.textureArray = recordArray[i];
+			batch.bTransparent = false;
+			batch.firstInstance = 0;
+			batch.instanceCount = 0;
+			batch.center = glm::vec3(0.0f);
+			recordBatch[i] = (int)m_drawBatches.size();
+			m_drawBatches.push_back(batch);
+		}
+		m_drawBatches[recordBatch[i]].instanceCount++;
+
+		// a batch is blended when any of its instances can be
+		// see-through, so it is drawn after the solid batches
+		if (recordArray[i] >= 0)
+		{
+			if ((m_textureIDs[textureSlot].bHasAlpha) || (record.surface.tint.a < 1.0f))
+			{
+				m_drawBatches[recordBatch[i]].bTransparent = true;
+			}
+		}
+		else if (record.surface.color.a < 1.0f)
+		{
+			m_drawBatches[recordBatch[i]].bTransparent = true;
+		}
+	}
 
-	// Load the Plane
-	m_basicMeshes->LoadPlaneMesh();
-	// Load the Cylinder
-	m_basicMeshes->LoadCylinderMesh();
-	// Load the Tapered Cyliner
-	m_basicMeshes->LoadTaperedCylinderMesh();
-	// Load the Cone
-	m_basicMeshes->LoadConeMesh();
+	// lay out the instance ranges of the batches back to back
+	int firstInstance = 0;
+	for (size_t b = 0; b < m_drawBatches.size(); b++)
+	{
+		m_drawBatches[b].firstInstance = firstInstance;
+		firstInstance += m_drawBatches[b].instanceCount;
+	}
+
+	// fill in the instance data in batch order
+	m_instanceData.resize(m_drawRecords.size());
+	m_instanceRecords.resize(m_drawRecords.size());
+	m_instanceBatches.resize(m_drawRecords.size());
+	m_boundsCenterX.resize(m_drawRecords.size());
+	m_boundsCenterY.resize(m_drawRecords.size());
+	m_boundsCenterZ.resize(m_drawRecords.size());
+	m_boundsRadius.resize(m_drawRecords.size());
+	m_instanceBoxes.resize(m_drawRecords.size());
+	std::vector<int> batchFill(m_drawBatches.size(), 0);
+	for (size_t i = 0; i < m_drawRecords.size(); i++)
+	{
+		const DRAW_RECORD& record = m_drawRecords[i];
+		DRAW_BATCH& batch = m_drawBatches[recordBatch[i]];
+		int instance = batch.firstInstance + batchFill[recordBatch[i]];
+		batchFill[recordBatch[i]]++;
+
+		m_instanceData[instance].model = m_transforms.GetModelMatrix(record.transformIndex);
+		m_instanceData[instance].color = (recordArray[i] >= 0) ? record.surface.tint : record.surface.color;
+		m_instanceData[instance].uvScale = record.surface.uvScale;
+		m_instanceData[instance].textureLayer = (recordArray[i] >= 0) ? (float)m_textureIDs[record.surface.textureSlot].layer : 0.0f;
+		m_instanceData[instance].textureArray = (float)recordArray[i];
+		m_instanceData[instance].materialIndex = (float)((record.materialIndex >= 0) ? record.materialIndex : NO_MATERIAL);
+		m_instanceData[instance].padding[0] = 0.0f;
+		m_instanceData[instance].padding[1] = 0.0f;
+		m_instanceData[instance].padding[2] = 0.0f;
+		m_instanceRecords[instance] = (int)i;
+		m_instanceBatches[instance] = recordBatch[i];
+		UpdateInstanceBounds(instance);
+	}
+
+	// every instance starts out visible at the full level of
+	// detail until the first cull
+	for (size_t b = 0; b < m_drawBatches.size(); b++)
+	{
+		m_drawBatches[b].visibleCount = m_drawBatches[b].instanceCount;
+		m_drawBatches[b].lodCounts[0] = m_drawBatches[b].instanceCount;
+		for (int lod = 1; lod < MeshLibrary::LOD_COUNT; lod++)
+		{
+			m_drawBatches[b].lodCounts[lod] = 0;
+		}
+	}
+	m_instanceVisible.assign(m_instanceData.size(), 1);
+	m_instanceLODs.assign(m_instanceData.size(), 0);
+	m_bvh.Build(m_instanceBoxes);
+	m_uploadedVisible.clear();
+	m_uploadedLODs.clear();
+	m_drawInstanceData = m_instanceData;
+	m_meshLibrary.SetInstanceData(m_drawInstanceData.data(), (int)m_drawInstanceData.size());
+	m_bGPUInstancesDirty = true;
+
+	std::cout << "INFO: Grouped " << m_drawRecords.size() << " scene objects into " << m_drawBatches.size() << " instanced draw batches" << std::endl;
+}
+
+/***********************************************************
+ *  UpdateInstanceData()
+ *
+ *  This method is used for rebuilding the model matrices of
+ *  any objects that moved since the last frame and copying
+ *  them and their new bounding spheres into the instance
+ *  data.  It returns true when any object moved.
+ ***********************************************************/
+bool SceneManager::UpdateInstanceData()
+{
+	PROFILE_SCOPE("Update instances");
+
+	bool bChanged = false;
+
+	// static scenes skip the scan entirely
+	if (m_transforms.GetDirtyCount() == 0)
+	{
+		return(false);
+	}
+
+	for (size_t instance = 0; instance < m_instanceRecords.size(); instance++)
+	{
+		int transformIndex = m_drawRecords[m_instanceRecords[instance]].transformIndex;
+		if (m_transforms.IsDirty(transformIndex))
+		{
+			m_instanceData[instance].model = m_transforms.GetModelMatrix(transformIndex);
+			UpdateInstanceBounds((int)instance);
+			m_bvh.SetObjectBounds((int)instance, m_instanceBoxes[instance]);
+			bChanged = true;
+		}
+	}
+
+	// the hierarchy keeps its structure and only grows or
+	// shrinks its boxes around the moved objects
+	if (bChanged)
+	{
+		m_bvh.Refit();
+	}
+
+	return(bChanged);
+}
+
+/***********************************************************
+ *  UpdateInstanceBounds()
+ *
+ *  This method is used for computing the world space bounding
+ *  sphere and box of an instance.  The sphere surrounds the
+ *  scaled local bounding box of the mesh, so its radius does
+ *  not depend on the rotation of the object.  The box holds
+ *  the rotated local box, its half size along each world axis
+ *  is the absolute model matrix times the local half size.
+ ***********************************************************/
+void SceneManager::UpdateInstanceBounds(int instance)
+{
+	const DRAW_RECORD& record = m_drawRecords[m_instanceRecords[instance]];
+	const glm::vec3& boundsMin = m_meshLibrary.GetBoundsMin(record.mesh);
+	const glm::vec3& boundsMax = m_meshLibrary.GetBoundsMax(record.mesh);
+
+	const glm::mat4& model = m_instanceData[instance].model;
+
+	glm::vec3 localCenter = (boundsMin + boundsMax) * 0.5f;
+	glm::vec3 localHalfSize = (boundsMax - boundsMin) * 0.5f;
+	glm::vec3 halfSize = localHalfSize * m_transforms.GetScale(record.transformIndex);
+	glm::vec3 center = glm::vec3(model * glm::vec4(localCenter, 1.0f));
+
+	m_boundsCenterX[instance] = center.x;
+	m_boundsCenterY[instance] = center.y;
+	m_boundsCenterZ[instance] = center.z;
+	m_boundsRadius[instance] = glm::length(halfSize);
+
+	glm::vec3 worldHalfSize(0.0f);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		worldHalfSize += glm::abs(glm::vec3(model[axis])) * localHalfSize[axis];
+	}
+	m_instanceBoxes[instance].boundsMin = center - worldHalfSize;
+	m_instanceBoxes[instance].boundsMax = center + worldHalfSize;
+}
+
+/***********************************************************
+ *  CullInstances()
+ *
+ *  This method is used for testing every instance against
+ *  the view frustum of the current frame and counting the
+ *  visible and culled objects.  Large scenes only visit the
+ *  branches of the bounding volume hierarchy that touch the
+ *  frustum, while small scenes test every bounding sphere.
+ ***********************************************************/
+void SceneManager::CullInstances()
+{
+	PROFILE_SCOPE("Cull instances");
+
+	int instanceCount = (int)m_instanceData.size();
+	int visibleCount = 0;
+
+	m_frustum.SetFromMatrix(m_projectionMatrix * m_viewMatrix);
+
+	if (instanceCount >= BVH_CULL_THRESHOLD)
+	{
+		m_queryResults.clear();
+		m_bvh.QueryFrustum(m_frustum, m_queryResults);
+
+		std::fill(m_instanceVisible.begin(), m_instanceVisible.end(), 0);
+		for (size_t i = 0; i < m_queryResults.size(); i++)
+		{
+			m_instanceVisible[m_queryResults[i]] = 1;
+		}
+		visibleCount = (int)m_queryResults.size();
+	}
+	else
+	{
+		visibleCount = m_frustum.CullSpheres(
+			m_boundsCenterX.data(),
+			m_boundsCenterY.data(),
+			m_boundsCenterZ.data(),
+			m_boundsRadius.data(),
+			instanceCount,
+			m_instanceVisible.data());
+	}
+
+	m_frameStats.visibleObjects = visibleCount;
+	m_frameStats.culledObjects = instanceCount - visibleCount;
+}
+
+/***********************************************************
+ *  SelectInstanceLODs()
+ *
+ *  This method is used for picking the level of detail of
+ *  every visible instance from the height of its bounding
+ *  sphere on the screen.  The size is the radius over the
+ *  view depth scaled by the projection, which is half of the
+ *  projected diameter in normalized device coordinates - so
+ *  a fraction of the screen height.  Culled instances keep
+ *  their level until they come back into view.
+ ***********************************************************/
+void SceneManager::SelectInstanceLODs()
+{
+	PROFILE_SCOPE("Select levels of detail");
+
+	float projectionScale = m_projectionMatrix[1][1];
+
+	for (size_t instance = 0; instance < m_instanceLODs.size(); instance++)
+	{
+		if (m_instanceVisible[instance] == 0)
+		{
+			continue;
+		}
+
+		glm::vec3 center(m_boundsCenterX[instance], m_boundsCenterY[instance], m_boundsCenterZ[instance]);
+		float radius = m_boundsRadius[instance];
+		float depth = -(m_viewMatrix * glm::vec4(center, 1.0f)).z;
+
+		// the camera is inside or right next to the sphere
+		float screenSize = (depth > radius) ? (radius * projectionScale / depth) : FLT_MAX;
+		m_instanceLODs[instance] = (unsigned char)SelectLOD(screenSize, m_instanceLODs[instance]);
+	}
+}
+
+/***********************************************************
+ *  UploadVisibleInstances()
+ *
+ *  This method is used for packing the visible instances of
+ *  each batch to the front of the batch's instance range,
+ *  grouped by their level of detail, and uploading the
+ *  result, so that each batch still draws its visible
+ *  instances with one call per level.
+ ***********************************************************/
+void SceneManager::UploadVisibleInstances()
+{
+	PROFILE_SCOPE("Upload instances");
+
+	for (size_t b = 0; b < m_drawBatches.size(); b++)
+	{
+		DRAW_BATCH& batch = m_drawBatches[b];
+		int visibleCount = 0;
+
+		for (int lod = 0; lod < MeshLibrary::LOD_COUNT; lod++)
+		{
+			int lodStart = visibleCount;
+
+			for (int instance = batch.firstInstance; instance < batch.firstInstance + batch.instanceCount; instance++)
+			{
+				if ((m_instanceVisible[instance] != 0) && (m_instanceLODs[instance] == lod))
+				{
+					m_drawInstanceData[batch.firstInstance + visibleCount] = m_instanceData[instance];
+					visibleCount++;
+				}
+			}
+			batch.lodCounts[lod] = visibleCount - lodStart;
+		}
+		batch.visibleCount = visibleCount;
+	}
+
+	m_meshLibrary.SetInstanceData(m_drawInstanceData.data(), (int)m_drawInstanceData.size());
+	m_uploadedVisible = m_instanceVisible;
+	m_uploadedLODs = m_instanceLODs;
+}
+
+/***********************************************************
+ *  UploadCullingInstances()
+ *
+ *  This method is used for handing every instance, its
+ *  bounding sphere and its batch to the GPU culling, and for
+ *  finding the center of each batch that its depth is sorted
+ *  by.  This only happens when the batches are built or
+ *  objects move, not every frame.
+ ***********************************************************/
+void SceneManager::UploadCullingInstances()
+{
+	PROFILE_SCOPE("Upload culling instances");
+
+	m_gpuCulling.SetInstances(
+		m_instanceData.data(),
+		m_boundsCenterX.data(),
+		m_boundsCenterY.data(),
+		m_boundsCenterZ.data(),
+		m_boundsRadius.data(),
+		m_instanceBatches.data(),
+		(int)m_instanceData.size());
+
+	// the visible instances are written into the instance
+	// buffer, where the levels of detail of a batch share the
+	// range of the batch
+	m_meshLibrary.ReserveInstances((int)m_instanceData.size());
+
+	for (size_t b = 0; b < m_drawBatches.size(); b++)
+	{
+		DRAW_BATCH& batch = m_drawBatches[b];
+		glm::vec3 center(0.0f);
+
+		for (int instance = batch.firstInstance; instance < batch.firstInstance + batch.instanceCount; instance++)
+		{
+			center += glm::vec3(m_instanceData[instance].model[3]);
+		}
+		batch.center = (batch.instanceCount > 0) ? center / (float)batch.instanceCount : center;
+	}
+
+	m_bGPUInstancesDirty = false;
+}
+
+/***********************************************************
+ *  PickObject()
+ *
+ *  This method is used for finding the scene object whose
+ *  bounding box is hit first by a ray, for selecting objects
+ *  with the mouse.
+ ***********************************************************/
+int SceneManager::PickObject(const glm::vec3& origin, const glm::vec3& direction, float& hitDistance)
+{
+	int instance = m_bvh.RayCast(origin, direction, FLT_MAX, hitDistance);
+
+	return((instance >= 0) ? m_instanceRecords[instance] : -1);
+}
+
+/***********************************************************
+ *  FindNearestObject()
+ *
+ *  This method is used for finding the scene object whose
+ *  bounding box is nearest to a point.
+ ***********************************************************/
+int SceneManager::FindNearestObject(const glm::vec3& point, float& distance)
+{
+	int instance = m_bvh.FindNearest(point, distance);
+
+	return((instance >= 0) ? m_instanceRecords[instance] : -1);
+}
+
+/***********************************************************
+ *  SetCameraView()
+ *
+ *  This method is used for passing in the view and projection
+ *  matrices of the frame that is about to be rendered.
+ ***********************************************************/
+void SceneManager::SetCameraView(
+	const glm::mat4& view,
+	const glm::mat4& projection)
+{
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
 }
 
 /***********************************************************
  *  RenderScene()
  *
  *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  culling the objects outside of the view, submitting every
+ *  batch with visible basic 3D shapes to the render queue,
+ *  sorting the queue, and drawing all of the batches with a
+ *  single multi-draw call - one indirect draw command per
+ *  batch, in queue order.  Every per-object value comes from
+ *  the instance data, so nothing changes between the batches
+ *  and the CPU cost per frame does not grow with the number
+ *  of batches.  The culling runs in a compute shader when it
+ *  has been enabled.
  ***********************************************************/
 void SceneManager::RenderScene()
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("grass");
-	SetTextureUVScale(5.0f, 5.0f);
-	// Draw the textured plane
-	m_basicMeshes->DrawPlaneMesh();
-
-	SetShaderColor(0.0, 1, 0.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 90.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 10.0f, -10.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	//SetShaderTexture("grass");
-	//SetTextureUVScale(1.0f, 1.0f);
-	// Draw the textured plane
-	//m_basicMeshes->DrawPlaneMesh();
-
-	// Set texture
-	SetShaderTexture("forest");
-	SetTextureUVScale(1.0f, 1.0f);
-	// Draw the textured plane
-	m_basicMeshes->DrawPlaneMesh();
-
-	SetShaderColor(0.0, 1, 0.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the start of the disc golf basket                  ***/
-	/*** This is the pole in the center                             ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(0.1f, 8.0f, 0.1f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("stainless");
-	SetTextureUVScale(1.0f, 1.0f);
-	SetShaderMaterial("metal");
-	// Draw the textured plane
-	m_basicMeshes->DrawCylinderMesh();
-
-	SetShaderColor(0.75, 0.75, 0.75, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/*** This is the basket                                         ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(2.0f, 1.3f, 2.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 3.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("wire_mesh");
-	SetTextureUVScale(2.0f, 2.0f);
-	SetShaderMaterial("metal");
-	// Draw the textured plane
-	m_basicMeshes->DrawCylinderMesh();
-
-	SetShaderColor(0.75, 0.75, 0.75, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the top of the topper                              ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(1.7f, 0.8f, 1.7f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 7.5f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(1.0, 1.0, 1.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the top of the chains                              ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(1.5f, 4.5f, 1.5f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 180.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 7.5f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("chains");
-	SetTextureUVScale(3.0f, 3.0f);
-	SetShaderMaterial("metal");
-	// Draw the textured plane
-	m_basicMeshes->DrawTaperedCylinderMesh();
-
-	SetShaderColor(1.0, 0.8, 1.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawTaperedCylinderMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the start of the trees 1                           ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(1.0f, 15.0f, 1.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(20.0f, 0.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("bark");
-	SetTextureUVScale(5.0f, 5.0f);
-	// Draw the textured plane
-	m_basicMeshes->DrawCylinderMesh();
-
-	SetShaderColor(0.6, 0.3, 0.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the start of the trees 1                           ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(2.0f, 3.0f, 2.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(20.0f, 0.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("bark");
-	SetTextureUVScale(5.0f, 5.0f);
-	// Draw the textured plane
-	m_basicMeshes->DrawTaperedCylinderMesh();
-
-	// set the color for the next draw command
-	SetShaderColor(0.6, 0.3, 0.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawTaperedCylinderMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the start of the trees 2                           ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(1.0f, 15.0f, 1.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-20.0f, 0.0f, -6.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("bark");
-	SetTextureUVScale(5.0f, 5.0f);
-	// Draw the textured plane
-	m_basicMeshes->DrawCylinderMesh();
-
-	SetShaderColor(0.6, 0.3, 0.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the start of the trees 2                           ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(2.0f, 3.0f, 2.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-20.0f, 0.0f, -6.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("bark");
-	SetTextureUVScale(5.0f, 5.0f);
-	// Draw the textured plane
-	m_basicMeshes->DrawTaperedCylinderMesh();
-
-	// set the color for the next draw command
-	SetShaderColor(0.6, 0.3, 0.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawTaperedCylinderMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the start of the trees 3                           ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(1.0f, 15.0f, 1.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-10.0f, 0.0f, 7.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("bark");
-	SetTextureUVScale(5.0f, 5.0f);
-	// Draw the textured plane
-	m_basicMeshes->DrawCylinderMesh();
-
-	SetShaderColor(0.6, 0.3, 0.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the start of the trees 3                           ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(2.0f, 3.0f, 2.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-10.0f, 0.0f, 7.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("bark");
-	SetTextureUVScale(5.0f, 5.0f);
-	// Draw the textured plane
-	m_basicMeshes->DrawTaperedCylinderMesh();
-
-	// set the color for the next draw command
-	SetShaderColor(0.6, 0.3, 0.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawTaperedCylinderMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the start of the trees leaves 1                    ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(5.0f, 10.0f, 5.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(20.0f, 10.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("leaves");
-	SetTextureUVScale(8.0f, 8.0f);
-	// Draw the textured plane
-	m_basicMeshes->DrawConeMesh();
-
-	SetShaderColor(0.0, 0.5, 0.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawConeMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the start of the trees leaves 1                    ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(3.0f, 7.0f, 3.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(20.0f, 15.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("leaves");
-	SetTextureUVScale(8.0f, 8.0f);
-	// Draw the textured plane
-	m_basicMeshes->DrawConeMesh();
-
-	SetShaderColor(0.0, 0.5, 0.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawConeMesh();
-
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the start of the trees leaves 2                    ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(5.0f, 10.0f, 5.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-20.0f, 10.0f, -6.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("leaves");
-	SetTextureUVScale(8.0f, 8.0f);
-	// Draw the textured plane
-	m_basicMeshes->DrawConeMesh();
-
-	SetShaderColor(0.0, 0.5, 0.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawConeMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the start of the trees leaves 2                    ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(3.0f, 7.0f, 3.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-20.0f, 15.0f, -6.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("leaves");
-	SetTextureUVScale(8.0f, 8.0f);
-	// Draw the textured plane
-	m_basicMeshes->DrawConeMesh();
-
-	SetShaderColor(0.0, 0.5, 0.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawConeMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the start of the trees leaves 3                    ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(5.0f, 10.0f, 5.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-10.0f, 10.0f, 7.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("leaves");
-	SetTextureUVScale(8.0f, 8.0f);
-	// Draw the textured plane
-	m_basicMeshes->DrawConeMesh();
-
-	SetShaderColor(0.0, 0.5, 0.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawConeMesh();
-	/****************************************************************/
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.                       ***/
-	/*** This is the start of the trees leaves 3                    ***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(3.0f, 7.0f, 3.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-10.0f, 15.0f, 7.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set texture
-	SetShaderTexture("leaves");
-	SetTextureUVScale(8.0f, 8.0f);
-	// Draw the textured plane
-	m_basicMeshes->DrawConeMesh();
-
-	SetShaderColor(0.0, 0.5, 0.0, 1);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawConeMesh();
+	// start counting the draw calls for this frame
+	m_frameStats.totalDrawCalls += m_frameStats.drawCalls;
+	m_frameStats.drawCalls = 0;
+	m_frameStats.drawCommands = 0;
+	m_frameStats.instances = 0;
+	m_frameStats.triangles = 0;
+	m_frameStats.frameCount++;
+
+	// upload any textures requested while the scene is running
+	if ((m_textureLoader.GetPendingCount() > 0) || (!m_streamingImages.empty()))
+	{
+		UpdateStreamedTextures(false);
+	}
+
+	// refresh the instance data of objects that moved
+	bool bInstancesChanged = UpdateInstanceData();
+
+	if (m_gpuCulling.IsEnabled())
+	{
+		if (bInstancesChanged)
+		{
+			m_bGPUInstancesDirty = true;
+		}
+		DrawGPUCulledBatches();
+	}
+	else
+	{
+		// find the objects inside the view frustum and their
+		// levels of detail, and only upload the instance data
+		// again when the visible set, their levels or the
+		// visible objects changed
+		CullInstances();
+		SelectInstanceLODs();
+		if ((bInstancesChanged) ||
+			(m_instanceVisible != m_uploadedVisible) ||
+			(m_instanceLODs != m_uploadedLODs))
+		{
+			UploadVisibleInstances();
+		}
+		DrawCPUCulledBatches();
+	}
+}
+
+/***********************************************************
+ *  NeedsRedraw()
+ *
+ *  This method is used for checking whether the scene would
+ *  look different in the next frame, with the same camera.
+ *  That is the case while requested textures are still being
+ *  decoded or uploaded, and when objects have moved.
+ ***********************************************************/
+bool SceneManager::NeedsRedraw()
+{
+	return((m_textureLoader.GetPendingCount() > 0) ||
+		(!m_streamingImages.empty()) ||
+		(m_transforms.GetDirtyCount() > 0));
+}
+
+/***********************************************************
+ *  DrawCPUCulledBatches()
+ *
+ *  This method is used for submitting every batch with
+ *  visible instances to the render queue, with its view
+ *  depth measured at the center of those instances, and
+ *  drawing them with one indirect draw command for each
+ *  level of detail that has instances.
+ ***********************************************************/
+void SceneManager::DrawCPUCulledBatches()
+{
+	PROFILE_GPU_SCOPE("Draw batches");
+
+	m_renderQueue.Clear();
+	for (size_t i = 0; i < m_drawBatches.size(); i++)
+	{
+		const DRAW_BATCH& batch = m_drawBatches[i];
+		glm::vec3 center(0.0f);
+
+		if (batch.visibleCount == 0)
+		{
+			continue;
+		}
+
+		for (int instance = batch.firstInstance; instance < batch.firstInstance + batch.visibleCount; instance++)
+		{
+			center += glm::vec3(m_drawInstanceData[instance].model[3]);
+		}
+		center /= (float)batch.visibleCount;
+		float depth = -(m_viewMatrix * glm::vec4(center, 1.0f)).z;
+
+		m_renderQueue.Submit(
+			RenderQueue::MakeKey(SCENE_PROGRAM, batch.bTransparent, batch.textureArray, batch.mesh, depth),
+			(int)i);
+	}
+	m_renderQueue.Sort();
+
+	m_drawCommands.clear();
+	for (int i = 0; i < m_renderQueue.GetCount(); i++)
+	{
+		const DRAW_BATCH& batch = m_drawBatches[m_renderQueue.GetItem(i).payload];
+		int firstInstance = batch.firstInstance;
+
+		for (int lod = 0; lod < MeshLibrary::LOD_COUNT; lod++)
+		{
+			if (batch.lodCounts[lod] > 0)
+			{
+				MeshLibrary::DRAW_COMMAND command;
+				m_meshLibrary.MakeDrawCommand(batch.mesh, lod, firstInstance, batch.lodCounts[lod], command);
+				m_drawCommands.push_back(command);
+				m_frameStats.triangles += batch.lodCounts[lod] * m_meshLibrary.GetTriangleCount(batch.mesh, lod);
+			}
+			firstInstance += batch.lodCounts[lod];
+		}
+		m_frameStats.instances += batch.visibleCount;
+	}
+
+	if (!m_drawCommands.empty())
+	{
+		m_meshLibrary.SetDrawCommands(m_drawCommands.data(), (int)m_drawCommands.size());
+		m_meshLibrary.DrawIndirect(0, (int)m_drawCommands.size());
+
+		m_frameStats.drawCalls++;
+		m_frameStats.drawCommands += (unsigned int)m_drawCommands.size();
+	}
 }
 
+/***********************************************************
+ *  DrawGPUCulledBatches()
+ *
+ *  This method is used for drawing the batches when the
+ *  compute shader does the culling.  Every batch is submitted
+ *  with its depth measured at the center of all of its
+ *  instances, and gets one draw command without instances for
+ *  each level of detail, all starting at the first instance
+ *  of the batch.  The levels share the batch's instance
+ *  range - the compute shader counts the visible instances
+ *  of every level, splits the range into one slice per level
+ *  from those counts, and copies the instances into their
+ *  slices, so the commands are drawn without the CPU ever
+ *  reading them back.  The visible and culled object
+ *  counts are not known on the CPU in this mode, so every
+ *  instance is counted as submitted.
+ ***********************************************************/
+void SceneManager::DrawGPUCulledBatches()
+{
+	PROFILE_GPU_SCOPE("Cull and draw batches");
+
+	if (m_bGPUInstancesDirty)
+	{
+		UploadCullingInstances();
+	}
+
+	m_frustum.SetFromMatrix(m_projectionMatrix * m_viewMatrix);
+
+	m_renderQueue.Clear();
+	for (size_t i = 0; i < m_drawBatches.size(); i++)
+	{
+		const DRAW_BATCH& batch = m_drawBatches[i];
+
+		if (batch.instanceCount == 0)
+		{
+			continue;
+		}
+
+		float depth = -(m_viewMatrix * glm::vec4(batch.center, 1.0f)).z;
+		m_renderQueue.Submit(
+			RenderQueue::MakeKey(SCENE_PROGRAM, batch.bTransparent, batch.textureArray, batch.mesh, depth),
+			(int)i);
+	}
+	m_renderQueue.Sort();
+
+	m_drawCommands.resize(m_renderQueue.GetCount() * MeshLibrary::LOD_COUNT);
+	m_batchCommands.assign(m_drawBatches.size(), -1);
+	for (int i = 0; i < m_renderQueue.GetCount(); i++)
+	{
+		int batchIndex = m_renderQueue.GetItem(i).payload;
+		const DRAW_BATCH& batch = m_drawBatches[batchIndex];
+
+		// every level starts at the first instance of the batch
+		// until the compute shader splits the range between them
+		for (int lod = 0; lod < MeshLibrary::LOD_COUNT; lod++)
+		{
+			m_meshLibrary.MakeDrawCommand(
+				batch.mesh,
+				lod,
+				batch.firstInstance,
+				0,
+				m_drawCommands[i * MeshLibrary::LOD_COUNT + lod]);
+		}
+		m_batchCommands[batchIndex] = i * MeshLibrary::LOD_COUNT;
+		m_frameStats.instances += batch.instanceCount;
+	}
+
+	if (!m_drawCommands.empty())
+	{
+		// the scene program is selected again after the compute
+		// pass - without the cached uniforms it is the program
+		// that is current now
+		GLuint sceneProgram = 0;
+		if (NULL != m_pShaderUniforms)
+		{
+			sceneProgram = m_pShaderUniforms->GetProgramID();
+		}
+		else
+		{
+			GLint currentProgram = 0;
+			glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+			sceneProgram = (GLuint)currentProgram;
+		}
+
+		m_meshLibrary.SetDrawCommands(m_drawCommands.data(), (int)m_drawCommands.size());
+		m_gpuCulling.Dispatch(
+			m_frustum,
+			m_viewMatrix,
+			m_projectionMatrix[1][1],
+			m_batchCommands.data(),
+			(int)m_batchCommands.size(),
+			m_meshLibrary.GetInstanceBuffer(),
+			m_meshLibrary.GetCommandBuffer());
+
+		// the compute program is still selected
+		if (NULL != m_pStateCache)
+		{
+			m_pStateCache->UseProgram(sceneProgram);
+		}
+		else
+		{
+			glUseProgram(sceneProgram);
+		}
+		m_meshLibrary.DrawIndirect(0, (int)m_drawCommands.size());
+
+		m_frameStats.drawCalls++;
+		m_frameStats.drawCommands += (unsigned int)m_drawCommands.size();
+	}
+}
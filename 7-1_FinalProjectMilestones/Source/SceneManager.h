@@ -10,9 +10,25 @@
 #pragma once
 
 #include "ShaderManager.h"
-#include "ShapeMeshes.h"
+#include "GLStateCache.h"
+#include "ShaderUniforms.h"
+#include "BindlessTextures.h"
+#include "GPUCulling.h"
+#include "MeshLibrary.h"
+#include "RenderQueue.h"
+#include "UniformBuffers.h"
+#include "SceneLoader.h"
+#include "SceneBVH.h"
+#include "SceneTransforms.h"
+#include "TagTable.h"
+#include "TextureArrays.h"
+#include "TextureLoader.h"
+#include "TextureStreamer.h"
+#include "ViewFrustum.h"
 
+#include <deque>
 #include <string>
+#include <string_view>
 #include <vector>
 
 /***********************************************************
@@ -25,14 +41,23 @@ class SceneManager
 {
 public:
 	// constructor
-	SceneManager(ShaderManager *pShaderManager);
+	SceneManager(
+		ShaderManager *pShaderManager,
+		ShaderUniforms *pShaderUniforms,
+		UniformBuffers *pUniformBuffers,
+		GLStateCache *pStateCache);
 	// destructor
 	~SceneManager();
 
+	// a scene texture and the array texture layer holding it
 	struct TEXTURE_INFO
 	{
 		std::string tag;
-		uint32_t ID;
+		int arrayIndex;
+		int layer;
+		bool bHasAlpha;
+		// false until the pixels have been uploaded
+		bool bReady;
 	};
 
 	struct OBJECT_MATERIAL
@@ -45,70 +70,233 @@ public:
 		std::string tag;
 	};
 
+	// everything the shader needs to color one object in a
+	// single draw - the texture is multiplied by the tint, and
+	// the color is used when there is no texture
+	struct SURFACE
+	{
+		int textureSlot;
+		glm::vec2 uvScale;
+		glm::vec4 tint;
+		glm::vec4 color;
+	};
+
+	// one fully resolved scene object - all tags are converted
+	// to slots and indices when the scene is prepared
+	struct DRAW_RECORD
+	{
+		int mesh;
+		SURFACE surface;
+		int materialIndex;
+		int transformIndex;
+	};
+
+	// a run of draw records that share the same mesh and array
+	// texture - drawn with one indirect draw command for each
+	// level of detail, with the UV scale, texture layer and
+	// material picked per instance
+	struct DRAW_BATCH
+	{
+		int mesh;
+		int textureArray;
+		bool bTransparent;
+		int firstInstance;
+		int instanceCount;
+		int visibleCount;
+		// visible instances at each level of detail, packed one
+		// level after the other
+		int lodCounts[MeshLibrary::LOD_COUNT];
+		// center of all of the instances, for depth sorting
+		// when the GPU culls the instances
+		glm::vec3 center;
+	};
+
+	// rendering counters for measuring the scene cost
+	struct FRAME_STATS
+	{
+		unsigned int frameCount;
+		unsigned int drawCalls;
+		unsigned int drawCommands;
+		unsigned int instances;
+		unsigned int triangles;
+		unsigned int visibleObjects;
+		unsigned int culledObjects;
+		unsigned long long totalDrawCalls;
+	};
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
-	// pointer to basic shapes object
-	ShapeMeshes* m_basicMeshes;
-	// total number of loaded textures
-	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
+	// pointer to the cached shader uniform locations
+	ShaderUniforms* m_pShaderUniforms;
+	// pointer to the shared uniform buffers
+	UniformBuffers* m_pUniformBuffers;
+	// pointer to the OpenGL state cache
+	GLStateCache* m_pStateCache;
+	// basic shape meshes drawn with hardware instancing
+	MeshLibrary m_meshLibrary;
+	// decodes texture image files on worker threads
+	TextureLoader m_textureLoader;
+	// streams decoded pixels to OpenGL through a mapped ring
+	TextureStreamer m_textureStreamer;
+	// decoded images whose textures are not uploaded yet
+	std::deque<TextureLoader::DECODED_IMAGE> m_streamingImages;
+	// array textures that the scene textures are packed into
+	TextureArrays m_textureArrays;
+	// arrays with uploaded layers whose mipmaps have not been
+	// generated yet
+	bool m_bMipmapsPending[TextureArrays::MAX_ARRAYS];
+	// resident handles of the array textures for the bindless
+	// path, used instead of texture units when enabled
+	BindlessTextures m_bindlessTextures;
+	bool m_bBindlessTextures;
+	// loaded textures info, indexed by texture slot
+	std::vector<TEXTURE_INFO> m_textureIDs;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// texture and material tags - the ID of a texture tag is
+	// its texture slot, and the ID of a material tag is the
+	// index of the material
+	TagTable m_textureTags;
+	TagTable m_materialTags;
+	// flat list of draw records built from the scene file
+	std::vector<DRAW_RECORD> m_drawRecords;
+	// instanced draw batches built from the draw records
+	std::vector<DRAW_BATCH> m_drawBatches;
+	// per-instance data in batch order, and the draw record
+	// and batch that each instance was built from
+	std::vector<MeshLibrary::INSTANCE_DATA> m_instanceData;
+	std::vector<int> m_instanceRecords;
+	std::vector<int> m_instanceBatches;
+	// world space bounding spheres in instance order, stored
+	// as separate component arrays for the frustum test
+	std::vector<float> m_boundsCenterX;
+	std::vector<float> m_boundsCenterY;
+	std::vector<float> m_boundsCenterZ;
+	std::vector<float> m_boundsRadius;
+	// world space bounding boxes in instance order, and the
+	// bounding volume hierarchy built over them
+	std::vector<SceneBVH::AABB> m_instanceBoxes;
+	SceneBVH m_bvh;
+	// instances returned by the hierarchy frustum query
+	std::vector<int> m_queryResults;
+	// frustum test results in instance order for this frame
+	// and for the instance data that was last uploaded
+	std::vector<unsigned char> m_instanceVisible;
+	std::vector<unsigned char> m_uploadedVisible;
+	// level of detail of every instance in instance order for
+	// this frame and for the last uploaded instance data
+	std::vector<unsigned char> m_instanceLODs;
+	std::vector<unsigned char> m_uploadedLODs;
+	// visible instances packed to the front of each batch range
+	std::vector<MeshLibrary::INSTANCE_DATA> m_drawInstanceData;
+	// indirect draw commands of the current frame, in render
+	// queue order
+	std::vector<MeshLibrary::DRAW_COMMAND> m_drawCommands;
+	// culls the instances in a compute shader when enabled,
+	// and whether its copy of the instances is out of date
+	GPUCulling m_gpuCulling;
+	bool m_bGPUInstancesDirty;
+	// draw command of every batch this frame, -1 when the
+	// batch is not drawn
+	std::vector<int> m_batchCommands;
+	// transforms and cached model matrices of the scene objects
+	SceneTransforms m_transforms;
+	// rendering counters
+	FRAME_STATS m_frameStats;
+	// draw batches of the current frame sorted by render state
+	RenderQueue m_renderQueue;
+	// camera matrices of the current frame for depth sorting
+	// and culling
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// view frustum of the current frame
+	ViewFrustum m_frustum;
 
-	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
-	// bind loaded OpenGL textures to slots in memory
+	// create the OpenGL texture for a decoded texture image
+	bool CreateGLTexture(const TextureLoader::DECODED_IMAGE& image);
+	// stream the pixels of a decoded image into its texture
+	bool UploadGLTexture(TextureLoader::DECODED_IMAGE& image, bool bWait);
+	// create and upload the textures of decoded images
+	void UpdateStreamedTextures(bool bWait);
+	// bind the array textures to texture units, or update
+	// their handles on the bindless path
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(std::string_view tag);
+	int FindTextureSlot(std::string_view tag);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
-
-	// set the transformation values 
-	// into the transform buffer
-	void SetTransformations(
-		glm::vec3 scaleXYZ,
-		float XrotationDegrees,
-		float YrotationDegrees,
-		float ZrotationDegrees,
-		glm::vec3 positionXYZ);
-
-	// set the color values into the shader
-	void SetShaderColor(
-		float redColorValue,
-		float greenColorValue,
-		float blueColorValue,
-		float alphaValue);
-
-	// set the texture data into the shader
-	void SetShaderTexture(
-		std::string textureTag);
-
-	// set the UV scale for the texture mapping
-	void SetTextureUVScale(
-		float u, float v);
-
-	// set the object material into the shader
-	void SetShaderMaterial(
-		std::string materialTag);
+	bool FindMaterial(std::string_view tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(std::string_view tag);
+	// add a material to the defined materials under its tag
+	void AddObjectMaterial(const OBJECT_MATERIAL& material);
+
+	// convert the scene file objects into draw records
+	void BuildDrawRecords(const std::vector<SceneLoader::SCENE_OBJECT>& objects);
+	// group the draw records into instanced draw batches
+	void BuildDrawBatches();
+	// copy the model matrices of moved objects into the
+	// instance data - returns true when anything moved
+	bool UpdateInstanceData();
+	// recompute the world bounding sphere and box of an instance
+	void UpdateInstanceBounds(int instance);
+	// test every instance against the view frustum
+	void CullInstances();
+	// pick the level of detail of every visible instance
+	void SelectInstanceLODs();
+	// pack the visible instances of each batch and upload them
+	void UploadVisibleInstances();
+	// upload every instance and its bounds for the GPU culling
+	void UploadCullingInstances();
+	// submit the batches and draw them, culling on the CPU or
+	// in the compute shader
+	void DrawCPUCulledBatches();
+	void DrawGPUCulledBatches();
+
+	// upload the defined materials into the material table
+	void UploadObjectMaterials();
 
 public:
 
 	// The following methods are for the students to 
 	// customize for their own 3D scene
-	void PrepareScene();
+	void PrepareScene(const char* sceneFilename);
 	void RenderScene();
+	// true while textures are still streaming in or objects
+	// have moved since the last frame
+	bool NeedsRedraw();
+
+	// sample the array textures through bindless handles -
+	// call before preparing the scene
+	bool EnableBindlessTextures();
+	// cull the instances in a compute shader instead of on the
+	// CPU - call before preparing the scene
+	bool EnableGPUCulling(const char* shaderFilename);
 
 	// loads textures from image files
-	void LoadSceneTextures();
+	void LoadSceneTextures(const std::vector<SceneLoader::SCENE_TEXTURE>& textures);
+	// reserve a texture slot and start loading its image - the
+	// texture is streamed in over the next frames
+	bool RequestTexture(const std::string& filename, const std::string& tag);
 	// define all the object materials before rendering
 	void DefineObjectMaterials();
 	// add and define the light sources before rendering
 	void SetupSceneLights();
 
+	// set the camera matrices of the frame about to be rendered
+	void SetCameraView(
+		const glm::mat4& view,
+		const glm::mat4& projection);
+
+	// find the scene object hit first by a ray, or nearest to a
+	// point - these return the index of the object in the scene
+	// file, or -1 when there is none
+	int PickObject(const glm::vec3& origin, const glm::vec3& direction, float& hitDistance);
+	int FindNearestObject(const glm::vec3& point, float& distance);
+
+	// rendering counters for the most recent frame and in total
+	const FRAME_STATS& GetFrameStats() const { return(m_frameStats); }
+
 };
\ No newline at end of file
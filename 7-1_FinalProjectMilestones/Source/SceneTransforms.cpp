@@ -0,0 +1,212 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenetransforms.cpp
+// ============
+// store scene object transforms and their cached model matrices
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneTransforms.h"
+
+#include <cmath>
+
+/***********************************************************
+ *  SceneTransforms()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneTransforms::SceneTransforms()
+{
+	m_dirtyCount = 0;
+	m_matrixUpdates = 0;
+}
+
+/***********************************************************
+ *  ~SceneTransforms()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneTransforms::~SceneTransforms()
+{
+}
+
+/***********************************************************
+ *  AddTransform()
+ *
+ *  This method is used for adding a new transform.  The new
+ *  transform starts out dirty so its model matrix is built
+ *  the first time it is needed.
+ ***********************************************************/
+int SceneTransforms::AddTransform(
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	m_positions.push_back(positionXYZ);
+	m_rotations.push_back(rotationDegrees);
+	m_scales.push_back(scaleXYZ);
+	m_modelMatrices.push_back(glm::mat4(1.0f));
+	m_dirty.push_back(1);
+	m_dirtyCount++;
+
+	return((int)m_positions.size() - 1);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all the transforms.
+ ***********************************************************/
+void SceneTransforms::Clear()
+{
+	m_positions.clear();
+	m_rotations.clear();
+	m_scales.clear();
+	m_modelMatrices.clear();
+	m_dirty.clear();
+	m_dirtyCount = 0;
+}
+
+/***********************************************************
+ *  SetPosition()
+ *
+ *  This method is used for moving a stored transform.
+ ***********************************************************/
+void SceneTransforms::SetPosition(int index, glm::vec3 positionXYZ)
+{
+	m_positions[index] = positionXYZ;
+	MarkDirty(index);
+}
+
+/***********************************************************
+ *  SetRotation()
+ *
+ *  This method is used for rotating a stored transform.
+ ***********************************************************/
+void SceneTransforms::SetRotation(int index, glm::vec3 rotationDegrees)
+{
+	m_rotations[index] = rotationDegrees;
+	MarkDirty(index);
+}
+
+/***********************************************************
+ *  SetScale()
+ *
+ *  This method is used for scaling a stored transform.
+ ***********************************************************/
+void SceneTransforms::SetScale(int index, glm::vec3 scaleXYZ)
+{
+	m_scales[index] = scaleXYZ;
+	MarkDirty(index);
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for flagging a transform whose model
+ *  matrix no longer matches its values.
+ ***********************************************************/
+void SceneTransforms::MarkDirty(int index)
+{
+	if (m_dirty[index] == 0)
+	{
+		m_dirty[index] = 1;
+		m_dirtyCount++;
+	}
+}
+
+/***********************************************************
+ *  GetModelMatrix()
+ *
+ *  This method is used for getting the cached model matrix
+ *  of a transform, rebuilding it first if it is dirty.
+ ***********************************************************/
+const glm::mat4& SceneTransforms::GetModelMatrix(int index)
+{
+	if (m_dirty[index] != 0)
+	{
+		RebuildModelMatrix(index);
+	}
+
+	return(m_modelMatrices[index]);
+}
+
+/***********************************************************
+ *  UpdateModelMatrices()
+ *
+ *  This method is used for rebuilding all of the dirty model
+ *  matrices in one pass.  When nothing has moved this returns
+ *  right away without touching the arrays.
+ ***********************************************************/
+void SceneTransforms::UpdateModelMatrices()
+{
+	for (int i = 0; (i < (int)m_dirty.size()) && (m_dirtyCount > 0); i++)
+	{
+		if (m_dirty[i] != 0)
+		{
+			RebuildModelMatrix(i);
+		}
+	}
+}
+
+/***********************************************************
+ *  RebuildModelMatrix()
+ *
+ *  This method is used for rebuilding one cached model
+ *  matrix and clearing its dirty flag.
+ ***********************************************************/
+void SceneTransforms::RebuildModelMatrix(int index)
+{
+	m_modelMatrices[index] = ComposeModelMatrix(
+		m_scales[index],
+		m_rotations[index],
+		m_positions[index]);
+
+	m_dirty[index] = 0;
+	m_dirtyCount--;
+	m_matrixUpdates++;
+}
+
+/***********************************************************
+ *  ComposeModelMatrix()
+ *
+ *  This method is used for building the model matrix
+ *  translation * rotationZ * rotationY * rotationX * scale.
+ *  The rotation product is expanded by hand, which gives the
+ *  same result as multiplying the five separate matrices.
+ ***********************************************************/
+glm::mat4 SceneTransforms::ComposeModelMatrix(
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	float sx = sinf(glm::radians(rotationDegrees.x));
+	float cx = cosf(glm::radians(rotationDegrees.x));
+	float sy = sinf(glm::radians(rotationDegrees.y));
+	float cy = cosf(glm::radians(rotationDegrees.y));
+	float sz = sinf(glm::radians(rotationDegrees.z));
+	float cz = cosf(glm::radians(rotationDegrees.z));
+
+	glm::mat4 model(1.0f);
+
+	// first column - rotated and scaled X axis
+	model[0][0] = (cz * cy) * scaleXYZ.x;
+	model[0][1] = (sz * cy) * scaleXYZ.x;
+	model[0][2] = (-sy) * scaleXYZ.x;
+	model[0][3] = 0.0f;
+	// second column - rotated and scaled Y axis
+	model[1][0] = (cz * sy * sx - sz * cx) * scaleXYZ.y;
+	model[1][1] = (sz * sy * sx + cz * cx) * scaleXYZ.y;
+	model[1][2] = (cy * sx) * scaleXYZ.y;
+	model[1][3] = 0.0f;
+	// third column - rotated and scaled Z axis
+	model[2][0] = (cz * sy * cx + sz * sx) * scaleXYZ.z;
+	model[2][1] = (sz * sy * cx - cz * sx) * scaleXYZ.z;
+	model[2][2] = (cy * cx) * scaleXYZ.z;
+	model[2][3] = 0.0f;
+	// fourth column - translation
+	model[3][0] = positionXYZ.x;
+	model[3][1] = positionXYZ.y;
+	model[3][2] = positionXYZ.z;
+	model[3][3] = 1.0f;
+
+	return(model);
+}
@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenetransforms.h
+// ============
+// store scene object transforms and their cached model matrices
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneTransforms
+ *
+ *  This class stores the position, rotation and scale of
+ *  every scene object in parallel arrays, along with the
+ *  cached model matrix for each one.  A model matrix is only
+ *  rebuilt after one of its values has been changed, so
+ *  static objects never pay for the trig again.
+ ***********************************************************/
+class SceneTransforms
+{
+public:
+	// constructor
+	SceneTransforms();
+	// destructor
+	~SceneTransforms();
+
+	// add a new transform and return its index
+	int AddTransform(
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegrees,
+		glm::vec3 positionXYZ);
+	// remove all of the stored transforms
+	void Clear();
+	// number of stored transforms
+	int GetCount() const { return((int)m_positions.size()); }
+
+	// change the values of a stored transform - marks it dirty
+	void SetPosition(int index, glm::vec3 positionXYZ);
+	void SetRotation(int index, glm::vec3 rotationDegrees);
+	void SetScale(int index, glm::vec3 scaleXYZ);
+
+	// read the values of a stored transform
+	const glm::vec3& GetPosition(int index) const { return(m_positions[index]); }
+	const glm::vec3& GetRotation(int index) const { return(m_rotations[index]); }
+	const glm::vec3& GetScale(int index) const { return(m_scales[index]); }
+	bool IsDirty(int index) const { return(m_dirty[index] != 0); }
+	// number of transforms whose model matrix is out of date
+	int GetDirtyCount() const { return(m_dirtyCount); }
+
+	// get the model matrix, rebuilding it first if it is dirty
+	const glm::mat4& GetModelMatrix(int index);
+	// rebuild the model matrices of all the dirty transforms
+	void UpdateModelMatrices();
+	// number of model matrices rebuilt since the last reset
+	int GetMatrixUpdateCount() const { return(m_matrixUpdates); }
+	void ResetMatrixUpdateCount() { m_matrixUpdates = 0; }
+
+	// build a model matrix from scale, rotation and position values
+	static glm::mat4 ComposeModelMatrix(
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegrees,
+		glm::vec3 positionXYZ);
+
+private:
+	// transform values, one entry per scene object
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::vec3> m_rotations;
+	std::vector<glm::vec3> m_scales;
+	// cached model matrices, one entry per scene object
+	std::vector<glm::mat4> m_modelMatrices;
+	// non-zero when the cached model matrix is out of date
+	std::vector<unsigned char> m_dirty;
+	// number of transforms that are currently dirty
+	int m_dirtyCount;
+	// number of model matrices rebuilt since the last reset
+	int m_matrixUpdates;
+
+	// mark a transform as needing a new model matrix
+	void MarkDirty(int index);
+	// rebuild a single cached model matrix
+	void RebuildModelMatrix(int index);
+};
@@ -0,0 +1,193 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniforms.cpp
+// ============
+// resolve and cache the shader uniform locations for typed per-draw access
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderUniforms.h"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// shader names of the uniforms, in the same order as
+	// the UNIFORM_HANDLE values
+	const char* g_UniformNames[ShaderUniforms::UNIFORM_HANDLE_COUNT] =
+	{
+		"bUseLighting",
+		"objectTextures"
+	};
+}
+
+/***********************************************************
+ *  ShaderUniforms()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderUniforms::ShaderUniforms()
+{
+	m_programID = 0;
+	for (int i = 0; i < UNIFORM_HANDLE_COUNT; i++)
+	{
+		m_locations[i] = -1;
+	}
+	m_pStateCache = NULL;
+	ClearValues();
+}
+
+/***********************************************************
+ *  ~ShaderUniforms()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderUniforms::~ShaderUniforms()
+{
+}
+
+/***********************************************************
+ *  LoadUniformLocations()
+ *
+ *  This method is used for reading every active uniform of
+ *  the passed in shader program and filling in the location
+ *  table.  Uniforms that the compiler removed keep the
+ *  location -1 and are skipped by the setters.
+ ***********************************************************/
+bool ShaderUniforms::LoadUniformLocations(GLuint programID)
+{
+	GLint activeUniforms = 0;
+	GLint maxNameLength = 0;
+	std::unordered_map<std::string, GLint> activeLocations;
+
+	if (programID == 0)
+	{
+		std::cout << "Could not read shader uniforms: no shader program" << std::endl;
+		return(false);
+	}
+	m_programID = programID;
+	ClearValues();
+
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &activeUniforms);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<GLchar> nameBuffer(maxNameLength + 1);
+	for (GLint i = 0; i < activeUniforms; i++)
+	{
+		GLsizei nameLength = 0;
+		GLint arraySize = 0;
+		GLenum uniformType = 0;
+
+		glGetActiveUniform(programID, (GLuint)i, (GLsizei)nameBuffer.size(), &nameLength, &arraySize, &uniformType, nameBuffer.data());
+		std::string name(nameBuffer.data(), nameLength);
+
+		GLint location = glGetUniformLocation(programID, name.c_str());
+		if (location < 0)
+		{
+			// uniforms inside blocks do not have a location
+			continue;
+		}
+		activeLocations[name] = location;
+
+		// arrays of basic types are reported once as "name[0]" -
+		// register the plain name and every element as well
+		size_t bracket = name.rfind("[0]");
+		if ((bracket != std::string::npos) && (bracket + 3 == name.size()))
+		{
+			std::string baseName = name.substr(0, bracket);
+			activeLocations[baseName] = location;
+			for (GLint element = 1; element < arraySize; element++)
+			{
+				std::string elementName = baseName + "[" + std::to_string(element) + "]";
+				activeLocations[elementName] = glGetUniformLocation(programID, elementName.c_str());
+			}
+		}
+	}
+
+	// resolve every handle against the active uniforms
+	for (int handle = 0; handle < UNIFORM_HANDLE_COUNT; handle++)
+	{
+		std::unordered_map<std::string, GLint>::const_iterator found = activeLocations.find(g_UniformNames[handle]);
+		m_locations[handle] = (found != activeLocations.end()) ? found->second : -1;
+	}
+
+	std::cout << "INFO: Cached " << activeLocations.size() << " active shader uniform locations" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetBool()
+ *
+ *  This method is used for setting a boolean uniform.
+ ***********************************************************/
+void ShaderUniforms::SetBool(int handle, bool value)
+{
+	int intValue = (int)value;
+
+	if ((m_locations[handle] >= 0) && ValueChanged(handle, &intValue, sizeof(intValue)))
+	{
+		glProgramUniform1i(m_programID, m_locations[handle], intValue);
+	}
+}
+
+/***********************************************************
+ *  SetSamplerArray()
+ *
+ *  This method is used for setting the texture slots that
+ *  the elements of a sampler array uniform read from, all
+ *  with one call.  Up to 16 elements can be set.
+ ***********************************************************/
+void ShaderUniforms::SetSamplerArray(int handle, const GLint* slots, int count)
+{
+	size_t size = count * sizeof(GLint);
+
+	if ((m_locations[handle] >= 0) && (size <= sizeof(m_values[handle].data)) &&
+		ValueChanged(handle, slots, size))
+	{
+		glProgramUniform1iv(m_programID, m_locations[handle], count, slots);
+	}
+}
+
+/***********************************************************
+ *  ClearValues()
+ *
+ *  This method is used for forgetting the last set value of
+ *  every uniform, so that the next value is always sent.
+ ***********************************************************/
+void ShaderUniforms::ClearValues()
+{
+	for (int i = 0; i < UNIFORM_HANDLE_COUNT; i++)
+	{
+		m_values[i].size = 0;
+	}
+}
+
+/***********************************************************
+ *  ValueChanged()
+ *
+ *  This method is used for comparing a uniform value with
+ *  the last value that was set for the same handle.  The
+ *  call is counted as skipped when they match, otherwise it
+ *  is counted as issued and the new value is remembered.
+ ***********************************************************/
+bool ShaderUniforms::ValueChanged(int handle, const void* value, size_t size)
+{
+	UNIFORM_VALUE& lastValue = m_values[handle];
+	bool bChanged = (lastValue.size != size) || (memcmp(lastValue.data, value, size) != 0);
+
+	if (bChanged)
+	{
+		memcpy(lastValue.data, value, size);
+		lastValue.size = size;
+	}
+	if (NULL != m_pStateCache)
+	{
+		m_pStateCache->CountCall(bChanged);
+	}
+
+	return(bChanged);
+}
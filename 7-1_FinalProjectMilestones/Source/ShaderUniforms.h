@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniforms.h
+// ============
+// resolve and cache the shader uniform locations for typed per-draw access
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLStateCache.h"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+/***********************************************************
+ *  ShaderUniforms
+ *
+ *  This class looks up every active uniform of the linked
+ *  shader program once, right after the shaders are loaded,
+ *  and stores the locations in a table indexed by handle.
+ *  The per-draw setters only index that table, so no uniform
+ *  names are built or searched while rendering.  The last
+ *  value set for each handle is kept as well, and setting
+ *  the same value again does not call OpenGL.
+ ***********************************************************/
+class ShaderUniforms
+{
+public:
+	// constructor
+	ShaderUniforms();
+	// destructor
+	~ShaderUniforms();
+
+	// handles for all the uniforms used by the scene - the
+	// camera, light and material values live in the uniform
+	// buffers and the model matrix, color, texture values and
+	// material index are per-instance attributes
+	enum UNIFORM_HANDLE
+	{
+		UNIFORM_USE_LIGHTING = 0,
+		UNIFORM_OBJECT_TEXTURES,
+		UNIFORM_HANDLE_COUNT
+	};
+
+	// query the active uniforms of the program and cache them
+	bool LoadUniformLocations(GLuint programID);
+
+	// get the cached location for a handle, -1 when inactive
+	GLint GetLocation(int handle) const { return(m_locations[handle]); }
+	// get the program the locations were read from
+	GLuint GetProgramID() const { return(m_programID); }
+
+	// set the state cache that counts the uniform calls
+	void SetStateCache(GLStateCache* pStateCache) { m_pStateCache = pStateCache; }
+
+	// set uniform values through their cached locations
+	void SetBool(int handle, bool value);
+	void SetSamplerArray(int handle, const GLint* slots, int count);
+
+private:
+	// last value set for a uniform - a size of 0 means the
+	// value is not known yet
+	struct UNIFORM_VALUE
+	{
+		GLfloat data[16];
+		size_t size;
+	};
+
+	// the program the locations were read from
+	GLuint m_programID;
+	// cached uniform locations indexed by handle
+	GLint m_locations[UNIFORM_HANDLE_COUNT];
+	// last values set indexed by handle
+	UNIFORM_VALUE m_values[UNIFORM_HANDLE_COUNT];
+	// state cache that counts the issued and skipped calls
+	GLStateCache* m_pStateCache;
+
+	// forget all of the last set values
+	void ClearValues();
+	// check whether a uniform needs to be sent, and remember
+	// the new value when it does
+	bool ValueChanged(int handle, const void* value, size_t size);
+};
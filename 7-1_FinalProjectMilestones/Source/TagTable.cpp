@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////////////
+// tagtable.cpp
+// ============
+// intern texture and material tags into compact integer IDs
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TagTable.h"
+
+// declaration of global variables
+namespace
+{
+	// number of buckets in a new table
+	const size_t INITIAL_BUCKET_COUNT = 16;
+	// FNV-1a hash parameters
+	const uint32_t FNV_OFFSET_BASIS = 2166136261u;
+	const uint32_t FNV_PRIME = 16777619u;
+}
+
+/***********************************************************
+ *  TagTable()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TagTable::TagTable()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  Intern()
+ *
+ *  This method is used for getting the ID of a tag.  A tag
+ *  that is not in the table yet gets the next ID.  The table
+ *  doubles in size before it gets more than half full, which
+ *  keeps the probe sequences short.
+ ***********************************************************/
+int TagTable::Intern(std::string_view tag)
+{
+	uint32_t hash = HashTag(tag);
+	size_t bucket = FindBucket(tag, hash);
+
+	if (m_buckets[bucket].id >= 0)
+	{
+		return(m_buckets[bucket].id);
+	}
+
+	if ((m_names.size() + 1) * 2 > m_buckets.size())
+	{
+		Rehash(m_buckets.size() * 2);
+		bucket = FindBucket(tag, hash);
+	}
+
+	int id = (int)m_names.size();
+	m_names.emplace_back(tag);
+	m_buckets[bucket].hash = hash;
+	m_buckets[bucket].id = id;
+
+	return(id);
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method is used for getting the ID of a tag that was
+ *  added before.  It returns -1 for an unknown tag.
+ ***********************************************************/
+int TagTable::Find(std::string_view tag) const
+{
+	return(m_buckets[FindBucket(tag, HashTag(tag))].id);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all of the tags and
+ *  going back to an empty table.
+ ***********************************************************/
+void TagTable::Clear()
+{
+	TAG_BUCKET emptyBucket;
+	emptyBucket.hash = 0;
+	emptyBucket.id = -1;
+
+	m_names.clear();
+	m_buckets.assign(INITIAL_BUCKET_COUNT, emptyBucket);
+}
+
+/***********************************************************
+ *  HashTag()
+ *
+ *  This method is used for hashing a tag name with the
+ *  FNV-1a hash, which is quick for short strings.
+ ***********************************************************/
+uint32_t TagTable::HashTag(std::string_view tag)
+{
+	uint32_t hash = FNV_OFFSET_BASIS;
+
+	for (size_t i = 0; i < tag.size(); i++)
+	{
+		hash ^= (unsigned char)tag[i];
+		hash *= FNV_PRIME;
+	}
+
+	return(hash);
+}
+
+/***********************************************************
+ *  FindBucket()
+ *
+ *  This method is used for walking the probe sequence of a
+ *  hash until the bucket holding the tag or an empty bucket
+ *  is found.  The names are only compared when the hashes
+ *  match.  The table is never full, so the walk always ends.
+ ***********************************************************/
+size_t TagTable::FindBucket(std::string_view tag, uint32_t hash) const
+{
+	size_t mask = m_buckets.size() - 1;
+	size_t bucket = hash & mask;
+
+	while (m_buckets[bucket].id >= 0)
+	{
+		if ((m_buckets[bucket].hash == hash) &&
+			(m_names[m_buckets[bucket].id] == tag))
+		{
+			break;
+		}
+		bucket = (bucket + 1) & mask;
+	}
+
+	return(bucket);
+}
+
+/***********************************************************
+ *  Rehash()
+ *
+ *  This method is used for moving every tag into a new table
+ *  with the passed in number of buckets.  The stored hashes
+ *  are reused, so no name is hashed again.
+ ***********************************************************/
+void TagTable::Rehash(size_t bucketCount)
+{
+	std::vector<TAG_BUCKET> oldBuckets;
+	TAG_BUCKET emptyBucket;
+
+	emptyBucket.hash = 0;
+	emptyBucket.id = -1;
+	oldBuckets.swap(m_buckets);
+	m_buckets.assign(bucketCount, emptyBucket);
+
+	size_t mask = bucketCount - 1;
+	for (size_t i = 0; i < oldBuckets.size(); i++)
+	{
+		if (oldBuckets[i].id >= 0)
+		{
+			size_t bucket = oldBuckets[i].hash & mask;
+			while (m_buckets[bucket].id >= 0)
+			{
+				bucket = (bucket + 1) & mask;
+			}
+			m_buckets[bucket] = oldBuckets[i];
+		}
+	}
+}
@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// tagtable.h
+// ============
+// intern texture and material tags into compact integer IDs
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/***********************************************************
+ *  TagTable
+ *
+ *  This class hands out IDs for tags, numbered 0, 1, 2 ... in
+ *  the order the tags are first added, so an ID can be used
+ *  directly as an index into a list kept in the same order.
+ *  Names are resolved through an open addressing hash table
+ *  with linear probing, which holds the hash and ID of every
+ *  tag in one flat array.  Tags are resolved once when the
+ *  scene is loaded - everything after that works with the
+ *  IDs.
+ ***********************************************************/
+class TagTable
+{
+public:
+	// constructor
+	TagTable();
+
+	// get the ID of a tag, adding the tag if it is new
+	int Intern(std::string_view tag);
+	// get the ID of a tag, or -1 when it was never added
+	int Find(std::string_view tag) const;
+	// remove all of the tags
+	void Clear();
+
+	// the tags, by ID
+	int GetCount() const { return((int)m_names.size()); }
+	const std::string& GetName(int id) const { return(m_names[id]); }
+
+private:
+	// one bucket of the hash table - an ID of -1 marks an
+	// empty bucket
+	struct TAG_BUCKET
+	{
+		uint32_t hash;
+		int id;
+	};
+
+	// hash table buckets, always a power of two in size
+	std::vector<TAG_BUCKET> m_buckets;
+	// tag names, by ID
+	std::vector<std::string> m_names;
+
+	// hash a tag name
+	static uint32_t HashTag(std::string_view tag);
+	// find the bucket holding a tag, or the empty bucket
+	// where it would go
+	size_t FindBucket(std::string_view tag, uint32_t hash) const;
+	// move the tags into a table with the passed in size
+	void Rehash(size_t bucketCount);
+};
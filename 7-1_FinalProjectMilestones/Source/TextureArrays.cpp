@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturearrays.cpp
+// ============
+// pack the scene textures into array textures grouped by size and format
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureArrays.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// number of layers a new array texture starts out with
+	const int INITIAL_LAYER_CAPACITY = 4;
+}
+
+/***********************************************************
+ *  TextureArrays()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureArrays::TextureArrays()
+{
+}
+
+/***********************************************************
+ *  ~TextureArrays()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureArrays::~TextureArrays()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  AllocateLayer()
+ *
+ *  This method is used for finding the array texture that
+ *  matches the size and format of a texture and taking its
+ *  next free layer.  A new array is created for a size and
+ *  format that has not been seen before.
+ ***********************************************************/
+bool TextureArrays::AllocateLayer(
+	int width,
+	int height,
+	GLenum internalFormat,
+	int levels,
+	int& arrayIndex,
+	int& layer,
+	bool& bGrown)
+{
+	arrayIndex = -1;
+	bGrown = false;
+	for (size_t i = 0; i < m_arrays.size(); i++)
+	{
+		const TEXTURE_ARRAY& textureArray = m_arrays[i];
+		if ((textureArray.width == width) &&
+			(textureArray.height == height) &&
+			(textureArray.internalFormat == internalFormat) &&
+			(textureArray.levels == levels))
+		{
+			arrayIndex = (int)i;
+			break;
+		}
+	}
+
+	if (arrayIndex < 0)
+	{
+		if ((int)m_arrays.size() >= MAX_ARRAYS)
+		{
+			std::cout << "No free texture unit for a " << width << "x" << height << " texture array" << std::endl;
+			return(false);
+		}
+
+		TEXTURE_ARRAY textureArray;
+		textureArray.width = width;
+		textureArray.height = height;
+		textureArray.internalFormat = internalFormat;
+		textureArray.levels = levels;
+		textureArray.layerCount = 0;
+		textureArray.layerCapacity = INITIAL_LAYER_CAPACITY;
+		textureArray.texture = CreateArrayTexture(textureArray);
+
+		arrayIndex = (int)m_arrays.size();
+		m_arrays.push_back(textureArray);
+	}
+
+	TEXTURE_ARRAY& textureArray = m_arrays[arrayIndex];
+	if (textureArray.layerCount >= textureArray.layerCapacity)
+	{
+		GrowArray(textureArray);
+		bGrown = true;
+	}
+
+	layer = textureArray.layerCount;
+	textureArray.layerCount++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  DeleteRetiredTextures()
+ *
+ *  This method is used for deleting the textures that grown
+ *  arrays have replaced.  It is called once the new textures
+ *  are bound, so no texture unit or handle is left pointing
+ *  at a deleted texture.
+ ***********************************************************/
+void TextureArrays::DeleteRetiredTextures()
+{
+	for (size_t i = 0; i < m_retiredTextures.size(); i++)
+	{
+		glDeleteTextures(1, &m_retiredTextures[i]);
+	}
+	m_retiredTextures.clear();
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing all of the array textures.
+ ***********************************************************/
+void TextureArrays::Destroy()
+{
+	DeleteRetiredTextures();
+	for (size_t i = 0; i < m_arrays.size(); i++)
+	{
+		glDeleteTextures(1, &m_arrays[i].texture);
+	}
+	m_arrays.clear();
+}
+
+/***********************************************************
+ *  CreateArrayTexture()
+ *
+ *  This method is used for creating the immutable storage of
+ *  an array texture and configuring its texture mapping
+ *  parameters, which are the same for every scene texture.
+ ***********************************************************/
+GLuint TextureArrays::CreateArrayTexture(const TEXTURE_ARRAY& textureArray)
+{
+	GLuint texture = 0;
+
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+	glTextureStorage3D(
+		texture,
+		textureArray.levels,
+		textureArray.internalFormat,
+		textureArray.width,
+		textureArray.height,
+		textureArray.layerCapacity);
+
+	// set the texture wrapping parameters
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	return(texture);
+}
+
+/***********************************************************
+ *  GrowArray()
+ *
+ *  This method is used for doubling the layers of an array
+ *  texture.  Immutable storage cannot be resized, so a new
+ *  array texture is created and every mipmap level of the
+ *  used layers is copied into it.  The old texture is only
+ *  retired here, and deleted once the new one is bound.  The
+ *  copies are queued behind any uploads into the old
+ *  texture, so layers still being streamed in are carried
+ *  over as well.
+ ***********************************************************/
+void TextureArrays::GrowArray(TEXTURE_ARRAY& textureArray)
+{
+	GLuint oldTexture = textureArray.texture;
+
+	textureArray.layerCapacity *= 2;
+	textureArray.texture = CreateArrayTexture(textureArray);
+
+	for (int level = 0; level < textureArray.levels; level++)
+	{
+		glCopyImageSubData(
+			oldTexture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+			textureArray.texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+			std::max(1, textureArray.width >> level),
+			std::max(1, textureArray.height >> level),
+			textureArray.layerCount);
+	}
+
+	m_retiredTextures.push_back(oldTexture);
+}
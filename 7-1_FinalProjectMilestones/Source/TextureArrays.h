@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturearrays.h
+// ============
+// pack the scene textures into array textures grouped by size and format
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  TextureArrays
+ *
+ *  This class hands out layers of 2D array textures.  All of
+ *  the textures with the same size, format and number of
+ *  mipmap levels share one array texture, so any number of
+ *  them can be sampled through one texture unit, and the
+ *  objects using them can be drawn together with the layer
+ *  chosen per instance.  An array that runs out of layers
+ *  is replaced by one with twice as many, with the existing
+ *  layers copied over on the GPU.
+ ***********************************************************/
+class TextureArrays
+{
+public:
+	// constructor
+	TextureArrays();
+	// destructor
+	~TextureArrays();
+
+	// every array is bound to its own texture unit
+	static const int MAX_ARRAYS = 16;
+
+	// find room for one more texture, creating or growing an
+	// array as needed - bGrown is set when the array got a new
+	// texture, which has to be bound in place of the old one
+	// before the old one is deleted
+	bool AllocateLayer(
+		int width,
+		int height,
+		GLenum internalFormat,
+		int levels,
+		int& arrayIndex,
+		int& layer,
+		bool& bGrown);
+	// delete the textures that grown arrays have replaced
+	void DeleteRetiredTextures();
+	// free all of the array textures
+	void Destroy();
+
+	// the array textures, by array index
+	int GetArrayCount() const { return((int)m_arrays.size()); }
+	GLuint GetTexture(int arrayIndex) const { return(m_arrays[arrayIndex].texture); }
+	int GetLayerCount(int arrayIndex) const { return(m_arrays[arrayIndex].layerCount); }
+
+private:
+	struct TEXTURE_ARRAY
+	{
+		GLuint texture;
+		int width;
+		int height;
+		GLenum internalFormat;
+		int levels;
+		int layerCount;
+		int layerCapacity;
+	};
+
+	// the array textures created so far
+	std::vector<TEXTURE_ARRAY> m_arrays;
+	// textures replaced by grown arrays, kept until the new
+	// textures have been bound
+	std::vector<GLuint> m_retiredTextures;
+
+	// create the storage of an array texture
+	GLuint CreateArrayTexture(const TEXTURE_ARRAY& textureArray);
+	// move an array texture to storage with twice the layers
+	void GrowArray(TEXTURE_ARRAY& textureArray);
+};
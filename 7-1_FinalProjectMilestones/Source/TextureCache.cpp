@@ -0,0 +1,606 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.cpp
+// ============
+// compressed, mipmapped cache files for the scene texture images
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCache.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// identifies a cache file and the version of its layout
+	const char CACHE_MAGIC[4] = { 'T', 'X', 'C', '1' };
+	const uint32_t CACHE_VERSION = 1;
+	// appended to the image file name to name its cache file
+	const char* CACHE_EXTENSION = ".texcache";
+	// more levels than this would mean a corrupted header
+	const uint32_t MAX_CACHE_LEVELS = 32;
+
+	// the size and modification time of a file
+	bool GetFileStamp(const std::string& filename, uint64_t& size, int64_t& time)
+	{
+#ifdef _WIN32
+		struct _stat64 fileInfo;
+		if (_stat64(filename.c_str(), &fileInfo) != 0)
+		{
+			return(false);
+		}
+#else
+		struct stat fileInfo;
+		if (stat(filename.c_str(), &fileInfo) != 0)
+		{
+			return(false);
+		}
+#endif
+		size = (uint64_t)fileInfo.st_size;
+		time = (int64_t)fileInfo.st_mtime;
+		return(true);
+	}
+
+	// pack an 8 bit per channel color into 5:6:5 bits
+	uint16_t PackColor565(const unsigned char* color)
+	{
+		return((uint16_t)(((color[0] * 31 + 127) / 255) << 11 |
+			((color[1] * 63 + 127) / 255) << 5 |
+			((color[2] * 31 + 127) / 255)));
+	}
+
+	// expand a 5:6:5 color back to 8 bits per channel
+	void UnpackColor565(uint16_t packed, int* color)
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// compress the colors of a 4x4 block of RGBA pixels into
+	// an 8 byte BC1 block.  The end colors are the two pixels
+	// furthest apart along the main axis of the block colors,
+	// found with a few power iterations of their covariance
+	void EncodeColorBlock(const unsigned char* block, unsigned char* output)
+	{
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				mean[c] += block[i * 4 + c] / 16.0f;
+			}
+		}
+
+		float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			float r = block[i * 4 + 0] - mean[0];
+			float g = block[i * 4 + 1] - mean[1];
+			float b = block[i * 4 + 2] - mean[2];
+			covariance[0] += r * r;
+			covariance[1] += r * g;
+			covariance[2] += r * b;
+			covariance[3] += g * g;
+			covariance[4] += g * b;
+			covariance[5] += b * b;
+		}
+
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 4; iteration++)
+		{
+			float r = axis[0] * covariance[0] + axis[1] * covariance[1] + axis[2] * covariance[2];
+			float g = axis[0] * covariance[1] + axis[1] * covariance[3] + axis[2] * covariance[4];
+			float b = axis[0] * covariance[2] + axis[1] * covariance[4] + axis[2] * covariance[5];
+			float largest = std::max(std::fabs(r), std::max(std::fabs(g), std::fabs(b)));
+			if (largest < 1e-6f)
+			{
+				break;
+			}
+			axis[0] = r / largest;
+			axis[1] = g / largest;
+			axis[2] = b / largest;
+		}
+
+		int minPixel = 0;
+		int maxPixel = 0;
+		float minProjection = 0.0f;
+		float maxProjection = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float projection = block[i * 4 + 0] * axis[0] + block[i * 4 + 1] * axis[1] + block[i * 4 + 2] * axis[2];
+			if ((i == 0) || (projection < minProjection))
+			{
+				minProjection = projection;
+				minPixel = i;
+			}
+			if ((i == 0) || (projection > maxProjection))
+			{
+				maxProjection = projection;
+				maxPixel = i;
+			}
+		}
+
+		uint16_t color0 = PackColor565(&block[maxPixel * 4]);
+		uint16_t color1 = PackColor565(&block[minPixel * 4]);
+		// the first color has to be the larger one to select
+		// the four color mode
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+		}
+
+		uint32_t indices = 0;
+		if (color0 != color1)
+		{
+			int palette[4][3];
+			UnpackColor565(color0, palette[0]);
+			UnpackColor565(color1, palette[1]);
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int bestIndex = 0;
+				int bestDistance = 0;
+				for (int p = 0; p < 4; p++)
+				{
+					int distance = 0;
+					for (int c = 0; c < 3; c++)
+					{
+						int difference = block[i * 4 + c] - palette[p][c];
+						distance += difference * difference;
+					}
+					if ((p == 0) || (distance < bestDistance))
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= (uint32_t)bestIndex << (i * 2);
+			}
+		}
+
+		output[0] = (unsigned char)(color0 & 0xFF);
+		output[1] = (unsigned char)(color0 >> 8);
+		output[2] = (unsigned char)(color1 & 0xFF);
+		output[3] = (unsigned char)(color1 >> 8);
+		for (int i = 0; i < 4; i++)
+		{
+			output[4 + i] = (unsigned char)(indices >> (i * 8));
+		}
+	}
+
+	// compress the alpha of a 4x4 block of RGBA pixels into
+	// the 8 byte alpha part of a BC3 block, using the eight
+	// value mode between the lowest and highest alpha
+	void EncodeAlphaBlock(const unsigned char* block, unsigned char* output)
+	{
+		int alpha0 = 0;
+		int alpha1 = 255;
+		for (int i = 0; i < 16; i++)
+		{
+			alpha0 = std::max(alpha0, (int)block[i * 4 + 3]);
+			alpha1 = std::min(alpha1, (int)block[i * 4 + 3]);
+		}
+
+		uint64_t indices = 0;
+		if (alpha0 != alpha1)
+		{
+			int palette[8];
+			palette[0] = alpha0;
+			palette[1] = alpha1;
+			for (int p = 2; p < 8; p++)
+			{
+				palette[p] = ((8 - p) * alpha0 + (p - 1) * alpha1) / 7;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int bestIndex = 0;
+				int bestDistance = 256;
+				for (int p = 0; p < 8; p++)
+				{
+					int distance = std::abs(block[i * 4 + 3] - palette[p]);
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= (uint64_t)bestIndex << (i * 3);
+			}
+		}
+
+		output[0] = (unsigned char)alpha0;
+		output[1] = (unsigned char)alpha1;
+		for (int i = 0; i < 6; i++)
+		{
+			output[2 + i] = (unsigned char)(indices >> (i * 8));
+		}
+	}
+
+	// compress one RGBA level into BC1 or BC3 blocks - the
+	// blocks on the right and bottom edges repeat the last
+	// row and column of pixels
+	void CompressLevel(
+		const std::vector<unsigned char>& pixels,
+		int width,
+		int height,
+		TextureCache::CACHE_FORMAT format,
+		std::vector<unsigned char>& output)
+	{
+		unsigned char block[64];
+		unsigned char encoded[16];
+
+		for (int blockY = 0; blockY < height; blockY += 4)
+		{
+			for (int blockX = 0; blockX < width; blockX += 4)
+			{
+				for (int y = 0; y < 4; y++)
+				{
+					int sourceY = std::min(blockY + y, height - 1);
+					for (int x = 0; x < 4; x++)
+					{
+						int sourceX = std::min(blockX + x, width - 1);
+						memcpy(&block[(y * 4 + x) * 4], &pixels[((size_t)sourceY * width + sourceX) * 4], 4);
+					}
+				}
+
+				if (format == TextureCache::CACHE_FORMAT_BC3)
+				{
+					EncodeAlphaBlock(block, encoded);
+					EncodeColorBlock(block, encoded + 8);
+					output.insert(output.end(), encoded, encoded + 16);
+				}
+				else
+				{
+					EncodeColorBlock(block, encoded);
+					output.insert(output.end(), encoded, encoded + 8);
+				}
+			}
+		}
+	}
+
+	// halve an RGBA level with a 2x2 box filter - an odd last
+	// row or column is averaged with itself
+	void DownsampleLevel(
+		const std::vector<unsigned char>& source,
+		int width,
+		int height,
+		std::vector<unsigned char>& output,
+		int outputWidth,
+		int outputHeight)
+	{
+		output.resize((size_t)outputWidth * outputHeight * 4);
+
+		for (int y = 0; y < outputHeight; y++)
+		{
+			int y0 = std::min(y * 2, height - 1);
+			int y1 = std::min(y * 2 + 1, height - 1);
+			for (int x = 0; x < outputWidth; x++)
+			{
+				int x0 = std::min(x * 2, width - 1);
+				int x1 = std::min(x * 2 + 1, width - 1);
+				for (int c = 0; c < 4; c++)
+				{
+					int sum = source[((size_t)y0 * width + x0) * 4 + c] +
+						source[((size_t)y0 * width + x1) * 4 + c] +
+						source[((size_t)y1 * width + x0) * 4 + c] +
+						source[((size_t)y1 * width + x1) * 4 + c];
+					output[((size_t)y * outputWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  InitCachedTexture()
+ *
+ *  This method is used for setting a cached texture to the
+ *  unmapped state.
+ ***********************************************************/
+void TextureCache::InitCachedTexture(CACHED_TEXTURE& texture)
+{
+	texture.pBase = NULL;
+	texture.mappedSize = 0;
+	texture.pHeader = NULL;
+	texture.pLevels = NULL;
+	texture.fileHandle = NULL;
+	texture.mappingHandle = NULL;
+}
+
+/***********************************************************
+ *  OpenCache()
+ *
+ *  This method is used for memory mapping the cache file of
+ *  an image file.  The mapping is only kept when the header
+ *  and level table fit in the file, every level has the
+ *  size and block data of its place in the mipmap chain, and
+ *  the recorded size and modification time match the image
+ *  file, so a changed image is decoded again instead of
+ *  using a stale cache.
+ ***********************************************************/
+bool TextureCache::OpenCache(const std::string& sourceFilename, CACHED_TEXTURE& texture)
+{
+	std::string cacheFilename = sourceFilename + CACHE_EXTENSION;
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+
+	InitCachedTexture(texture);
+
+	if (GetFileStamp(sourceFilename, sourceSize, sourceTime) == false)
+	{
+		return(false);
+	}
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(cacheFilename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return(false);
+	}
+	texture.fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if ((GetFileSizeEx(file, &fileSize) == FALSE) || (fileSize.QuadPart < (LONGLONG)sizeof(CACHE_HEADER)))
+	{
+		CloseCache(texture);
+		return(false);
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		CloseCache(texture);
+		return(false);
+	}
+	texture.mappingHandle = mapping;
+
+	texture.pBase = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	texture.mappedSize = (size_t)fileSize.QuadPart;
+#else
+	int file = open(cacheFilename.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return(false);
+	}
+
+	struct stat fileInfo;
+	if ((fstat(file, &fileInfo) != 0) || (fileInfo.st_size < (off_t)sizeof(CACHE_HEADER)))
+	{
+		close(file);
+		return(false);
+	}
+
+	// the mapping stays valid after the file is closed
+	void* pMapped = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (pMapped != MAP_FAILED)
+	{
+		texture.pBase = (const unsigned char*)pMapped;
+		texture.mappedSize = (size_t)fileInfo.st_size;
+	}
+#endif
+	if (texture.pBase == NULL)
+	{
+		CloseCache(texture);
+		return(false);
+	}
+
+	// check the header and the level table before trusting them
+	const CACHE_HEADER* pHeader = (const CACHE_HEADER*)texture.pBase;
+	size_t tableEnd = sizeof(CACHE_HEADER) + (size_t)pHeader->levelCount * sizeof(CACHE_LEVEL);
+	bool bValid = (memcmp(pHeader->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0) &&
+		(pHeader->version == CACHE_VERSION) &&
+		(pHeader->format <= CACHE_FORMAT_BC3) &&
+		(pHeader->width > 0) && (pHeader->height > 0) &&
+		(pHeader->levelCount > 0) && (pHeader->levelCount <= MAX_CACHE_LEVELS) &&
+		(tableEnd <= texture.mappedSize) &&
+		(pHeader->sourceSize == sourceSize) &&
+		(pHeader->sourceTime == sourceTime);
+
+	const CACHE_LEVEL* pLevels = (const CACHE_LEVEL*)(texture.pBase + sizeof(CACHE_HEADER));
+	uint64_t blockSize = (pHeader->format == CACHE_FORMAT_BC3) ? 16 : 8;
+	for (uint32_t level = 0; bValid && (level < pHeader->levelCount); level++)
+	{
+		uint32_t levelWidth = std::max(1u, pHeader->width >> level);
+		uint32_t levelHeight = std::max(1u, pHeader->height >> level);
+		uint64_t levelSize = (uint64_t)((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockSize;
+		bValid = (pLevels[level].width == levelWidth) &&
+			(pLevels[level].height == levelHeight) &&
+			(pLevels[level].size == levelSize) &&
+			(pLevels[level].offset >= tableEnd) &&
+			(pLevels[level].size <= texture.mappedSize) &&
+			(pLevels[level].offset <= texture.mappedSize - pLevels[level].size);
+	}
+
+	if (bValid == false)
+	{
+		CloseCache(texture);
+		return(false);
+	}
+
+	texture.pHeader = pHeader;
+	texture.pLevels = pLevels;
+
+	return(true);
+}
+
+/***********************************************************
+ *  CloseCache()
+ *
+ *  This method is used for unmapping a cache file.  It is
+ *  safe to call on a texture that was never mapped.
+ ***********************************************************/
+void TextureCache::CloseCache(CACHED_TEXTURE& texture)
+{
+#ifdef _WIN32
+	if (texture.pBase != NULL)
+	{
+		UnmapViewOfFile(texture.pBase);
+	}
+	if (texture.mappingHandle != NULL)
+	{
+		CloseHandle((HANDLE)texture.mappingHandle);
+	}
+	if (texture.fileHandle != NULL)
+	{
+		CloseHandle((HANDLE)texture.fileHandle);
+	}
+#else
+	if (texture.pBase != NULL)
+	{
+		munmap((void*)texture.pBase, texture.mappedSize);
+	}
+#endif
+	InitCachedTexture(texture);
+}
+
+/***********************************************************
+ *  WriteCache()
+ *
+ *  This method is used for building the cache file of an
+ *  image file from its decoded pixels.  Every mipmap level
+ *  down to 1x1 is made with a box filter and compressed,
+ *  and the file is written under a temporary name and then
+ *  renamed, so a run that stops part way never leaves a
+ *  half written cache behind.
+ ***********************************************************/
+bool TextureCache::WriteCache(
+	const std::string& sourceFilename,
+	const unsigned char* pixels,
+	int width,
+	int height,
+	int colorChannels)
+{
+	std::string cacheFilename = sourceFilename + CACHE_EXTENSION;
+	std::string tempFilename = cacheFilename + ".tmp";
+	CACHE_HEADER header;
+
+	if ((pixels == NULL) || (width <= 0) || (height <= 0) ||
+		((colorChannels != 3) && (colorChannels != 4)))
+	{
+		return(false);
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.format = (colorChannels == 4) ? CACHE_FORMAT_BC3 : CACHE_FORMAT_BC1;
+	header.width = (uint32_t)width;
+	header.height = (uint32_t)height;
+	if (GetFileStamp(sourceFilename, header.sourceSize, header.sourceTime) == false)
+	{
+		return(false);
+	}
+
+	// expand the image to RGBA for the mipmap and block code
+	std::vector<unsigned char> level((size_t)width * height * 4);
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		level[i * 4 + 0] = pixels[i * colorChannels + 0];
+		level[i * 4 + 1] = pixels[i * colorChannels + 1];
+		level[i * 4 + 2] = pixels[i * colorChannels + 2];
+		level[i * 4 + 3] = (colorChannels == 4) ? pixels[i * 4 + 3] : 255;
+	}
+
+	std::vector<CACHE_LEVEL> levels;
+	std::vector<unsigned char> compressed;
+	std::vector<unsigned char> nextLevel;
+	int levelWidth = width;
+	int levelHeight = height;
+	for (;;)
+	{
+		CACHE_LEVEL levelInfo;
+		levelInfo.width = (uint32_t)levelWidth;
+		levelInfo.height = (uint32_t)levelHeight;
+		levelInfo.offset = compressed.size();
+		CompressLevel(level, levelWidth, levelHeight, (CACHE_FORMAT)header.format, compressed);
+		levelInfo.size = compressed.size() - levelInfo.offset;
+		levels.push_back(levelInfo);
+
+		if ((levelWidth == 1) && (levelHeight == 1))
+		{
+			break;
+		}
+
+		int nextWidth = std::max(1, levelWidth / 2);
+		int nextHeight = std::max(1, levelHeight / 2);
+		DownsampleLevel(level, levelWidth, levelHeight, nextLevel, nextWidth, nextHeight);
+		level.swap(nextLevel);
+		levelWidth = nextWidth;
+		levelHeight = nextHeight;
+	}
+
+	// the level offsets are stored from the start of the file
+	header.levelCount = (uint32_t)levels.size();
+	uint64_t dataStart = sizeof(CACHE_HEADER) + levels.size() * sizeof(CACHE_LEVEL);
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		levels[i].offset += dataStart;
+	}
+
+	std::ofstream cacheFile(tempFilename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!cacheFile)
+	{
+		return(false);
+	}
+	cacheFile.write((const char*)&header, sizeof(header));
+	cacheFile.write((const char*)levels.data(), levels.size() * sizeof(CACHE_LEVEL));
+	cacheFile.write((const char*)compressed.data(), compressed.size());
+	cacheFile.close();
+	bool bWritten = !cacheFile.fail();
+
+	if (bWritten)
+	{
+		// renaming over an existing file fails on Windows
+		remove(cacheFilename.c_str());
+		bWritten = (rename(tempFilename.c_str(), cacheFilename.c_str()) == 0);
+	}
+	if (bWritten == false)
+	{
+		remove(tempFilename.c_str());
+	}
+
+	return(bWritten);
+}
+
+/***********************************************************
+ *  GetLevelData()
+ *
+ *  This method is used for getting the compressed blocks of
+ *  one mipmap level of a mapped cache file.
+ ***********************************************************/
+const unsigned char* TextureCache::GetLevelData(const CACHED_TEXTURE& texture, int level)
+{
+	return(texture.pBase + texture.pLevels[level].offset);
+}
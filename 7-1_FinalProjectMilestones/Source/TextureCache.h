@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.h
+// ============
+// compressed, mipmapped cache files for the scene texture images
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/***********************************************************
+ *  TextureCache
+ *
+ *  This class converts a decoded texture image into a cache
+ *  file that sits next to the image file.  The cache holds
+ *  every mipmap level, built on the CPU, in block compressed
+ *  form - BC1 for images without alpha and BC3 for images
+ *  with alpha - so it can be handed to OpenGL as is.  The
+ *  cache file is memory mapped when it is read, and it is
+ *  only used while the size and modification time of the
+ *  image file match the ones recorded in it.  Nothing in
+ *  this class calls OpenGL, so it can run on the texture
+ *  loader threads.
+ ***********************************************************/
+class TextureCache
+{
+public:
+	// block compression used for the cached levels
+	enum CACHE_FORMAT
+	{
+		CACHE_FORMAT_BC1 = 0,
+		CACHE_FORMAT_BC3
+	};
+
+	// layout of the cache file - a header, one entry per
+	// mipmap level, and then the compressed blocks
+	struct CACHE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levelCount;
+		uint64_t sourceSize;
+		int64_t sourceTime;
+	};
+	struct CACHE_LEVEL
+	{
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	// a cache file mapped into memory
+	struct CACHED_TEXTURE
+	{
+		const unsigned char* pBase;
+		size_t mappedSize;
+		const CACHE_HEADER* pHeader;
+		const CACHE_LEVEL* pLevels;
+		// operating system handles of the mapping
+		void* fileHandle;
+		void* mappingHandle;
+	};
+
+	// set a cached texture to the unmapped state
+	static void InitCachedTexture(CACHED_TEXTURE& texture);
+	// map the cache file of an image file if it is current
+	static bool OpenCache(const std::string& sourceFilename, CACHED_TEXTURE& texture);
+	// unmap a cache file
+	static void CloseCache(CACHED_TEXTURE& texture);
+	// build the mipmap levels of a decoded image, compress
+	// them, and write the cache file of its image file
+	static bool WriteCache(
+		const std::string& sourceFilename,
+		const unsigned char* pixels,
+		int width,
+		int height,
+		int colorChannels);
+
+	// compressed data of one level of a mapped cache
+	static const unsigned char* GetLevelData(const CACHED_TEXTURE& texture, int level);
+};
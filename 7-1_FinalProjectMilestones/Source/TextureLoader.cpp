@@ -0,0 +1,307 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.cpp
+// ============
+// decode texture image files on a pool of worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureLoader.h"
+
+#include "stb_image.h"
+
+#include <chrono>
+
+// declaration of global variables
+namespace
+{
+	// upper limit for the number of decoding threads
+	const int MAX_WORKERS = 8;
+}
+
+/***********************************************************
+ *  TextureLoader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureLoader::TextureLoader()
+{
+	m_pendingCount = 0;
+	m_nextRequestID = 0;
+	m_bRunning = false;
+	m_bCacheEnabled = false;
+}
+
+/***********************************************************
+ *  ~TextureLoader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureLoader::~TextureLoader()
+{
+	Stop();
+
+	// free any images that were never collected
+	for (size_t i = 0; i < m_decodedImages.size(); i++)
+	{
+		FreeImage(m_decodedImages[i]);
+	}
+	m_decodedImages.clear();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the worker threads.  All
+ *  of the images are flipped vertically when they are read,
+ *  which is a global stb_image setting, so it is set here
+ *  once before any thread starts decoding.
+ ***********************************************************/
+void TextureLoader::Start(int workerCount)
+{
+	if (!m_workers.empty())
+	{
+		return;
+	}
+
+	if (workerCount <= 0)
+	{
+		workerCount = (int)std::thread::hardware_concurrency();
+	}
+	if (workerCount <= 0)
+	{
+		workerCount = 1;
+	}
+	if (workerCount > MAX_WORKERS)
+	{
+		workerCount = MAX_WORKERS;
+	}
+
+	// indicate to always flip images vertically when loaded
+	stbi_set_flip_vertically_on_load(true);
+
+	m_bRunning = true;
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&TextureLoader::WorkerLoop, this));
+	}
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping the worker threads once
+ *  the images already queued have been decoded.
+ ***********************************************************/
+void TextureLoader::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bRunning = false;
+	}
+	m_requestReady.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+}
+
+/***********************************************************
+ *  SetCacheEnabled()
+ *
+ *  This method is used for turning the texture cache on or
+ *  off.  It is off until the OpenGL thread has checked that
+ *  the block compressed formats can be used.
+ ***********************************************************/
+void TextureLoader::SetCacheEnabled(bool bEnabled)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_bCacheEnabled = bEnabled;
+}
+
+/***********************************************************
+ *  QueueImage()
+ *
+ *  This method is used for adding an image file to the
+ *  decoding queue.  The worker threads are started the first
+ *  time an image is queued.
+ ***********************************************************/
+int TextureLoader::QueueImage(const std::string& filename, const std::string& tag)
+{
+	DECODE_REQUEST request;
+
+	Start(0);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		request.requestID = m_nextRequestID++;
+		request.filename = filename;
+		request.tag = tag;
+		request.bUseCache = m_bCacheEnabled;
+		m_requests.push_back(request);
+		m_pendingCount++;
+	}
+	m_requestReady.notify_one();
+
+	return(request.requestID);
+}
+
+/***********************************************************
+ *  PollDecodedImage()
+ *
+ *  This method is used for taking the next decoded image if
+ *  one is ready.  It never waits, so it can be called once
+ *  per frame to load textures while the scene is running.
+ ***********************************************************/
+bool TextureLoader::PollDecodedImage(DECODED_IMAGE& image)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_decodedImages.empty())
+	{
+		return(false);
+	}
+
+	image = m_decodedImages.front();
+	m_decodedImages.pop_front();
+	m_pendingCount--;
+
+	return(true);
+}
+
+/***********************************************************
+ *  WaitForDecodedImage()
+ *
+ *  This method is used for waiting until the next image has
+ *  been decoded and taking it.
+ ***********************************************************/
+bool TextureLoader::WaitForDecodedImage(DECODED_IMAGE& image)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_imageReady.wait(lock, [this] { return(!m_decodedImages.empty() || (m_pendingCount == 0)); });
+	if (m_decodedImages.empty())
+	{
+		return(false);
+	}
+
+	image = m_decodedImages.front();
+	m_decodedImages.pop_front();
+	m_pendingCount--;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetPendingCount()
+ *
+ *  This method is used for getting the number of queued
+ *  images that have not been collected yet.
+ ***********************************************************/
+int TextureLoader::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return(m_pendingCount);
+}
+
+/***********************************************************
+ *  FreeImage()
+ *
+ *  This method is used for freeing the pixels of a decoded
+ *  image, or unmapping its cache file, after it has been
+ *  uploaded.
+ ***********************************************************/
+void TextureLoader::FreeImage(DECODED_IMAGE& image)
+{
+	if (image.pixels != NULL)
+	{
+		stbi_image_free(image.pixels);
+		image.pixels = NULL;
+	}
+	if (image.bCached)
+	{
+		TextureCache::CloseCache(image.cached);
+		image.bCached = false;
+	}
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is used for decoding queued images on a
+ *  worker thread until the pool is stopped.  The decoding
+ *  happens without holding the lock, so all of the workers
+ *  decode at the same time.  Images that could not be read
+ *  are still handed back, with no pixels, so the OpenGL
+ *  thread can report them.  Building the cache file of an
+ *  image is slow, so it is done here on the worker thread.
+ ***********************************************************/
+void TextureLoader::WorkerLoop()
+{
+	for (;;)
+	{
+		DECODE_REQUEST request;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_requestReady.wait(lock, [this] { return(!m_requests.empty() || !m_bRunning); });
+			if (m_requests.empty())
+			{
+				return;
+			}
+			request = m_requests.front();
+			m_requests.pop_front();
+		}
+
+		DECODED_IMAGE image;
+		image.requestID = request.requestID;
+		image.filename = request.filename;
+		image.tag = request.tag;
+		image.width = 0;
+		image.height = 0;
+		image.colorChannels = 0;
+		image.pixels = NULL;
+		image.bCached = false;
+		image.uploadedLevels = 0;
+		image.cacheMilliseconds = 0.0;
+		TextureCache::InitCachedTexture(image.cached);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (request.bUseCache)
+		{
+			image.bCached = TextureCache::OpenCache(request.filename, image.cached);
+		}
+		if (image.bCached)
+		{
+			image.width = (int)image.cached.pHeader->width;
+			image.height = (int)image.cached.pHeader->height;
+			image.colorChannels = (image.cached.pHeader->format == TextureCache::CACHE_FORMAT_BC3) ? 4 : 3;
+		}
+		else
+		{
+			image.pixels = stbi_load(
+				request.filename.c_str(),
+				&image.width,
+				&image.height,
+				&image.colorChannels,
+				0);
+		}
+		std::chrono::steady_clock::time_point decodeEnd = std::chrono::steady_clock::now();
+		image.decodeMilliseconds = std::chrono::duration<double, std::milli>(decodeEnd - start).count();
+
+		// the cache is built after the decode is timed, so the
+		// compression does not count as decode time
+		if ((request.bUseCache) && (image.bCached == false) && (image.pixels != NULL))
+		{
+			TextureCache::WriteCache(request.filename, image.pixels, image.width, image.height, image.colorChannels);
+			image.cacheMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decodeEnd).count();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_decodedImages.push_back(image);
+		}
+		m_imageReady.notify_all();
+	}
+}
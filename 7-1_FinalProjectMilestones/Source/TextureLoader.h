@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.h
+// ============
+// decode texture image files on a pool of worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureCache.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  TextureLoader
+ *
+ *  This class owns a pool of worker threads that decode
+ *  image files into pixel buffers.  Any number of images
+ *  can be queued at once and they are decoded in parallel.
+ *  The decoded images are collected on the OpenGL thread,
+ *  which is the only thread allowed to create textures,
+ *  and the pixel buffers are freed after the upload.  With
+ *  the texture cache enabled, an image whose cache file is
+ *  current is mapped instead of decoded, and a decoded image
+ *  gets its cache file written for the next run.
+ ***********************************************************/
+class TextureLoader
+{
+public:
+	// constructor
+	TextureLoader();
+	// destructor
+	~TextureLoader();
+
+	// one decoded image handed back to the OpenGL thread
+	struct DECODED_IMAGE
+	{
+		int requestID;
+		std::string filename;
+		std::string tag;
+		unsigned char* pixels;
+		int width;
+		int height;
+		int colorChannels;
+		double decodeMilliseconds;
+		// time spent compressing and writing the cache file,
+		// which is not part of the decode time
+		double cacheMilliseconds;
+		// mapped cache file used instead of the pixels
+		TextureCache::CACHED_TEXTURE cached;
+		bool bCached;
+		// cached levels already uploaded
+		int uploadedLevels;
+	};
+
+	// start the worker threads - 0 uses one per processor core
+	void Start(int workerCount);
+	// finish the queued work and stop the worker threads
+	void Stop();
+	// use and write the texture cache files for the images
+	// queued from now on
+	void SetCacheEnabled(bool bEnabled);
+
+	// queue an image file for decoding and return its request ID
+	int QueueImage(const std::string& filename, const std::string& tag);
+	// take a decoded image if one is ready, without waiting
+	bool PollDecodedImage(DECODED_IMAGE& image);
+	// wait for the next decoded image - false when nothing is
+	// queued or being decoded
+	bool WaitForDecodedImage(DECODED_IMAGE& image);
+	// number of queued images that have not been collected
+	int GetPendingCount();
+
+	// free the pixels or unmap the cache of a collected image
+	static void FreeImage(DECODED_IMAGE& image);
+
+private:
+	struct DECODE_REQUEST
+	{
+		int requestID;
+		std::string filename;
+		std::string tag;
+		bool bUseCache;
+	};
+
+	// worker threads
+	std::vector<std::thread> m_workers;
+	// images waiting to be decoded
+	std::deque<DECODE_REQUEST> m_requests;
+	// decoded images waiting to be collected
+	std::deque<DECODED_IMAGE> m_decodedImages;
+	// images queued but not yet collected
+	int m_pendingCount;
+	// ID for the next queued image
+	int m_nextRequestID;
+	// true while the worker threads should keep running
+	bool m_bRunning;
+	// true when queued images go through the texture cache
+	bool m_bCacheEnabled;
+	// guards all of the members above
+	std::mutex m_mutex;
+	// signaled when a request is queued or the pool stops
+	std::condition_variable m_requestReady;
+	// signaled when an image finished decoding
+	std::condition_variable m_imageReady;
+
+	// loop run by every worker thread
+	void WorkerLoop();
+};
@@ -0,0 +1,322 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.cpp
+// ============
+// upload texture pixels through a persistently mapped pixel buffer ring
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureStreamer.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// every upload starts on this byte boundary in the ring
+	const GLsizeiptr RING_ALIGNMENT = 16;
+	// how long one wait for an upload fence may take
+	const GLuint64 FENCE_TIMEOUT_NS = 100000000;
+}
+
+/***********************************************************
+ *  TextureStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureStreamer::TextureStreamer()
+{
+	m_ringBuffer = 0;
+	m_pMappedRing = NULL;
+	m_ringSize = 0;
+	m_ringHead = 0;
+}
+
+/***********************************************************
+ *  ~TextureStreamer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureStreamer::~TextureStreamer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the ring buffer with
+ *  immutable storage and mapping it once.  The mapping is
+ *  coherent, so pixels copied into it are seen by OpenGL
+ *  without flushing.
+ ***********************************************************/
+bool TextureStreamer::Initialize(GLsizeiptr ringSize)
+{
+	const GLbitfield mapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	Destroy();
+
+	glCreateBuffers(1, &m_ringBuffer);
+	glNamedBufferStorage(m_ringBuffer, ringSize, NULL, mapFlags);
+	m_pMappedRing = (unsigned char*)glMapNamedBufferRange(m_ringBuffer, 0, ringSize, mapFlags);
+	if (m_pMappedRing == NULL)
+	{
+		std::cout << "Could not map the texture upload buffer" << std::endl;
+		glDeleteBuffers(1, &m_ringBuffer);
+		m_ringBuffer = 0;
+		return(false);
+	}
+
+	m_ringSize = ringSize;
+	m_ringHead = 0;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for waiting until OpenGL has read
+ *  every upload in flight and then freeing the ring buffer.
+ ***********************************************************/
+void TextureStreamer::Destroy()
+{
+	while (!m_regions.empty())
+	{
+		RetireRegions(true);
+	}
+
+	if (m_ringBuffer != 0)
+	{
+		glUnmapNamedBuffer(m_ringBuffer);
+		glDeleteBuffers(1, &m_ringBuffer);
+	}
+	m_ringBuffer = 0;
+	m_pMappedRing = NULL;
+	m_ringSize = 0;
+	m_ringHead = 0;
+}
+
+/***********************************************************
+ *  UploadImage()
+ *
+ *  This method is used for uploading the pixels of one
+ *  level of an array texture layer.  The rows are tightly
+ *  packed, so the unpack alignment is lowered to one byte
+ *  for the upload and put back to the OpenGL default
+ *  afterwards.
+ ***********************************************************/
+bool TextureStreamer::UploadImage(
+	GLuint texture,
+	int level,
+	int layer,
+	int width,
+	int height,
+	GLenum format,
+	const void* pixels,
+	GLsizeiptr size,
+	bool bWait)
+{
+	const void* source = NULL;
+	GLsizeiptr offset = 0;
+
+	if (BeginUpload(pixels, size, bWait, source, offset) == false)
+	{
+		return(false);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTextureSubImage3D(texture, level, 0, 0, layer, width, height, 1, format, GL_UNSIGNED_BYTE, source);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	EndUpload(source != pixels, offset, size);
+
+	return(true);
+}
+
+/***********************************************************
+ *  UploadCompressedImage()
+ *
+ *  This method is used for uploading the blocks of one
+ *  level of a block compressed array texture layer.
+ ***********************************************************/
+bool TextureStreamer::UploadCompressedImage(
+	GLuint texture,
+	int level,
+	int layer,
+	int width,
+	int height,
+	GLenum internalFormat,
+	const void* data,
+	GLsizeiptr size,
+	bool bWait)
+{
+	const void* source = NULL;
+	GLsizeiptr offset = 0;
+
+	if (BeginUpload(data, size, bWait, source, offset) == false)
+	{
+		return(false);
+	}
+
+	glCompressedTextureSubImage3D(texture, level, 0, 0, layer, width, height, 1, internalFormat, (GLsizei)size, source);
+
+	EndUpload(source != data, offset, size);
+
+	return(true);
+}
+
+/***********************************************************
+ *  BeginUpload()
+ *
+ *  This method is used for copying the data of an upload
+ *  into the ring and binding the ring as the pixel unpack
+ *  buffer.  The source is set to what the upload call has
+ *  to be given - with the ring bound, that is the offset
+ *  into the ring.  Without a ring, or for data that can
+ *  never fit in it, the source is the data itself and it is
+ *  uploaded straight from client memory.
+ ***********************************************************/
+bool TextureStreamer::BeginUpload(
+	const void* data,
+	GLsizeiptr size,
+	bool bWait,
+	const void*& source,
+	GLsizeiptr& offset)
+{
+	if ((m_pMappedRing == NULL) || (size > m_ringSize))
+	{
+		source = data;
+		return(true);
+	}
+
+	if (ReserveRegion(size, bWait, offset) == false)
+	{
+		return(false);
+	}
+
+	memcpy(m_pMappedRing + offset, data, (size_t)size);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_ringBuffer);
+	source = (const void*)(uintptr_t)offset;
+
+	return(true);
+}
+
+/***********************************************************
+ *  EndUpload()
+ *
+ *  This method is used for unbinding the ring after an
+ *  upload from it, and fencing the region it was read from
+ *  so the region is not written again too early.
+ ***********************************************************/
+void TextureStreamer::EndUpload(bool bFromRing, GLsizeiptr offset, GLsizeiptr size)
+{
+	if (bFromRing == false)
+	{
+		return;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	RING_REGION region;
+	region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	region.start = offset;
+	region.end = offset + size;
+	m_regions.push_back(region);
+}
+
+/***********************************************************
+ *  RetireRegions()
+ *
+ *  This method is used for releasing the ring regions whose
+ *  uploads have been read by OpenGL.  The regions are freed
+ *  in the order they were written, so the free part of the
+ *  ring always stays in one or two runs.
+ ***********************************************************/
+void TextureStreamer::RetireRegions(bool bWait)
+{
+	while (!m_regions.empty())
+	{
+		RING_REGION& region = m_regions.front();
+		GLenum result = glClientWaitSync(
+			region.fence,
+			bWait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+			bWait ? FENCE_TIMEOUT_NS : 0);
+
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			if (bWait == false)
+			{
+				return;
+			}
+			continue;
+		}
+
+		// signaled, or the wait failed - either way the fence
+		// will not be of any more use
+		glDeleteSync(region.fence);
+		m_regions.pop_front();
+		bWait = false;
+	}
+}
+
+/***********************************************************
+ *  ReserveRegion()
+ *
+ *  This method is used for finding room for an upload.  The
+ *  uploads in flight cover the ring from the start of the
+ *  oldest one up to the write head, wrapping around the end
+ *  of the ring, and the new upload goes right after the
+ *  head or, when it does not fit before the end, at the
+ *  start of the ring.
+ ***********************************************************/
+bool TextureStreamer::ReserveRegion(GLsizeiptr size, bool bWait, GLsizeiptr& offset)
+{
+	size = (size + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1);
+
+	for (;;)
+	{
+		RetireRegions(false);
+
+		if (m_regions.empty())
+		{
+			// the whole ring is free
+			offset = 0;
+			m_ringHead = size;
+			return(true);
+		}
+
+		GLsizeiptr tail = m_regions.front().start;
+		if (m_ringHead > tail)
+		{
+			// the free space is after the head and before the tail
+			if (m_ringHead + size <= m_ringSize)
+			{
+				offset = m_ringHead;
+				m_ringHead += size;
+				return(true);
+			}
+			if (size <= tail)
+			{
+				offset = 0;
+				m_ringHead = size;
+				return(true);
+			}
+		}
+		else if (m_ringHead + size <= tail)
+		{
+			// the head has wrapped, and the free space is
+			// between the head and the tail
+			offset = m_ringHead;
+			m_ringHead += size;
+			return(true);
+		}
+
+		if (bWait == false)
+		{
+			return(false);
+		}
+		RetireRegions(true);
+	}
+}
@@ -0,0 +1,98 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.h
+// ============
+// upload texture pixels through a persistently mapped pixel buffer ring
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <deque>
+
+/***********************************************************
+ *  TextureStreamer
+ *
+ *  This class owns one pixel unpack buffer that stays
+ *  mapped for its whole life.  The pixels of an upload are
+ *  copied into the next free part of the buffer, and the
+ *  texture is filled from the buffer, so OpenGL copies the
+ *  data to the texture on its own time instead of holding
+ *  up the calling thread.  Every upload is followed by a
+ *  fence, and a part of the buffer is only reused once the
+ *  fence of the upload that last used it has signaled.
+ ***********************************************************/
+class TextureStreamer
+{
+public:
+	// constructor
+	TextureStreamer();
+	// destructor
+	~TextureStreamer();
+
+	// create and map the ring buffer
+	bool Initialize(GLsizeiptr ringSize);
+	// wait for the uploads in flight and free the ring buffer
+	void Destroy();
+
+	// copy the pixels of one level of an array texture layer
+	// into the ring and upload them.  When the ring has no
+	// room the upload is skipped and false is returned, unless
+	// bWait is set, in which case it waits for earlier uploads
+	// to finish.  Images larger than the ring are uploaded
+	// directly
+	bool UploadImage(
+		GLuint texture,
+		int level,
+		int layer,
+		int width,
+		int height,
+		GLenum format,
+		const void* pixels,
+		GLsizeiptr size,
+		bool bWait);
+
+	// the same for one level of a block compressed texture
+	bool UploadCompressedImage(
+		GLuint texture,
+		int level,
+		int layer,
+		int width,
+		int height,
+		GLenum internalFormat,
+		const void* data,
+		GLsizeiptr size,
+		bool bWait);
+
+	// true once the ring buffer is mapped
+	bool IsInitialized() const { return(m_pMappedRing != NULL); }
+
+private:
+	// one upload that may still be reading from the ring
+	struct RING_REGION
+	{
+		GLsync fence;
+		GLsizeiptr start;
+		GLsizeiptr end;
+	};
+
+	// pixel unpack buffer and its mapped memory
+	GLuint m_ringBuffer;
+	unsigned char* m_pMappedRing;
+	GLsizeiptr m_ringSize;
+	// offset of the next write into the ring
+	GLsizeiptr m_ringHead;
+	// uploads in flight, oldest first
+	std::deque<RING_REGION> m_regions;
+
+	// free the regions whose uploads have finished - with
+	// bWait set the oldest region is waited on first
+	void RetireRegions(bool bWait);
+	// find room in the ring for an upload
+	bool ReserveRegion(GLsizeiptr size, bool bWait, GLsizeiptr& offset);
+	// stage the data of an upload in the ring, and fence it
+	// once the upload call has been made
+	bool BeginUpload(const void* data, GLsizeiptr size, bool bWait, const void*& source, GLsizeiptr& offset);
+	void EndUpload(bool bFromRing, GLsizeiptr offset, GLsizeiptr size);
+};
@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformbuffers.cpp
+// ============
+// manage the uniform buffer objects shared by every shader program
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UniformBuffers.h"
+
+#include <iostream>
+
+// the structures are copied straight into the std140 blocks,
+// so their sizes must match the shader side byte for byte
+static_assert(sizeof(UniformBuffers::FRAME_DATA) == 144, "FRAME_DATA does not match the std140 FrameData block");
+static_assert(sizeof(UniformBuffers::LIGHT_SOURCE) == 48, "LIGHT_SOURCE does not match the std140 LightSource structure");
+static_assert(sizeof(UniformBuffers::LIGHT_DATA) == 208, "LIGHT_DATA does not match the std140 LightData block");
+static_assert(sizeof(UniformBuffers::MATERIAL) == 48, "MATERIAL does not match the std140 Material structure");
+
+/***********************************************************
+ *  UniformBuffers()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UniformBuffers::UniformBuffers()
+{
+	m_frameDataBuffer = 0;
+	m_lightDataBuffer = 0;
+	m_materialDataBuffer = 0;
+}
+
+/***********************************************************
+ *  ~UniformBuffers()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+UniformBuffers::~UniformBuffers()
+{
+	DestroyBuffers();
+}
+
+/***********************************************************
+ *  CreateBuffers()
+ *
+ *  This method is used for creating the uniform buffers,
+ *  clearing their contents and attaching them to the binding
+ *  points that the shader uniform blocks are declared with.
+ ***********************************************************/
+bool UniformBuffers::CreateBuffers()
+{
+	FRAME_DATA frameData;
+	LIGHT_DATA lightData;
+	MATERIAL_DATA materialData;
+
+	// start with all lights off until the scene defines them
+	for (int i = 0; i < TOTAL_LIGHTS; i++)
+	{
+		lightData.lightSources[i].position = glm::vec3(0.0f);
+		lightData.lightSources[i].focalStrength = 0.0f;
+		lightData.lightSources[i].diffuseColor = glm::vec3(0.0f);
+		lightData.lightSources[i].specularIntensity = 0.0f;
+		lightData.lightSources[i].specularColor = glm::vec3(0.0f);
+		lightData.lightSources[i].padding = 0.0f;
+	}
+	lightData.globalAmbientColor = glm::vec3(0.0f);
+	lightData.padding = 0.0f;
+
+	// every material is black until the scene defines them
+	for (int i = 0; i < TOTAL_MATERIALS; i++)
+	{
+		materialData.materials[i].ambientColor = glm::vec3(0.0f);
+		materialData.materials[i].ambientStrength = 0.0f;
+		materialData.materials[i].diffuseColor = glm::vec3(0.0f);
+		materialData.materials[i].shininess = 0.0f;
+		materialData.materials[i].specularColor = glm::vec3(0.0f);
+		materialData.materials[i].padding = 0.0f;
+	}
+
+	frameData.view = glm::mat4(1.0f);
+	frameData.projection = glm::mat4(1.0f);
+	frameData.viewPosition = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	glCreateBuffers(1, &m_frameDataBuffer);
+	glNamedBufferData(m_frameDataBuffer, sizeof(FRAME_DATA), &frameData, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, m_frameDataBuffer);
+
+	glCreateBuffers(1, &m_lightDataBuffer);
+	glNamedBufferData(m_lightDataBuffer, sizeof(LIGHT_DATA), &lightData, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_DATA_BINDING, m_lightDataBuffer);
+
+	glCreateBuffers(1, &m_materialDataBuffer);
+	glNamedBufferData(m_materialDataBuffer, sizeof(MATERIAL_DATA), &materialData, GL_STATIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_DATA_BINDING, m_materialDataBuffer);
+
+	if ((m_frameDataBuffer == 0) || (m_lightDataBuffer == 0) || (m_materialDataBuffer == 0))
+	{
+		std::cout << "Could not create the uniform buffers" << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyBuffers()
+ *
+ *  This method is used for freeing the uniform buffers.
+ ***********************************************************/
+void UniformBuffers::DestroyBuffers()
+{
+	if (m_frameDataBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_frameDataBuffer);
+		m_frameDataBuffer = 0;
+	}
+	if (m_lightDataBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_lightDataBuffer);
+		m_lightDataBuffer = 0;
+	}
+	if (m_materialDataBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_materialDataBuffer);
+		m_materialDataBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  UpdateFrameData()
+ *
+ *  This method is used for uploading the camera matrices and
+ *  view position for the current frame.
+ ***********************************************************/
+void UniformBuffers::UpdateFrameData(const FRAME_DATA& frameData)
+{
+	if (m_frameDataBuffer != 0)
+	{
+		glNamedBufferSubData(m_frameDataBuffer, 0, sizeof(FRAME_DATA), &frameData);
+	}
+}
+
+/***********************************************************
+ *  UpdateLightData()
+ *
+ *  This method is used for uploading all the light sources
+ *  and the global ambient color.
+ ***********************************************************/
+void UniformBuffers::UpdateLightData(const LIGHT_DATA& lightData)
+{
+	if (m_lightDataBuffer != 0)
+	{
+		glNamedBufferSubData(m_lightDataBuffer, 0, sizeof(LIGHT_DATA), &lightData);
+	}
+}
+
+/***********************************************************
+ *  UpdateMaterialData()
+ *
+ *  This method is used for uploading the whole material
+ *  table.  The materials are defined once with the scene, so
+ *  this is not called while rendering.
+ ***********************************************************/
+void UniformBuffers::UpdateMaterialData(const MATERIAL_DATA& materialData)
+{
+	if (m_materialDataBuffer != 0)
+	{
+		glNamedBufferSubData(m_materialDataBuffer, 0, sizeof(MATERIAL_DATA), &materialData);
+	}
+}
@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformbuffers.h
+// ============
+// manage the uniform buffer objects shared by every shader program
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  UniformBuffers
+ *
+ *  This class owns the std140 uniform buffers for the per
+ *  frame camera data, the scene light data and the table of
+ *  object materials.  Each buffer
+ *  is attached to a fixed binding point that the shaders
+ *  declare, so any number of shader programs read the same
+ *  data and each buffer is uploaded with a single call.
+ ***********************************************************/
+class UniformBuffers
+{
+public:
+	// constructor
+	UniformBuffers();
+	// destructor
+	~UniformBuffers();
+
+	// number of light sources declared in the fragment shader
+	static const int TOTAL_LIGHTS = 4;
+	// number of materials declared in the fragment shader
+	static const int TOTAL_MATERIALS = 32;
+
+	// binding points used by the uniform blocks in the shaders
+	enum BINDING_POINT
+	{
+		FRAME_DATA_BINDING = 0,
+		LIGHT_DATA_BINDING = 1,
+		MATERIAL_DATA_BINDING = 2
+	};
+
+	// std140 layout of the FrameData uniform block
+	struct FRAME_DATA
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec4 viewPosition;
+	};
+
+	// std140 layout of the LightSource structure
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
+		float focalStrength;
+		glm::vec3 diffuseColor;
+		float specularIntensity;
+		glm::vec3 specularColor;
+		float padding;
+	};
+
+	// std140 layout of the LightData uniform block
+	struct LIGHT_DATA
+	{
+		LIGHT_SOURCE lightSources[TOTAL_LIGHTS];
+		glm::vec3 globalAmbientColor;
+		float padding;
+	};
+
+	// std140 layout of the Material structure
+	struct MATERIAL
+	{
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+		float shininess;
+		glm::vec3 specularColor;
+		float padding;
+	};
+
+	// std140 layout of the MaterialData uniform block
+	struct MATERIAL_DATA
+	{
+		MATERIAL materials[TOTAL_MATERIALS];
+	};
+
+	// create the uniform buffers and attach their binding points
+	bool CreateBuffers();
+	// free the uniform buffers
+	void DestroyBuffers();
+
+	// upload the complete block contents with one call each
+	void UpdateFrameData(const FRAME_DATA& frameData);
+	void UpdateLightData(const LIGHT_DATA& lightData);
+	void UpdateMaterialData(const MATERIAL_DATA& materialData);
+
+private:
+	// uniform buffer holding the FrameData block
+	GLuint m_frameDataBuffer;
+	// uniform buffer holding the LightData block
+	GLuint m_lightDataBuffer;
+	// uniform buffer holding the MaterialData block
+	GLuint m_materialDataBuffer;
+};
@@ -0,0 +1,221 @@
+///////////////////////////////////////////////////////////////////////////////
+// viewfrustum.cpp
+// ============
+// test bounding volumes against the planes of the camera view frustum
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ViewFrustum.h"
+
+#include <cmath>
+
+/***********************************************************
+ *  ViewFrustum()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ViewFrustum::ViewFrustum()
+{
+	// until a matrix is set every plane accepts everything
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		m_planeA[i] = 0.0f;
+		m_planeB[i] = 0.0f;
+		m_planeC[i] = 0.0f;
+		m_planeD[i] = 1.0f;
+	}
+}
+
+/***********************************************************
+ *  ~ViewFrustum()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ViewFrustum::~ViewFrustum()
+{
+}
+
+/***********************************************************
+ *  SetFromMatrix()
+ *
+ *  This method is used for extracting the left, right,
+ *  bottom, top, near and far planes from the combined
+ *  projection and view matrix.  Each plane is the sum or
+ *  difference of the fourth row and one of the other rows,
+ *  normalized so that the plane distance is in world units.
+ ***********************************************************/
+void ViewFrustum::SetFromMatrix(const glm::mat4& viewProjection)
+{
+	// glm matrices are column major, so row r is m[0..3][r]
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		int row = i / 2;
+		float sign = ((i % 2) == 0) ? 1.0f : -1.0f;
+
+		float a = viewProjection[0][3] + sign * viewProjection[0][row];
+		float b = viewProjection[1][3] + sign * viewProjection[1][row];
+		float c = viewProjection[2][3] + sign * viewProjection[2][row];
+		float d = viewProjection[3][3] + sign * viewProjection[3][row];
+		float length = std::sqrt(a * a + b * b + c * c);
+
+		if (length > 0.0f)
+		{
+			a /= length;
+			b /= length;
+			c /= length;
+			d /= length;
+		}
+
+		m_planeA[i] = a;
+		m_planeB[i] = b;
+		m_planeC[i] = c;
+		m_planeD[i] = d;
+	}
+}
+
+/***********************************************************
+ *  GetPlanes()
+ *
+ *  This method is used for copying the plane equations out
+ *  as one vector per plane, the layout that shaders use.
+ ***********************************************************/
+void ViewFrustum::GetPlanes(glm::vec4 planes[PLANE_COUNT]) const
+{
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		planes[i] = glm::vec4(m_planeA[i], m_planeB[i], m_planeC[i], m_planeD[i]);
+	}
+}
+
+/***********************************************************
+ *  IsSphereVisible()
+ *
+ *  This method is used for testing whether a bounding sphere
+ *  is at least partly inside the frustum.
+ ***********************************************************/
+bool ViewFrustum::IsSphereVisible(const glm::vec3& center, float radius) const
+{
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		float distance = m_planeA[i] * center.x + m_planeB[i] * center.y + m_planeC[i] * center.z + m_planeD[i];
+		if (distance < -radius)
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsBoxVisible()
+ *
+ *  This method is used for testing whether an axis aligned
+ *  bounding box is at least partly inside the frustum.  For
+ *  every plane only the box corner farthest along the plane
+ *  normal needs to be tested.
+ ***********************************************************/
+bool ViewFrustum::IsBoxVisible(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		float x = (m_planeA[i] >= 0.0f) ? boxMax.x : boxMin.x;
+		float y = (m_planeB[i] >= 0.0f) ? boxMax.y : boxMin.y;
+		float z = (m_planeC[i] >= 0.0f) ? boxMax.z : boxMin.z;
+
+		if (m_planeA[i] * x + m_planeB[i] * y + m_planeC[i] * z + m_planeD[i] < 0.0f)
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ClassifyBox()
+ *
+ *  This method is used for testing whether an axis aligned
+ *  bounding box is outside, partly inside or completely
+ *  inside the frustum.  The box is completely inside when
+ *  even its corner nearest to each plane is on the inner
+ *  side, which lets spatial queries accept whole groups of
+ *  objects without testing them one by one.
+ ***********************************************************/
+ViewFrustum::CONTAINMENT ViewFrustum::ClassifyBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+	CONTAINMENT result = INSIDE;
+
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		bool bPositiveA = (m_planeA[i] >= 0.0f);
+		bool bPositiveB = (m_planeB[i] >= 0.0f);
+		bool bPositiveC = (m_planeC[i] >= 0.0f);
+
+		// corner farthest along the plane normal
+		float farDistance =
+			m_planeA[i] * (bPositiveA ? boxMax.x : boxMin.x) +
+			m_planeB[i] * (bPositiveB ? boxMax.y : boxMin.y) +
+			m_planeC[i] * (bPositiveC ? boxMax.z : boxMin.z) + m_planeD[i];
+		if (farDistance < 0.0f)
+		{
+			return(OUTSIDE);
+		}
+
+		// corner nearest along the plane normal
+		float nearDistance =
+			m_planeA[i] * (bPositiveA ? boxMin.x : boxMax.x) +
+			m_planeB[i] * (bPositiveB ? boxMin.y : boxMax.y) +
+			m_planeC[i] * (bPositiveC ? boxMin.z : boxMax.z) + m_planeD[i];
+		if (nearDistance < 0.0f)
+		{
+			result = INTERSECTING;
+		}
+	}
+
+	return(result);
+}
+
+/***********************************************************
+ *  CullSpheres()
+ *
+ *  This method is used for testing a whole array of bounding
+ *  spheres.  The planes are the outer loop, so the inner loop
+ *  does the same branch-free math for every sphere and is
+ *  turned into SIMD code by the compiler.
+ ***********************************************************/
+int ViewFrustum::CullSpheres(
+	const float* centerX,
+	const float* centerY,
+	const float* centerZ,
+	const float* radius,
+	int sphereCount,
+	unsigned char* visible) const
+{
+	int visibleCount = 0;
+
+	for (int s = 0; s < sphereCount; s++)
+	{
+		visible[s] = 1;
+	}
+
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		const float a = m_planeA[i];
+		const float b = m_planeB[i];
+		const float c = m_planeC[i];
+		const float d = m_planeD[i];
+
+		for (int s = 0; s < sphereCount; s++)
+		{
+			float distance = a * centerX[s] + b * centerY[s] + c * centerZ[s] + d;
+			visible[s] &= (unsigned char)(distance >= -radius[s]);
+		}
+	}
+
+	for (int s = 0; s < sphereCount; s++)
+	{
+		visibleCount += visible[s];
+	}
+
+	return(visibleCount);
+}
@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// viewfrustum.h
+// ============
+// test bounding volumes against the planes of the camera view frustum
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  ViewFrustum
+ *
+ *  This class holds the six planes of the camera view
+ *  frustum, taken from the combined projection and view
+ *  matrix.  The planes are stored as separate arrays of
+ *  their components so that the sphere test can run over
+ *  many objects at once in a loop the compiler vectorizes.
+ ***********************************************************/
+class ViewFrustum
+{
+public:
+	// constructor
+	ViewFrustum();
+	// destructor
+	~ViewFrustum();
+
+	static const int PLANE_COUNT = 6;
+
+	// result of testing a bounding box against the frustum
+	enum CONTAINMENT
+	{
+		OUTSIDE = 0,
+		INTERSECTING,
+		INSIDE
+	};
+
+	// take the frustum planes from a projection * view matrix
+	void SetFromMatrix(const glm::mat4& viewProjection);
+	// copy the plane equations out as (a, b, c, d) vectors
+	void GetPlanes(glm::vec4 planes[PLANE_COUNT]) const;
+
+	// test one bounding volume - true when it may be visible
+	bool IsSphereVisible(const glm::vec3& center, float radius) const;
+	bool IsBoxVisible(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+	// test whether a bounding box is outside, partly inside or
+	// completely inside the frustum
+	CONTAINMENT ClassifyBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+	// test many bounding spheres stored as separate component
+	// arrays, writing 1 for every visible sphere and 0 for
+	// every culled one - returns the number of visible spheres
+	int CullSpheres(
+		const float* centerX,
+		const float* centerY,
+		const float* centerZ,
+		const float* radius,
+		int sphereCount,
+		unsigned char* visible) const;
+
+private:
+	// plane equations ax + by + cz + d, with the normals
+	// pointing into the frustum
+	float m_planeA[PLANE_COUNT];
+	float m_planeB[PLANE_COUNT];
+	float m_planeC[PLANE_COUNT];
+	float m_planeD[PLANE_COUNT];
+};
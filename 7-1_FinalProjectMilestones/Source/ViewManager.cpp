@@ -8,20 +8,22 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "FrameProfiler.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <cstring>
+#include <iostream>
+
 // declaration of the global variables and defines
 namespace
 {
 	// Variables for window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
-	const char* g_ViewName = "view";
-	const char* g_ProjectionName = "projection";
 
 	// camera object used for viewing and interacting with
 	// the 3D scene
@@ -39,6 +41,133 @@ namespace
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
+
+	// while the camera is recorded or played back, the mouse
+	// callbacks add up the movement here instead of moving the
+	// camera, so it is applied at a fixed camera step
+	bool gBufferMouseInput = false;
+	float gPendingMouseX = 0.0f;
+	float gPendingMouseY = 0.0f;
+	float gPendingScroll = 0.0f;
+
+	// set by input and window events until the next frame has
+	// been prepared
+	bool gbViewInvalidated = true;
+
+	// most camera steps taken in one frame while recording, so
+	// a long stall does not turn into a burst of steps
+	const int MAX_TICKS_PER_FRAME = 8;
+
+	// the most simulation steps that are made up for at once
+	// after the simulation thread fell behind
+	const int MAX_SIMULATION_CATCH_UP = 8;
+
+	// the camera values needed to build the view
+	void GetCameraPose(CameraSnapshotBuffer::CAMERA_POSE& pose)
+	{
+		pose.position = g_pCamera->Position;
+		pose.front = g_pCamera->Front;
+		pose.up = g_pCamera->Up;
+		pose.zoom = g_pCamera->Zoom;
+	}
+
+	// copy the camera values that the input changes
+	void GetCameraState(CameraRecording::CAMERA_STATE& state)
+	{
+		state.position = g_pCamera->Position;
+		state.front = g_pCamera->Front;
+		state.up = g_pCamera->Up;
+		state.right = g_pCamera->Right;
+		state.worldUp = g_pCamera->WorldUp;
+		state.yaw = g_pCamera->Yaw;
+		state.pitch = g_pCamera->Pitch;
+		state.zoom = g_pCamera->Zoom;
+		state.movementSpeed = g_pCamera->MovementSpeed;
+		state.mouseSensitivity = g_pCamera->MouseSensitivity;
+		state.orthographic = bOrthographicProjection ? 1 : 0;
+	}
+
+	// restore the camera values that the input changes
+	void SetCameraState(const CameraRecording::CAMERA_STATE& state)
+	{
+		g_pCamera->Position = state.position;
+		g_pCamera->Front = state.front;
+		g_pCamera->Up = state.up;
+		g_pCamera->Right = state.right;
+		g_pCamera->WorldUp = state.worldUp;
+		g_pCamera->Yaw = state.yaw;
+		g_pCamera->Pitch = state.pitch;
+		g_pCamera->Zoom = state.zoom;
+		g_pCamera->MovementSpeed = state.movementSpeed;
+		g_pCamera->MouseSensitivity = state.mouseSensitivity;
+		bOrthographicProjection = (state.orthographic != 0);
+	}
+
+	// move the camera by the input of one step
+	void ApplyCameraInput(const CameraRecording::INPUT_SAMPLE& sample, float deltaTime)
+	{
+		if ((sample.mouseOffsetX != 0.0f) || (sample.mouseOffsetY != 0.0f))
+		{
+			g_pCamera->ProcessMouseMovement(sample.mouseOffsetX, sample.mouseOffsetY);
+		}
+		if (sample.scrollOffset != 0.0f)
+		{
+			g_pCamera->ProcessMouseScroll(sample.scrollOffset);
+		}
+
+		// process camera zooming in and out
+		if (sample.keys & CameraRecording::INPUT_KEY_FORWARD)
+		{
+			g_pCamera->ProcessKeyboard(FORWARD, deltaTime);
+		}
+		if (sample.keys & CameraRecording::INPUT_KEY_BACKWARD)
+		{
+			g_pCamera->ProcessKeyboard(BACKWARD, deltaTime);
+		}
+
+		// process camera panning left and right
+		if (sample.keys & CameraRecording::INPUT_KEY_LEFT)
+		{
+			g_pCamera->ProcessKeyboard(LEFT, deltaTime);
+		}
+		if (sample.keys & CameraRecording::INPUT_KEY_RIGHT)
+		{
+			g_pCamera->ProcessKeyboard(RIGHT, deltaTime);
+		}
+
+		// process camera panning up and down
+		if (sample.keys & CameraRecording::INPUT_KEY_UP)
+		{
+			g_pCamera->ProcessKeyboard(UP, deltaTime);
+		}
+		if (sample.keys & CameraRecording::INPUT_KEY_DOWN)
+		{
+			g_pCamera->ProcessKeyboard(DOWN, deltaTime);
+		}
+
+		// change to a orthographic view
+		if (sample.keys & CameraRecording::INPUT_KEY_ORTHOGRAPHIC)
+		{
+			// change to a multi-view orthogrpahic projection
+			bOrthographicProjection = true;
+
+			// chnage the camera settings to show a front orthographic view
+			g_pCamera->Position = glm::vec3(0.0f, 0.0f, 35.0f);
+			g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
+			g_pCamera->Front = glm::vec3(0.0f, 0.0f, -1.0f);
+		}
+		// change to a perspective view
+		if (sample.keys & CameraRecording::INPUT_KEY_PERSPECTIVE)
+		{
+			bOrthographicProjection = false;
+
+			// change the camera settings to show a perspective view
+			g_pCamera->Position = glm::vec3(0.0f, 10.0f, 25.0f);
+			g_pCamera->Up = glm::vec3(0.0f, 0.5f, 2.0f);
+			g_pCamera->Front = glm::vec3(0.0f, 1.0f, -10.0f);
+			g_pCamera->Zoom = 80;
+		}
+	}
 }
 
 /***********************************************************
@@ -47,11 +176,29 @@ namespace
  *  The constructor for the class
  ***********************************************************/
 ViewManager::ViewManager(
-	ShaderManager *pShaderManager)
+	ShaderManager *pShaderManager,
+	UniformBuffers *pUniformBuffers)
 {
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
+	m_pUniformBuffers = pUniformBuffers;
 	m_pWindow = NULL;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_viewPosition = glm::vec3(0.0f);
+	m_cameraMode = CAMERA_MODE_LIVE;
+	m_tickTime = 0.0;
+	m_playbackTick = 0;
+	m_nextCheckpoint = 0;
+	m_driftedCheckpoints = 0;
+	m_heldKeys = 0;
+	m_bViewChanged = false;
+	m_bSimulationRunning.store(false);
+	m_bSimulationMoved.store(false);
+	m_simulationInput.keys = 0;
+	m_simulationInput.mouseOffsetX = 0.0f;
+	m_simulationInput.mouseOffsetY = 0.0f;
+	m_simulationInput.scrollOffset = 0.0f;
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -68,8 +215,14 @@ ViewManager::ViewManager(
  ***********************************************************/
 ViewManager::~ViewManager()
 {
+	// a recording that was not stopped is still saved, and the
+	// simulation thread is stopped before the camera is freed
+	StopRecording();
+	StopSimulation();
+
 	// free up allocated memory
 	m_pShaderManager = NULL;
+	m_pUniformBuffers = NULL;
 	m_pWindow = NULL;
 	if (NULL != g_pCamera)
 	{
@@ -110,13 +263,13 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	// this callback is used to recive mouse scroll wheel events
 	glfwSetScrollCallback(window, &ViewManager::Mouse_Scroll_Wheel_Callback);
 
+	// these callbacks are used to redraw the scene on demand
+	glfwSetKeyCallback(window, &ViewManager::Key_Callback);
+	glfwSetWindowRefreshCallback(window, &ViewManager::Window_Refresh_Callback);
+
 	// tell GLFW to capture all mouse events
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-	// enable blending for supporting tranparent rendering
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
 	m_pWindow = window;
 
 	return(window);
@@ -130,6 +283,8 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
  ***********************************************************/
 void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
 {
+	gbViewInvalidated = true;
+
 	// when the first mouse move event is received, this needs to be recorded so that
 	// all subsequent mouse moves can correctly calculate the X position offset and Y
 	// position offset for proper operation
@@ -148,6 +303,15 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 	gLastX = xMousePos;
 	gLastY = yMousePos;
 
+	// keep the offsets for the next camera step while the camera
+	// is recorded or played back
+	if (gBufferMouseInput)
+	{
+		gPendingMouseX += xOffset;
+		gPendingMouseY += yOffset;
+		return;
+	}
+
 	// move the 3D camera according to the calculated offsets
 	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
 }
@@ -160,10 +324,45 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
  ***********************************************************/
 void ViewManager::Mouse_Scroll_Wheel_Callback(GLFWwindow* window, double x, double yScrollDistance)
 {
+	gbViewInvalidated = true;
+
+	// keep the distance for the next camera step while the camera
+	// is recorded or played back
+	if (gBufferMouseInput)
+	{
+		gPendingScroll += (float)yScrollDistance;
+		return;
+	}
+
 	// call the camera method to handle the mouse wheel scrolling
 	g_pCamera->ProcessMouseScroll(yScrollDistance);
 }
 
+/***********************************************************
+ *  Key_Callback()
+ *
+ *  This method is automatically called from GLFW whenever a
+ *  key is pressed or released.  The keys themselves are read
+ *  when the frame is prepared, so this only marks the frame
+ *  for redrawing.
+ ***********************************************************/
+void ViewManager::Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	gbViewInvalidated = true;
+}
+
+/***********************************************************
+ *  Window_Refresh_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the contents of the window need to be drawn again, such
+ *  as after it was uncovered or resized.
+ ***********************************************************/
+void ViewManager::Window_Refresh_Callback(GLFWwindow* window)
+{
+	gbViewInvalidated = true;
+}
+
 /***********************************************************
  *  ProcessKeyboardEvents()
  *
@@ -172,63 +371,165 @@ void ViewManager::Mouse_Scroll_Wheel_Callback(GLFWwindow* window, double x, doub
  ***********************************************************/
 void ViewManager::ProcessKeyboardEvents()
 {
+	CameraRecording::INPUT_SAMPLE sample;
+
+	// move the camera by the keys held down for this frame - the
+	// mouse has already moved it from the callbacks
+	sample.keys = ReadInputKeys();
+	sample.mouseOffsetX = 0.0f;
+	sample.mouseOffsetY = 0.0f;
+	sample.scrollOffset = 0.0f;
+	ApplyCameraInput(sample, gDeltaTime);
+}
+
+/***********************************************************
+ *  ReadInputKeys()
+ *
+ *  This method is used for reading which of the camera keys
+ *  are held down.  The escape key closes the window here, as
+ *  it is never recorded.
+ ***********************************************************/
+uint32_t ViewManager::ReadInputKeys()
+{
+	uint32_t keys = 0;
+
 	// close the window if the escape key has been pressed
 	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 	{
 		glfwSetWindowShouldClose(m_pWindow, true);
 	}
 
-	// process camera zooming in and out
 	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
+		keys |= CameraRecording::INPUT_KEY_FORWARD;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
+		keys |= CameraRecording::INPUT_KEY_BACKWARD;
 	}
-
-	// process camera panning left and right
 	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
+		keys |= CameraRecording::INPUT_KEY_LEFT;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
+		keys |= CameraRecording::INPUT_KEY_RIGHT;
 	}
-	
-	// process camera panning up and down
 	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
+		keys |= CameraRecording::INPUT_KEY_UP;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
+		keys |= CameraRecording::INPUT_KEY_DOWN;
 	}
-
-	// change to a orthographic view
 	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
 	{
-		// change to a multi-view orthogrpahic projection
-		bOrthographicProjection = true;
-
-		// chnage the camera settings to show a front orthographic view
-		g_pCamera->Position = glm::vec3(0.0f, 0.0f, 35.0f);
-		g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
-		g_pCamera->Front = glm::vec3(0.0f, 0.0f, -1.0f);
+		keys |= CameraRecording::INPUT_KEY_ORTHOGRAPHIC;
 	}
-	// change to a perspective view
 	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
 	{
-		bOrthographicProjection = false;
+		keys |= CameraRecording::INPUT_KEY_PERSPECTIVE;
+	}
+	m_heldKeys = keys;
+
+	return(keys);
+}
+
+/***********************************************************
+ *  StepRecording()
+ *
+ *  This method is used for moving the camera while it is
+ *  recorded.  The frame time is added up and the camera is
+ *  moved in whole steps of the recording rate, with the keys
+ *  held down during this frame, and every step is recorded.
+ *  The mouse movement since the last step goes into the next
+ *  step only, so the live camera moves exactly as it will
+ *  when the recording is played back.
+ ***********************************************************/
+void ViewManager::StepRecording(float deltaTime)
+{
+	const double tickSeconds = 1.0 / (double)CameraRecording::TICKS_PER_SECOND;
+	uint32_t keys = ReadInputKeys();
+	int tickCount = 0;
+
+	m_tickTime += deltaTime;
+	while ((m_tickTime >= tickSeconds) && (tickCount < MAX_TICKS_PER_FRAME))
+	{
+		CameraRecording::INPUT_SAMPLE sample;
+
+		sample.keys = keys;
+		sample.mouseOffsetX = gPendingMouseX;
+		sample.mouseOffsetY = gPendingMouseY;
+		sample.scrollOffset = gPendingScroll;
+		gPendingMouseX = 0.0f;
+		gPendingMouseY = 0.0f;
+		gPendingScroll = 0.0f;
+
+		ApplyCameraInput(sample, (float)tickSeconds);
+		m_recording.AddSample(sample);
+
+		// save the camera state at regular steps for the
+		// playback to check against
+		if ((m_recording.GetTickCount() % CameraRecording::CHECKPOINT_INTERVAL) == 0)
+		{
+			CameraRecording::CAMERA_STATE state;
+			GetCameraState(state);
+			m_recording.AddCheckpoint((uint32_t)m_recording.GetTickCount(), state);
+		}
+
+		m_tickTime -= tickSeconds;
+		tickCount++;
+	}
+
+	// time beyond the most steps in a frame is dropped
+	if (tickCount == MAX_TICKS_PER_FRAME)
+	{
+		m_tickTime = 0.0;
+	}
+}
+
+/***********************************************************
+ *  StepPlayback()
+ *
+ *  This method is used for moving the camera by the next
+ *  recorded step.  Every frame takes exactly one step, no
+ *  matter how long the frame took, so the same frame number
+ *  always shows the same view.  When a saved camera state
+ *  does not match, the camera is set to the saved state so
+ *  the rest of the playback still follows the recording.
+ ***********************************************************/
+void ViewManager::StepPlayback()
+{
+	if (m_playbackTick >= m_recording.GetTickCount())
+	{
+		return;
+	}
+
+	float tickSeconds = 1.0f / (float)m_recording.GetTicksPerSecond();
+	ApplyCameraInput(m_recording.GetSample(m_playbackTick), tickSeconds);
+	m_playbackTick++;
+
+	while ((m_nextCheckpoint < m_recording.GetCheckpointCount()) &&
+		((int)m_recording.GetCheckpoint(m_nextCheckpoint).tick <= m_playbackTick))
+	{
+		const CameraRecording::CHECKPOINT& checkpoint = m_recording.GetCheckpoint(m_nextCheckpoint);
+		if ((int)checkpoint.tick == m_playbackTick)
+		{
+			CameraRecording::CAMERA_STATE state;
+			GetCameraState(state);
+			if (memcmp(&state, &checkpoint.state, sizeof(state)) != 0)
+			{
+				m_driftedCheckpoints++;
+				SetCameraState(checkpoint.state);
+			}
+		}
+		m_nextCheckpoint++;
+	}
 
-		// change the camera settings to show a perspective view
-		g_pCamera->Position = glm::vec3(0.0f, 10.0f, 25.0f);
-		g_pCamera->Up = glm::vec3(0.0f, 0.5f, 2.0f);
-		g_pCamera->Front = glm::vec3(0.0f, 1.0f, -10.0f);
-		g_pCamera->Zoom = 80;
+	if ((m_playbackTick == m_recording.GetTickCount()) && (m_driftedCheckpoints > 0))
+	{
+		std::cout << "INFO: Camera playback corrected " << m_driftedCheckpoints << " drifted camera states" << std::endl;
 	}
 }
 
@@ -241,8 +542,11 @@ void ViewManager::ProcessKeyboardEvents()
  ***********************************************************/
 void ViewManager::PrepareSceneView()
 {
+	PROFILE_SCOPE("Prepare scene view");
+
 	glm::mat4 view;
 	glm::mat4 projection;
+	CameraSnapshotBuffer::CAMERA_POSE pose;
 
 	// per-frame timing
 	float currentFrame = glfwGetTime();
@@ -250,23 +554,392 @@ void ViewManager::PrepareSceneView()
 	gLastFrame = currentFrame;
 
 	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+	// event queue - a recorded camera is moved in fixed steps
+	// instead of by the frame time
+	switch (m_cameraMode)
+	{
+	case CAMERA_MODE_RECORDING:
+		StepRecording(gDeltaTime);
+		break;
+	case CAMERA_MODE_PLAYBACK:
+		// the live input is ignored, except for closing the
+		// window
+		ReadInputKeys();
+		gPendingMouseX = 0.0f;
+		gPendingMouseY = 0.0f;
+		gPendingScroll = 0.0f;
+		StepPlayback();
+		break;
+	case CAMERA_MODE_SIMULATION:
+		// the camera belongs to the simulation thread, so the
+		// view is built from its published steps instead
+		UpdateSimulatedCamera(pose);
+		break;
+	default:
+		ProcessKeyboardEvents();
+		break;
+	}
 
 	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	if (m_cameraMode == CAMERA_MODE_SIMULATION)
+	{
+		view = glm::lookAt(pose.position, pose.position + pose.front, pose.up);
+	}
+	else
+	{
+		GetCameraPose(pose);
+		view = g_pCamera->GetViewMatrix();
+	}
 
 	// define the current projection matrix
-	projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+	projection = glm::perspective(glm::radians(pose.zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+
+	// keep the camera values for the scene to sort and cull with
+	m_bViewChanged = (view != m_viewMatrix) || (projection != m_projectionMatrix);
+	gbViewInvalidated = false;
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+	m_viewPosition = pose.position;
+
+	// if the uniform buffers object is valid
+	if (NULL != m_pUniformBuffers)
+	{
+		UniformBuffers::FRAME_DATA frameData;
+
+		// the view matrix, projection matrix and view position of
+		// the camera are sent to every shader in a single upload
+		frameData.view = view;
+		frameData.projection = projection;
+		frameData.viewPosition = glm::vec4(pose.position, 1.0f);
+		m_pUniformBuffers->UpdateFrameData(frameData);
+	}
+}
+
+/***********************************************************
+ *  StartRecording()
+ *
+ *  This method is used for recording the camera from its
+ *  current state.  The recording is written to the passed
+ *  in file when it is stopped.
+ ***********************************************************/
+bool ViewManager::StartRecording(const char* filename)
+{
+	CameraRecording::CAMERA_STATE state;
+
+	if ((NULL == filename) || (m_cameraMode != CAMERA_MODE_LIVE))
+	{
+		return(false);
+	}
+
+	GetCameraState(state);
+	m_recording.Clear(state);
+	m_recordingFilename = filename;
+	m_tickTime = 0.0;
+	gBufferMouseInput = true;
+	gPendingMouseX = 0.0f;
+	gPendingMouseY = 0.0f;
+	gPendingScroll = 0.0f;
+	m_cameraMode = CAMERA_MODE_RECORDING;
+
+	std::cout << "INFO: Recording the camera to " << m_recordingFilename << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  StopRecording()
+ *
+ *  This method is used for ending the camera recording and
+ *  writing it to its file.
+ ***********************************************************/
+bool ViewManager::StopRecording()
+{
+	if (m_cameraMode != CAMERA_MODE_RECORDING)
+	{
+		return(false);
+	}
+
+	m_cameraMode = CAMERA_MODE_LIVE;
+	gBufferMouseInput = false;
+
+	if (m_recording.Save(m_recordingFilename.c_str()) == false)
+	{
+		std::cout << "Could not write the camera recording:" << m_recordingFilename << std::endl;
+		return(false);
+	}
+	std::cout << "INFO: Camera recording of " << m_recording.GetTickCount() << " steps written to "
+		<< m_recordingFilename << std::endl;
+
+	return(true);
+}
 
-	// if the shader manager object is valid
-	if (NULL != m_pShaderManager)
+/***********************************************************
+ *  StartPlayback()
+ *
+ *  This method is used for reading a camera recording and
+ *  playing it back from its first step.
+ ***********************************************************/
+bool ViewManager::StartPlayback(const char* filename)
+{
+	if ((NULL == filename) || (m_cameraMode != CAMERA_MODE_LIVE))
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		return(false);
 	}
-}
\ No newline at end of file
+
+	if (m_recording.Load(filename) == false)
+	{
+		std::cout << "Could not load the camera recording:" << filename << std::endl;
+		return(false);
+	}
+
+	gBufferMouseInput = true;
+	m_cameraMode = CAMERA_MODE_PLAYBACK;
+	RestartPlayback();
+
+	std::cout << "INFO: Playing back " << m_recording.GetTickCount() << " camera steps from " << filename << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  RestartPlayback()
+ *
+ *  This method is used for setting the camera back to the
+ *  start of the recording being played back.
+ ***********************************************************/
+void ViewManager::RestartPlayback()
+{
+	if (m_cameraMode != CAMERA_MODE_PLAYBACK)
+	{
+		return;
+	}
+
+	SetCameraState(m_recording.GetStartState());
+	m_playbackTick = 0;
+	m_nextCheckpoint = 0;
+	m_driftedCheckpoints = 0;
+}
+
+/***********************************************************
+ *  IsPlaybackFinished()
+ *
+ *  This method is used for checking whether every recorded
+ *  step has been played back.
+ ***********************************************************/
+bool ViewManager::IsPlaybackFinished() const
+{
+	return((m_cameraMode == CAMERA_MODE_PLAYBACK) && (m_playbackTick >= m_recording.GetTickCount()));
+}
+
+/***********************************************************
+ *  NeedsRedraw()
+ *
+ *  This method is used for checking whether the next frame
+ *  would look any different from the last one.  A frame is
+ *  needed after input or window events, while camera keys
+ *  are held down or the camera is still moving, and on every
+ *  step of a camera playback.
+ ***********************************************************/
+bool ViewManager::NeedsRedraw() const
+{
+	if (gbViewInvalidated || m_bViewChanged || (m_heldKeys != 0) || m_bSimulationMoved.load())
+	{
+		return(true);
+	}
+
+	// buffered mouse movement is only applied at the next step
+	if ((gPendingMouseX != 0.0f) || (gPendingMouseY != 0.0f) || (gPendingScroll != 0.0f))
+	{
+		return(true);
+	}
+
+	return((m_cameraMode == CAMERA_MODE_PLAYBACK) && (m_playbackTick < m_recording.GetTickCount()));
+}
+
+/***********************************************************
+ *  ResetFrameTime()
+ *
+ *  This method is used for restarting the frame timing, so
+ *  that the first frame after the loop waited for events
+ *  does not move the camera by the whole time it waited.
+ ***********************************************************/
+void ViewManager::ResetFrameTime()
+{
+	gLastFrame = glfwGetTime();
+}
+
+/***********************************************************
+ *  StartSimulation()
+ *
+ *  This method is used for moving the camera on its own
+ *  thread.  The thread steps the camera at a fixed rate,
+ *  with the input that the frames hand to it, and publishes
+ *  the camera before and after every step.  The frames build
+ *  the view in between the two, so the camera moves smoothly
+ *  and at the same speed however long the frames take.
+ ***********************************************************/
+bool ViewManager::StartSimulation()
+{
+	CameraSnapshotBuffer::CAMERA_SNAPSHOT snapshot;
+
+	if (m_cameraMode != CAMERA_MODE_LIVE)
+	{
+		return(false);
+	}
+
+	// the frames have a snapshot to read before the first step
+	GetCameraPose(snapshot.current);
+	snapshot.previous = snapshot.current;
+	snapshot.time = 0.0;
+	snapshot.tick = 0;
+	m_snapshots.Reset(snapshot);
+
+	m_simulationInput.keys = 0;
+	m_simulationInput.mouseOffsetX = 0.0f;
+	m_simulationInput.mouseOffsetY = 0.0f;
+	m_simulationInput.scrollOffset = 0.0f;
+	gBufferMouseInput = true;
+	gPendingMouseX = 0.0f;
+	gPendingMouseY = 0.0f;
+	gPendingScroll = 0.0f;
+
+	m_cameraMode = CAMERA_MODE_SIMULATION;
+	m_simulationStart = std::chrono::steady_clock::now();
+	m_bSimulationRunning.store(true);
+	m_simulationThread = std::thread(&ViewManager::SimulationThreadMain, this);
+
+	std::cout << "INFO: The camera is simulated at " << CameraRecording::TICKS_PER_SECOND
+		<< " steps per second on its own thread" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  StopSimulation()
+ *
+ *  This method is used for stopping the simulation thread.
+ *  The camera keeps the state of the last step.
+ ***********************************************************/
+void ViewManager::StopSimulation()
+{
+	if (m_cameraMode != CAMERA_MODE_SIMULATION)
+	{
+		return;
+	}
+
+	m_bSimulationRunning.store(false);
+	if (m_simulationThread.joinable())
+	{
+		m_simulationThread.join();
+	}
+	m_cameraMode = CAMERA_MODE_LIVE;
+	gBufferMouseInput = false;
+}
+
+/***********************************************************
+ *  SimulationThreadMain()
+ *
+ *  This method runs on the simulation thread.  It steps the
+ *  camera on a fixed schedule with the input collected since
+ *  the last step, and publishes every step.  A thread that
+ *  fell far behind skips ahead instead of stepping in a
+ *  burst.  A step that moved the camera wakes the render
+ *  loop, in case it is waiting for events.
+ ***********************************************************/
+void ViewManager::SimulationThreadMain()
+{
+	const std::chrono::steady_clock::duration tickDuration =
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(1.0 / (double)CameraRecording::TICKS_PER_SECOND));
+	const float tickSeconds = 1.0f / (float)CameraRecording::TICKS_PER_SECOND;
+	std::chrono::steady_clock::time_point nextTick = m_simulationStart + tickDuration;
+	CameraSnapshotBuffer::CAMERA_SNAPSHOT snapshot;
+	uint64_t tick = 0;
+
+	GetCameraPose(snapshot.current);
+
+	while (m_bSimulationRunning.load())
+	{
+		std::this_thread::sleep_until(nextTick);
+
+		// take the input handed over since the last step - the
+		// mouse movement only goes into one step
+		CameraRecording::INPUT_SAMPLE sample;
+		{
+			std::lock_guard<std::mutex> lock(m_simulationInputMutex);
+			sample = m_simulationInput;
+			m_simulationInput.mouseOffsetX = 0.0f;
+			m_simulationInput.mouseOffsetY = 0.0f;
+			m_simulationInput.scrollOffset = 0.0f;
+		}
+
+		snapshot.previous = snapshot.current;
+		ApplyCameraInput(sample, tickSeconds);
+		GetCameraPose(snapshot.current);
+		snapshot.time = std::chrono::duration<double>(nextTick - m_simulationStart).count();
+		snapshot.tick = ++tick;
+		m_snapshots.Publish(snapshot);
+
+		if (memcmp(&snapshot.previous, &snapshot.current, sizeof(snapshot.current)) != 0)
+		{
+			m_bSimulationMoved.store(true);
+			glfwPostEmptyEvent();
+		}
+
+		nextTick += tickDuration;
+		if (std::chrono::steady_clock::now() - nextTick > tickDuration * MAX_SIMULATION_CATCH_UP)
+		{
+			nextTick = std::chrono::steady_clock::now();
+		}
+	}
+}
+
+/***********************************************************
+ *  UpdateSimulatedCamera()
+ *
+ *  This method is used for handing the keys and the mouse
+ *  movement of this frame to the simulation thread, and for
+ *  finding the camera for this frame.  The frame is placed
+ *  between the two newest steps by the time since the newest
+ *  one, so the view trails the simulation by up to one step
+ *  and never jumps between steps.
+ ***********************************************************/
+void ViewManager::UpdateSimulatedCamera(CameraSnapshotBuffer::CAMERA_POSE& pose)
+{
+	uint32_t keys = ReadInputKeys();
+	{
+		std::lock_guard<std::mutex> lock(m_simulationInputMutex);
+		m_simulationInput.keys = keys;
+		m_simulationInput.mouseOffsetX += gPendingMouseX;
+		m_simulationInput.mouseOffsetY += gPendingMouseY;
+		m_simulationInput.scrollOffset += gPendingScroll;
+	}
+	gPendingMouseX = 0.0f;
+	gPendingMouseY = 0.0f;
+	gPendingScroll = 0.0f;
+	m_bSimulationMoved.store(false);
+
+	const CameraSnapshotBuffer::CAMERA_SNAPSHOT& snapshot = m_snapshots.Read();
+	double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_simulationStart).count();
+	float alpha = (float)((now - snapshot.time) * (double)CameraRecording::TICKS_PER_SECOND);
+	alpha = glm::clamp(alpha, 0.0f, 1.0f);
+
+	pose.position = glm::mix(snapshot.previous.position, snapshot.current.position, alpha);
+	pose.zoom = glm::mix(snapshot.previous.zoom, snapshot.current.zoom, alpha);
+
+	// a switch between the perspective and orthographic views
+	// can flip the vectors, so they are only blended while they
+	// point the same way - the blend of two unit vectors is
+	// shorter than either, so it is made unit length again
+	if ((glm::dot(snapshot.previous.front, snapshot.current.front) <= 0.0f) ||
+		(glm::dot(snapshot.previous.up, snapshot.current.up) <= 0.0f))
+	{
+		pose.front = snapshot.current.front;
+		pose.up = snapshot.current.up;
+	}
+	else
+	{
+		pose.front = glm::normalize(glm::mix(snapshot.previous.front, snapshot.current.front, alpha));
+		pose.up = glm::normalize(glm::mix(snapshot.previous.up, snapshot.current.up, alpha));
+	}
+}
@@ -9,18 +9,28 @@
 
 #pragma once
 
+#include "CameraRecording.h"
+#include "CameraSnapshotBuffer.h"
 #include "ShaderManager.h"
+#include "UniformBuffers.h"
 #include "camera.h"
 
 // GLFW library
 #include "GLFW/glfw3.h" 
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
 class ViewManager
 {
 public:
 	// constructor
 	ViewManager(
-		ShaderManager* pShaderManager);
+		ShaderManager* pShaderManager,
+		UniformBuffers* pUniformBuffers);
 	// destructor
 	~ViewManager();
 
@@ -30,14 +40,70 @@ public:
 	// mouse scroll wheel callback for mouse interaction with the 3D scene
 	static void Mouse_Scroll_Wheel_Callback(GLFWwindow* window, double x, double yScrollDistance);
 
+	// key callback that marks the frame for redrawing
+	static void Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+
+	// window refresh callback for a window that was uncovered or resized
+	static void Window_Refresh_Callback(GLFWwindow* window);
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// pointer to the shared uniform buffers
+	UniformBuffers* m_pUniformBuffers;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// camera values used for the most recent frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	glm::vec3 m_viewPosition;
+
+	// where the camera input comes from
+	enum CAMERA_MODE
+	{
+		CAMERA_MODE_LIVE = 0,
+		CAMERA_MODE_RECORDING,
+		CAMERA_MODE_PLAYBACK,
+		CAMERA_MODE_SIMULATION
+	};
+	CAMERA_MODE m_cameraMode;
+	// camera session being recorded or played back
+	CameraRecording m_recording;
+	std::string m_recordingFilename;
+	// time not yet stepped while recording
+	double m_tickTime;
+	// next step and next saved camera state of the playback
+	int m_playbackTick;
+	int m_nextCheckpoint;
+	// saved camera states that the playback did not match
+	int m_driftedCheckpoints;
+	// camera keys held down in the most recent frame, and
+	// whether that frame moved the camera
+	uint32_t m_heldKeys;
+	bool m_bViewChanged;
+	// thread that steps the camera at a fixed rate, the input
+	// handed to it, and the snapshots that it publishes
+	std::thread m_simulationThread;
+	std::atomic<bool> m_bSimulationRunning;
+	std::atomic<bool> m_bSimulationMoved;
+	std::mutex m_simulationInputMutex;
+	CameraRecording::INPUT_SAMPLE m_simulationInput;
+	CameraSnapshotBuffer m_snapshots;
+	std::chrono::steady_clock::time_point m_simulationStart;
 
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
+	// camera keys that are held down
+	uint32_t ReadInputKeys();
+	// step the camera at the fixed rate while recording, or by
+	// one recorded step while playing back
+	void StepRecording(float deltaTime);
+	void StepPlayback();
+	// step the camera on the simulation thread
+	void SimulationThreadMain();
+	// hand the input to the simulation thread and interpolate
+	// the camera between its two newest steps
+	void UpdateSimulatedCamera(CameraSnapshotBuffer::CAMERA_POSE& pose);
 
 public:
 	// create the initial OpenGL display window
@@ -45,4 +111,34 @@ public:
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// record the camera input to a file until the recording
+	// is stopped, or play a recorded file back
+	bool StartRecording(const char* filename);
+	bool StopRecording();
+	bool StartPlayback(const char* filename);
+	// start the playback over from the first step
+	void RestartPlayback();
+	// true once every recorded step has been played back
+	bool IsPlaybackFinished() const;
+	// number of steps in the recording being played back
+	int GetPlaybackTickCount() const { return(m_recording.GetTickCount()); }
+
+	// step the camera on its own thread at a fixed rate, with
+	// the frames interpolating between its steps
+	bool StartSimulation();
+	void StopSimulation();
+
+	// true when the next frame would look different from the
+	// last one - the camera is moving, input arrived, or the
+	// window needs to be drawn again
+	bool NeedsRedraw() const;
+	// restart the frame timing after the loop was idle, so the
+	// idle time does not move the camera
+	void ResetFrameTime();
+
+	// camera values used for the most recent frame
+	const glm::mat4& GetViewMatrix() const { return(m_viewMatrix); }
+	const glm::mat4& GetProjectionMatrix() const { return(m_projectionMatrix); }
+	const glm::vec3& GetViewPosition() const { return(m_viewPosition); }
 };
\ No newline at end of file
@@ -0,0 +1,199 @@
+#version 430 core
+
+// the culling runs in three passes, one dispatch each:
+//  0 - one invocation per instance: cull it, pick its level of
+//      detail and count it in the draw command of that level
+//  1 - one invocation per batch: give each level of the batch
+//      its own slice of the batch range, sized by its count
+//  2 - one invocation per instance: copy the visible instance
+//      into the slice of its level
+// so the draw instances need no more room than the instances
+layout (local_size_x = 64) in;
+
+// levels of detail of every mesh, as in MeshLibrary
+const uint LOD_COUNT = 3u;
+// the level of an instance is kept in the low bits of its
+// entry, with this bit set when the instance is visible
+const uint LOD_MASK = 0xFFu;
+const uint VISIBLE_BIT = 0x100u;
+
+// per-instance values, laid out like MeshLibrary::INSTANCE_DATA
+struct Instance
+{
+   mat4 model;
+   vec4 color;
+   vec2 uvScale;
+   float textureLayer;
+   float textureArray;
+   float materialIndex;
+   float padding[3];
+};
+
+// indirect indexed draw command
+struct DrawCommand
+{
+   uint count;
+   uint instanceCount;
+   uint firstIndex;
+   int baseVertex;
+   uint baseInstance;
+};
+
+// world space bounding sphere of every instance - center and radius
+layout (std430, binding = 3) readonly buffer InstanceBounds
+{
+   vec4 instanceBounds[];
+};
+
+// every instance of every batch, in batch order
+layout (std430, binding = 4) readonly buffer SourceInstances
+{
+   Instance sourceInstances[];
+};
+
+// visible instances, packed into the slices of their levels
+layout (std430, binding = 5) writeonly buffer DrawInstances
+{
+   Instance drawInstances[];
+};
+
+// one draw command per drawn batch, counting its visible instances
+layout (std430, binding = 6) buffer DrawCommands
+{
+   DrawCommand drawCommands[];
+};
+
+// batch of every instance
+layout (std430, binding = 7) readonly buffer InstanceBatches
+{
+   int instanceBatches[];
+};
+
+// first draw command of every batch, followed by one for each
+// further level of detail - -1 when the batch is not drawn
+layout (std430, binding = 8) readonly buffer BatchCommands
+{
+   int batchCommands[];
+};
+
+// level of detail each instance was last drawn at, and
+// whether it is visible this frame
+layout (std430, binding = 9) buffer InstanceLODs
+{
+   uint instanceLODs[];
+};
+
+// frustum planes with the normals pointing inwards
+uniform vec4 frustumPlanes[6];
+uniform uint instanceCount;
+uniform uint batchCount;
+uniform uint cullPass;
+
+// camera view and the projection scale of the Y axis, for the
+// projected size of the bounding spheres
+uniform mat4 viewMatrix;
+uniform float projectionScale;
+// smallest screen size of each level but the last, and how far
+// past a boundary the size has to move before the level changes
+uniform float lodScreenSizes[LOD_COUNT - 1u];
+uniform float lodHysteresis;
+
+// cull an instance, pick its level and count it in its command
+void ClassifyInstance(uint instance)
+{
+   uint lod = instanceLODs[instance] & LOD_MASK;
+   instanceLODs[instance] = lod;
+
+   // the sphere is culled when it is completely behind any plane
+   vec4 bounds = instanceBounds[instance];
+   for(int i = 0; i < 6; i++)
+   {
+      if(dot(frustumPlanes[i].xyz, bounds.xyz) + frustumPlanes[i].w < -bounds.w)
+      {
+         return;
+      }
+   }
+
+   int command = batchCommands[instanceBatches[instance]];
+   if(command < 0)
+   {
+      return;
+   }
+
+   // the radius over the view depth, as a fraction of the screen
+   // height - very large when the camera is inside the sphere
+   float depth = -(viewMatrix * vec4(bounds.xyz, 1.0)).z;
+   float screenSize = (depth > bounds.w) ? (bounds.w * projectionScale / depth) : 1.0e30;
+
+   while((lod > 0u) && (screenSize > lodScreenSizes[lod - 1u] * (1.0 + lodHysteresis)))
+   {
+      lod--;
+   }
+   while((lod < LOD_COUNT - 1u) && (screenSize < lodScreenSizes[lod] * (1.0 - lodHysteresis)))
+   {
+      lod++;
+   }
+   instanceLODs[instance] = lod | VISIBLE_BIT;
+
+   atomicAdd(drawCommands[command + int(lod)].instanceCount, 1u);
+}
+
+// split the range of a batch into one slice per level
+void PlaceBatch(uint batch)
+{
+   int command = batchCommands[batch];
+   if(command < 0)
+   {
+      return;
+   }
+
+   // the first command starts at the first instance of the batch
+   uint first = drawCommands[command].baseInstance;
+   for(int lod = 0; lod < int(LOD_COUNT); lod++)
+   {
+      uint count = drawCommands[command + lod].instanceCount;
+      drawCommands[command + lod].baseInstance = first;
+      drawCommands[command + lod].instanceCount = 0u;
+      first += count;
+   }
+}
+
+// copy a visible instance into the slice of its level
+void ScatterInstance(uint instance)
+{
+   uint entry = instanceLODs[instance];
+   if((entry & VISIBLE_BIT) == 0u)
+   {
+      return;
+   }
+
+   int command = batchCommands[instanceBatches[instance]] + int(entry & LOD_MASK);
+
+   // take the next free slot of the slice and copy the instance there
+   uint slot = atomicAdd(drawCommands[command].instanceCount, 1u);
+   drawInstances[drawCommands[command].baseInstance + slot] = sourceInstances[instance];
+}
+
+void main()
+{
+   uint index = gl_GlobalInvocationID.x;
+
+   if(cullPass == 1u)
+   {
+      if(index < batchCount)
+      {
+         PlaceBatch(index);
+      }
+   }
+   else if(index < instanceCount)
+   {
+      if(cullPass == 0u)
+      {
+         ClassifyInstance(index);
+      }
+      else
+      {
+         ScatterInstance(index);
+      }
+   }
+}
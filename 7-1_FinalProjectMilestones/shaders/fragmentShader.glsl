@@ -2,49 +2,82 @@
 
 struct Material 
 {
+    vec3 ambientColor;
+    float ambientStrength;
     vec3 diffuseColor;
-    vec3 specularColor;
     float shininess;
+    vec3 specularColor;
 }; 
 
 struct LightSource 
 {
     vec3 position;	
-    vec3 diffuseColor;
-    vec3 specularColor;
     float focalStrength;
+    vec3 diffuseColor;
     float specularIntensity;
+    vec3 specularColor;
 };
 
 #define TOTAL_LIGHTS 4
+#define TOTAL_MATERIALS 32
+#define TOTAL_TEXTURE_ARRAYS 16
+
+// per-frame camera data shared by every shader program
+layout (std140, binding = 0) uniform FrameData
+{
+   mat4 view;
+   mat4 projection;
+   vec4 viewPosition;
+};
+
+// scene light data shared by every shader program
+layout (std140, binding = 1) uniform LightData
+{
+   LightSource lightSources[TOTAL_LIGHTS];
+   vec3 globalAmbientColor;
+};
+
+// table of every object material, indexed per instance
+layout (std140, binding = 2) uniform MaterialData
+{
+   Material materials[TOTAL_MATERIALS];
+};
 
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
 in vec2 fragmentTextureCoordinate;
+// texture tint for textured instances, object color otherwise
+flat in vec4 fragmentInstanceColor;
+// entry of the material table for the instance
+flat in int fragmentMaterialIndex;
+// layer and array texture for textured instances, the
+// array is -1 for untextured instances
+flat in float fragmentTextureLayer;
+flat in int fragmentTextureArray;
 
 out vec4 outFragmentColor;
 
-uniform bool bUseTexture=false;
 uniform bool bUseLighting=false;
-uniform vec4 objectColor = vec4(1.0f);
-uniform sampler2D objectTexture;
-uniform vec3 viewPosition;
-uniform vec2 UVscale = vec2(1.0f, 1.0f);
-uniform LightSource lightSources[TOTAL_LIGHTS];
-uniform Material material;
-uniform vec3 globalAmbientColor;
+// every array texture is bound to the unit matching its index
+uniform sampler2DArray objectTextures[TOTAL_TEXTURE_ARRAYS];
+
+// material of the instance, read from the material table
+Material material;
     
 
 // function prototypes
 vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+vec4 SampleObjectTexture();
 
 void main()
 {
+   material = materials[fragmentMaterialIndex];
+
    if(bUseLighting == true)
    {
       // properties
       vec3 lightNormal = normalize(fragmentVertexNormal);
-      vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+      vec3 viewDirection = normalize(viewPosition.xyz - fragmentPosition);
       vec3 phongResult = vec3(0.0f);
 
       for(int i = 0; i < TOTAL_LIGHTS; i++)
@@ -52,29 +85,36 @@ void main()
          phongResult += CalcLightSource(lightSources[i], lightNormal, fragmentPosition, viewDirection); 
       }   
     
-      if(bUseTexture == true)
+      if(fragmentTextureArray >= 0)
       {
-         vec4 textureColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+         vec4 textureColor = SampleObjectTexture() * fragmentInstanceColor;
          outFragmentColor = vec4(phongResult * textureColor.xyz, 1.0);
       }
       else
       {
-         outFragmentColor = vec4(phongResult * objectColor.xyz, objectColor.w);
+         outFragmentColor = vec4(phongResult * fragmentInstanceColor.xyz, fragmentInstanceColor.w);
       }
    }
    else 
    {
-      if(bUseTexture == true)
+      if(fragmentTextureArray >= 0)
       {
-         outFragmentColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+         outFragmentColor = SampleObjectTexture() * fragmentInstanceColor;
       }
       else
       {
-         outFragmentColor = objectColor;
+         outFragmentColor = fragmentInstanceColor;
       }
    }
 }
 
+// samples the array texture of the instance - every instance of a
+// draw uses the same array, so the sampler index is dynamically uniform
+vec4 SampleObjectTexture()
+{
+   return(texture(objectTextures[fragmentTextureArray], vec3(fragmentTextureCoordinate, fragmentTextureLayer)));
+}
+
 // calculates the color when using a directional light.
 vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
 {
@@ -0,0 +1,151 @@
+#version 440 core
+#extension GL_ARB_bindless_texture : require
+
+struct Material 
+{
+    vec3 ambientColor;
+    float ambientStrength;
+    vec3 diffuseColor;
+    float shininess;
+    vec3 specularColor;
+}; 
+
+struct LightSource 
+{
+    vec3 position;	
+    float focalStrength;
+    vec3 diffuseColor;
+    float specularIntensity;
+    vec3 specularColor;
+};
+
+#define TOTAL_LIGHTS 4
+#define TOTAL_MATERIALS 32
+
+// per-frame camera data shared by every shader program
+layout (std140, binding = 0) uniform FrameData
+{
+   mat4 view;
+   mat4 projection;
+   vec4 viewPosition;
+};
+
+// bindless handles of the array textures, by array index
+layout (std430, binding = 2) readonly buffer TextureHandles
+{
+   uvec2 textureHandles[];
+};
+
+// scene light data shared by every shader program
+layout (std140, binding = 1) uniform LightData
+{
+   LightSource lightSources[TOTAL_LIGHTS];
+   vec3 globalAmbientColor;
+};
+
+// table of every object material, indexed per instance
+layout (std140, binding = 2) uniform MaterialData
+{
+   Material materials[TOTAL_MATERIALS];
+};
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+// texture tint for textured instances, object color otherwise
+flat in vec4 fragmentInstanceColor;
+// entry of the material table for the instance
+flat in int fragmentMaterialIndex;
+// layer and array texture for textured instances, the
+// array is -1 for untextured instances
+flat in float fragmentTextureLayer;
+flat in int fragmentTextureArray;
+
+out vec4 outFragmentColor;
+
+uniform bool bUseLighting=false;
+
+// material of the instance, read from the material table
+Material material;
+    
+
+// function prototypes
+vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection);
+vec4 SampleObjectTexture();
+
+void main()
+{
+   material = materials[fragmentMaterialIndex];
+
+   if(bUseLighting == true)
+   {
+      // properties
+      vec3 lightNormal = normalize(fragmentVertexNormal);
+      vec3 viewDirection = normalize(viewPosition.xyz - fragmentPosition);
+      vec3 phongResult = vec3(0.0f);
+
+      for(int i = 0; i < TOTAL_LIGHTS; i++)
+      {
+         phongResult += CalcLightSource(lightSources[i], lightNormal, fragmentPosition, viewDirection); 
+      }   
+    
+      if(fragmentTextureArray >= 0)
+      {
+         vec4 textureColor = SampleObjectTexture() * fragmentInstanceColor;
+         outFragmentColor = vec4(phongResult * textureColor.xyz, 1.0);
+      }
+      else
+      {
+         outFragmentColor = vec4(phongResult * fragmentInstanceColor.xyz, fragmentInstanceColor.w);
+      }
+   }
+   else 
+   {
+      if(fragmentTextureArray >= 0)
+      {
+         outFragmentColor = SampleObjectTexture() * fragmentInstanceColor;
+      }
+      else
+      {
+         outFragmentColor = fragmentInstanceColor;
+      }
+   }
+}
+
+// samples the array texture of the instance - every instance of a
+// draw uses the same array, so the handle index is dynamically uniform
+vec4 SampleObjectTexture()
+{
+   return(texture(sampler2DArray(textureHandles[fragmentTextureArray]), vec3(fragmentTextureCoordinate, fragmentTextureLayer)));
+}
+
+// calculates the color when using a directional light.
+vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+   vec3 ambient;
+   vec3 diffuse;
+   vec3 specular;
+
+   //**Calculate Ambient lighting**
+
+   ambient = globalAmbientColor;
+
+   //**Calculate Diffuse lighting**
+
+   // Calculate distance (light direction) between light source and fragments/pixels
+   vec3 lightDirection = normalize(light.position - vertexPosition); 
+   // Calculate diffuse impact by generating dot product of normal and light
+   float impact = max(dot(lightNormal, lightDirection), 0.0);
+   // Generate diffuse material color   
+   diffuse = impact * material.diffuseColor; 
+
+   //**Calculate Specular lighting**
+
+   // Calculate reflection vector
+   vec3 reflectDir = reflect(-lightDirection, lightNormal);
+   // Calculate specular component
+   float specularComponent = pow(max(dot(viewDirection, reflectDir), 0.0), light.focalStrength);
+   specular = (light.specularIntensity * material.shininess) * specularComponent * material.specularColor;
+  
+   return(ambient + diffuse + specular);
+}
\ No newline at end of file
@@ -1,20 +1,39 @@
-#version 330 core
+#version 440 core
 layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
+// per-instance model matrix (locations 3 to 6), color, UV
+// scale with texture array layer and array index, and
+// material index
+layout (location = 3) in mat4 instanceModel;
+layout (location = 7) in vec4 instanceColor;
+layout (location = 8) in vec4 instanceTexture;
+layout (location = 9) in float instanceMaterial;
 
 out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
+flat out vec4 fragmentInstanceColor;
+flat out float fragmentTextureLayer;
+flat out int fragmentTextureArray;
+flat out int fragmentMaterialIndex;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// per-frame camera data shared by every shader program
+layout (std140, binding = 0) uniform FrameData
+{
+   mat4 view;
+   mat4 projection;
+   vec4 viewPosition;
+};
 
 void main()
 {
-   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
-   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
+   fragmentPosition = vec3(instanceModel * vec4(inVertexPosition, 1.0));
+   gl_Position = projection * view * instanceModel * vec4(inVertexPosition, 1.0f);
    fragmentVertexNormal = inVertexNormal;
-   fragmentTextureCoordinate = inTextureCoordinate;
+   fragmentTextureCoordinate = inTextureCoordinate * instanceTexture.xy;
+   fragmentInstanceColor = instanceColor;
+   fragmentTextureLayer = instanceTexture.z;
+   fragmentTextureArray = int(instanceTexture.w);
+   fragmentMaterialIndex = int(instanceMaterial);
 }
\ No newline at end of file